@@ -0,0 +1,235 @@
+/* Replays heap traces (structs/heaptrace.hpp, recorded with the HEAP_TRACE option) through every heap
+variant and prints the time per operation of each.
+
+  ./HeapBenchmark [-r repetitions] heap-0.trace heap-1.trace ...
+  ./HeapBenchmark [-r repetitions] -s operations     (a random Dijkstra like trace instead)
+
+The radix heap is only run on traces that are monotone in their first key with the other two always 0,
+the shape of the Dijkstra sampler's queue. Equal keys may come out of the variants in different orders,
+when one pops a different item than the trace did the two items swap roles for the rest of the replay
+(they have the same key, so the heap can't tell).
+*/
+
+#include "../structs/inplacebinaryheap.hpp"
+#include "../structs/inplacedaryheap.hpp"
+#include "../structs/monotoneradixheap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Item {
+	static bool pred(const Item *a, const Item *b) {
+		return a->key < b->key;
+	}
+	static unsigned int getHeapIndex(const Item *r) {
+		return r->heapIndex;
+	}
+	static void setHeapIndex(Item *r, unsigned int i) {
+		r->heapIndex = i;
+	}
+
+	struct HeapKey {
+		double values[3];
+
+		bool operator<(const HeapKey &k) const {
+			if(values[0] != k.values[0]) return values[0] < k.values[0];
+			if(values[1] != k.values[1]) return values[1] < k.values[1];
+			return values[2] < k.values[2];
+		}
+	};
+	static const HeapKey &getHeapKey(const Item *r) {
+		return r->key;
+	}
+
+	HeapKey key;
+	unsigned int heapIndex = std::numeric_limits<unsigned int>::max();
+	unsigned int traceId;
+};
+
+// the radix heap only looks at the first key
+struct RadixItem : public Item {
+	static double getHeapKey(const Item *r) {
+		return r->key.values[0];
+	}
+};
+
+enum Op { Push, Pop, Sift, Remove, Clear };
+
+struct Operation {
+	Op op;
+	unsigned int item;
+	Item::HeapKey key;
+};
+
+struct Trace {
+	std::string name;
+	std::vector<Operation> operations;
+	unsigned int itemCount = 0;
+	bool monotone = true;
+};
+
+bool readTrace(const char *path, Trace &trace) {
+	FILE *file = fopen(path, "r");
+	if(file == NULL) return false;
+
+	trace.name = path;
+	char op[16];
+	Operation operation;
+	double lastPopped = 0;
+	std::vector<double> keys;
+	while(fscanf(file, "%15s %u %lf %lf %lf", op, &operation.item, &operation.key.values[0], &operation.key.values[1],
+	             &operation.key.values[2]) == 5) {
+		if(strcmp(op, "push") == 0) operation.op = Push;
+		else if(strcmp(op, "pop") == 0) operation.op = Pop;
+		else if(strcmp(op, "sift") == 0) operation.op = Sift;
+		else if(strcmp(op, "remove") == 0) operation.op = Remove;
+		else operation.op = Clear;
+		trace.operations.push_back(operation);
+		if(operation.item >= trace.itemCount) trace.itemCount = operation.item + 1;
+
+		if(keys.size() < trace.itemCount) keys.resize(trace.itemCount, 0);
+		if(operation.op == Push || operation.op == Sift) {
+			keys[operation.item] = operation.key.values[0];
+			trace.monotone = trace.monotone && operation.key.values[0] >= lastPopped && operation.key.values[0] >= 0 &&
+			                 operation.key.values[1] == 0 && operation.key.values[2] == 0;
+		} else if(operation.op == Pop) {
+			lastPopped = keys[operation.item];
+		} else if(operation.op == Clear) {
+			lastPopped = 0;
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+// pushes with random keys, pops, and decreases of the largest queued key, shaped like a Dijkstra queue
+Trace syntheticTrace(unsigned int operations) {
+	Trace trace;
+	trace.name = "synthetic";
+	std::mt19937 random(0);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<double> keys;
+	std::set<std::pair<double, unsigned int>> queued;
+	double lastPopped = 0;
+	while(trace.operations.size() < operations) {
+		Operation operation;
+		double p = uniform(random);
+		if(queued.empty() || p < 0.4) {
+			operation.op = Push;
+			operation.item = keys.size();
+			keys.push_back(lastPopped + uniform(random));
+			operation.key = Item::HeapKey{{keys.back(), 0, 0}};
+			queued.emplace(keys.back(), operation.item);
+		} else if(p < 0.8) {
+			operation.op = Pop;
+			operation.item = queued.begin()->second;
+			lastPopped = queued.begin()->first;
+			operation.key = Item::HeapKey{{0, 0, 0}};
+			queued.erase(queued.begin());
+		} else {
+			// the last one pushed that is still queued
+			operation.op = Sift;
+			operation.item = queued.rbegin()->second;
+			queued.erase(std::prev(queued.end()));
+			keys[operation.item] = lastPopped + (keys[operation.item] - lastPopped) * uniform(random);
+			operation.key = Item::HeapKey{{keys[operation.item], 0, 0}};
+			queued.emplace(keys[operation.item], operation.item);
+		}
+		trace.operations.push_back(operation);
+	}
+	trace.itemCount = keys.size();
+	return trace;
+}
+
+template <class Heap>
+double replay(const Trace &trace, unsigned int repetitions) {
+	std::vector<Item> items(trace.itemCount);
+	std::vector<unsigned int> replayed(trace.itemCount); //trace item -> the item playing it
+	double best = std::numeric_limits<double>::infinity();
+
+	for(unsigned int r = 0; r < repetitions; ++r) {
+		for(unsigned int i = 0; i < trace.itemCount; ++i) {
+			items[i].heapIndex = std::numeric_limits<unsigned int>::max();
+			items[i].traceId = i;
+			replayed[i] = i;
+		}
+		Heap heap;
+
+		auto start = std::chrono::steady_clock::now();
+		for(const Operation &operation : trace.operations) {
+			Item *item = &items[replayed[operation.item]];
+			switch(operation.op) {
+			case Push:
+				item->key = operation.key;
+				heap.push(item);
+				break;
+			case Pop: {
+				Item *popped = heap.pop();
+				if(popped != item) {
+					std::swap(replayed[popped->traceId], replayed[item->traceId]);
+					std::swap(popped->traceId, item->traceId);
+				}
+				break;
+			}
+			case Sift:
+				item->key = operation.key;
+				heap.siftFromItem(item);
+				break;
+			case Remove:
+				heap.remove(item);
+				break;
+			case Clear:
+				while(!heap.isEmpty()) heap.pop();
+				heap.clear();
+				break;
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if(seconds < best) best = seconds;
+	}
+	return best * 1e9 / trace.operations.size();
+}
+
+int main(int argc, char **argv) {
+	unsigned int repetitions = 5;
+	std::vector<Trace> traces;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			repetitions = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			traces.push_back(syntheticTrace(atoi(argv[++i])));
+		} else {
+			Trace trace;
+			if(!readTrace(argv[i], trace)) {
+				fprintf(stderr, "could not read %s\n", argv[i]);
+				return 1;
+			}
+			traces.push_back(trace);
+		}
+	}
+	if(traces.empty()) {
+		traces.push_back(syntheticTrace(1000000));
+	}
+
+	printf("%-24s %10s %10s %10s %10s %10s %10s\n", "trace", "operations", "binary", "2-ary", "4-ary", "8-ary", "radix");
+	for(const Trace &trace : traces) {
+		printf("%-24s %10zu", trace.name.c_str(), trace.operations.size());
+		printf(" %10.1f", replay<InPlaceBinaryHeap<Item, Item>>(trace, repetitions));
+		printf(" %10.1f", replay<InPlaceDaryHeap<Item, Item, 2>>(trace, repetitions));
+		printf(" %10.1f", replay<InPlaceDaryHeap<Item, Item, 4>>(trace, repetitions));
+		printf(" %10.1f", replay<InPlaceDaryHeap<Item, Item, 8>>(trace, repetitions));
+		if(trace.monotone) printf(" %10.1f", replay<MonotoneRadixHeap<Item, RadixItem>>(trace, repetitions));
+		else printf(" %10s", "-");
+		printf("\n");
+	}
+	printf("(ns per operation, best of %u)\n", repetitions);
+	return 0;
+}
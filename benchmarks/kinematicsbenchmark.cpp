@@ -0,0 +1,249 @@
+/* Times the kinematic chain kernels of domains/detail/chainkinematics.hpp against the vector based
+versions the helpers used before (kept below as the reference) on random 10 link chains, and checks that
+both give the same link transforms and joint angles.
+
+  ./KinematicsBenchmark [-r repetitions] [-n chains]
+*/
+
+#include "../domains/detail/chainkinematics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace KinematicChainHelpers;
+
+static const unsigned int Links = 10;
+
+namespace Reference {
+	void multiply(const std::vector<double> &m1, const std::vector<double> &m2, std::vector<double> &out) {
+		std::vector<double> temp(16);
+		for(unsigned int row = 0; row < 4; ++row) {
+			for(unsigned int col = 0; col < 4; ++col) {
+				double sum = 0;
+				for(unsigned int i = 0; i < 4; i++) {
+					sum += m1[row * 4 + i] * m2[col + 4 * i];
+				}
+				temp[row * 4 + col] = sum;
+			}
+		}
+		for(unsigned int i = 0; i < 16; i++) out[i] = temp[i];
+	}
+
+	std::vector<double> axisRotation(unsigned int axis, double angle) {
+		std::vector<double> innerRotation(16, 0);
+		innerRotation[0] = innerRotation[5] = innerRotation[10] = innerRotation[15] = 1;
+		if(axis == 0) {
+			innerRotation[5] = cos(angle);
+			innerRotation[6] = -sin(angle);
+			innerRotation[9] = sin(angle);
+			innerRotation[10] = cos(angle);
+		} else if(axis == 1) {
+			innerRotation[0] = cos(angle);
+			innerRotation[2] = sin(angle);
+			innerRotation[8] = -sin(angle);
+			innerRotation[10] = cos(angle);
+		} else if(axis == 2) {
+			innerRotation[0] = cos(angle);
+			innerRotation[1] = -sin(angle);
+			innerRotation[4] = sin(angle);
+			innerRotation[5] = cos(angle);
+		}
+		return innerRotation;
+	}
+
+	std::vector<double> toVector(const Matrix4 &m) {
+		return std::vector<double>(m.m, m.m + 16);
+	}
+
+	double getRotationAngle(const std::vector<double> &a, const std::vector<double> &b, unsigned int axis) {
+		double w0 = sqrt(1 + a[0] + a[5] + a[10]) / 2;
+		double x0 = (a[9] - a[6]) / (4 * w0);
+		double y0 = (a[2] - a[8]) / (4 * w0);
+		double z0 = (a[4] - a[1]) / (4 * w0);
+
+		double w1 = sqrt(1 + b[0] + b[5] + b[10]) / 2;
+		double x1 = (b[9] - b[6]) / (4 * w1);
+		double y1 = (b[2] - b[8]) / (4 * w1);
+		double z1 = (b[4] - b[1]) / (4 * w1);
+
+		double innerProduct = w0 * w1 + x0 * x1 + y0 * y1 + z0 * z1;
+		double angle = acos(2 * innerProduct * innerProduct - 1);
+
+		std::vector<double> innerRotation = axisRotation(axis, angle);
+		multiply(a, innerRotation, innerRotation);
+		for(unsigned int i = 0; i < 16; i++) {
+			if(fabs(b[i] - innerRotation[i]) >= 0.0000001) {
+				angle *= -1;
+				break;
+			}
+		}
+		return angle;
+	}
+
+	void forwardKinematics(const std::vector<TransformPair> &pairs, const std::vector<unsigned int> &axes,
+	                       const std::vector<double> &jointAngles, std::vector<std::vector<double>> &links) {
+		std::vector<double> transform(16);
+		transform[0] = transform[5] = transform[10] = transform[15] = 1;
+
+		unsigned int transformPairIndex = 0;
+		for(unsigned int linkIndex = 0; linkIndex < Links; linkIndex++) {
+			std::vector<double> rotation(16);
+			rotation[0] = rotation[5] = rotation[10] = rotation[15] = 1;
+			for(unsigned int i = 0; i < 2; i++) {
+				const auto &matrixTransform = pairs[transformPairIndex++];
+				multiply(transform, toVector(matrixTransform.translation), transform);
+				multiply(toVector(matrixTransform.rotation), rotation, rotation);
+
+				if(transformPairIndex % 2 == 1) {
+					unsigned int which = transformPairIndex / 2;
+					multiply(transform, axisRotation(axes[which], jointAngles[which]), transform);
+				}
+			}
+
+			std::vector<double> transform2(16);
+			multiply(transform, rotation, transform2);
+			links[linkIndex] = transform2;
+		}
+	}
+
+	void inverseKinematics(const std::vector<TransformPair> &pairs, const std::vector<unsigned int> &axes,
+	                       const std::vector<std::vector<double>> &linkRotations, std::vector<double> &jointAngles) {
+		std::vector<double> transform(16);
+		transform[0] = transform[5] = transform[10] = transform[15] = 1;
+
+		unsigned int transformPairIndex = 0;
+		for(unsigned int linkIndex = 0; linkIndex < Links; linkIndex++) {
+			std::vector<double> rotation(16);
+			rotation[0] = rotation[5] = rotation[10] = rotation[15] = 1;
+			for(unsigned int i = 0; i < 2; i++) {
+				const auto &matrixTransform = pairs[transformPairIndex++];
+				multiply(transform, toVector(matrixTransform.translation), transform);
+				multiply(toVector(matrixTransform.rotation), rotation, rotation);
+
+				if(transformPairIndex % 2 == 1) {
+					unsigned int which = transformPairIndex / 2;
+					double rotValue = getRotationAngle(transform, linkRotations[linkIndex], axes[which]);
+					jointAngles[which] = rotValue;
+					multiply(transform, axisRotation(axes[which], rotValue), transform);
+				}
+			}
+		}
+	}
+};
+
+struct Chain {
+	std::vector<TransformPair> pairs;
+	std::vector<unsigned int> axes;
+	std::vector<double> angles;
+	std::vector<Quaternion> linkRotations;
+	std::vector<std::vector<double>> linkRotationMatrices;
+};
+
+std::vector<Chain> randomChains(unsigned int count) {
+	std::mt19937 random(0);
+	std::uniform_real_distribution<double> offset(-0.2, 0.2), angle(-1, 1);
+	std::uniform_int_distribution<unsigned int> axis(0, 2);
+
+	std::vector<Chain> chains(count);
+	for(Chain &chain : chains) {
+		for(unsigned int i = 0; i < 2 * Links; i++) {
+			std::vector<double> transform = {offset(random), offset(random), offset(random), 0, 0, 0};
+			transform[3 + axis(random)] = angle(random);
+			chain.pairs.push_back(getTransformPair(transform));
+		}
+		for(unsigned int i = 0; i < Links; i++) {
+			chain.axes.push_back(axis(random));
+			chain.angles.push_back(angle(random));
+			Quaternion q{1 + angle(random) * 0.5, angle(random), angle(random), angle(random)};
+			double norm = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+			q = Quaternion{q.w / norm, q.x / norm, q.y / norm, q.z / norm};
+			chain.linkRotations.push_back(q);
+			chain.linkRotationMatrices.push_back(Reference::toVector(q.toMatrix()));
+		}
+	}
+	return chains;
+}
+
+template <class Kernel>
+double timeKernel(unsigned int repetitions, unsigned int calls, Kernel kernel) {
+	double best = std::numeric_limits<double>::infinity();
+	for(unsigned int r = 0; r < repetitions; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		kernel();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if(seconds < best) best = seconds;
+	}
+	return best * 1e9 / calls;
+}
+
+int main(int argc, char **argv) {
+	unsigned int repetitions = 5, count = 100000;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			repetitions = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		}
+	}
+
+	std::vector<Chain> chains = randomChains(count);
+	std::vector<std::vector<double>> referenceLinks(Links);
+	std::vector<double> referenceAngles(Links);
+	Matrix4 links[Links];
+	double angles[Links];
+	//summed over the timed loops and printed so the compiler can't drop them
+	double sink = 0, maxLinkError = 0, maxAngleError = 0;
+
+	for(const Chain &chain : chains) {
+		Reference::forwardKinematics(chain.pairs, chain.axes, chain.angles, referenceLinks);
+		forwardKinematics<Links>(chain.pairs.data(), chain.axes.data(), chain.angles.data(), links);
+		Reference::inverseKinematics(chain.pairs, chain.axes, chain.linkRotationMatrices, referenceAngles);
+		inverseKinematics<Links>(chain.pairs.data(), chain.axes.data(), chain.linkRotations.data(), angles);
+		for(unsigned int link = 0; link < Links; link++) {
+			for(unsigned int i = 0; i < 16; i++) {
+				maxLinkError = std::max(maxLinkError, fabs(referenceLinks[link][i] - links[link][i]));
+			}
+			if(!std::isnan(referenceAngles[link]) || !std::isnan(angles[link])) {
+				maxAngleError = std::max(maxAngleError, fabs(referenceAngles[link] - angles[link]));
+			}
+		}
+	}
+
+	double referenceForward = timeKernel(repetitions, count, [&]() {
+		for(const Chain &chain : chains) {
+			Reference::forwardKinematics(chain.pairs, chain.axes, chain.angles, referenceLinks);
+			sink += referenceLinks[Links - 1][3];
+		}
+	});
+	double fixedForward = timeKernel(repetitions, count, [&]() {
+		for(const Chain &chain : chains) {
+			forwardKinematics<Links>(chain.pairs.data(), chain.axes.data(), chain.angles.data(), links);
+			sink += links[Links - 1][3];
+		}
+	});
+	double referenceInverse = timeKernel(repetitions, count, [&]() {
+		for(const Chain &chain : chains) {
+			Reference::inverseKinematics(chain.pairs, chain.axes, chain.linkRotationMatrices, referenceAngles);
+			sink += referenceAngles[Links - 1];
+		}
+	});
+	double fixedInverse = timeKernel(repetitions, count, [&]() {
+		for(const Chain &chain : chains) {
+			inverseKinematics<Links>(chain.pairs.data(), chain.axes.data(), chain.linkRotations.data(), angles);
+			sink += angles[Links - 1];
+		}
+	});
+
+	printf("%-20s %12s %12s\n", "kernel", "vector", "fixed");
+	printf("%-20s %12.1f %12.1f\n", "forward kinematics", referenceForward, fixedForward);
+	printf("%-20s %12.1f %12.1f\n", "joint angles", referenceInverse, fixedInverse);
+	printf("(ns per %u link chain, best of %u; max difference %g in transforms, %g in angles; checksum %g)\n", Links, repetitions,
+	       maxLinkError, maxAngleError, sink);
+	return 0;
+}
@@ -0,0 +1,116 @@
+/* Checks how batch mode (structs/batchruns.hpp) expands a batch file into runs, without OMPL: every
+instance once per seed of the BatchSeeds range, each run with its own log name <Output>.<instance>.<seed>,
+and a BatchSeeds that isn't exactly "first last" with first <= last rejected. Then runForked with a stand
+in for runInstance: runs that return false or crash are counted as failed, and what the children print
+reaches a redirected stdout.
+
+  ./BatchRunsCheck [directory]      (default /tmp, where the instance files are written)
+*/
+
+#include "check.hpp"
+#include "../structs/batchruns.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+FileMap fromString(const std::string &text) {
+	std::istringstream stream(text);
+	return FileMap(stream);
+}
+
+// getBatchRuns exits on a bad batch file, so try it in a child
+bool rejects(const std::string &text) {
+	fflush(stderr);
+	pid_t pid = fork();
+	if(pid == 0) {
+		freopen("/dev/null", "w", stderr);
+		getBatchRuns(fromString(text));
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 1;
+}
+
+// a stand in for runInstance: odd seeds fail and seed 14 crashes, the rest print their log name, which
+// stays buffered when stdout is a file
+bool fakeRun(const FileMap &params) {
+	int seed = params.integerVal("Seed");
+	if(seed == 14) abort();
+	printf("%s\n", params.stringVal("Output").c_str());
+	return seed % 2 == 0;
+}
+
+int main(int argc, char **argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+	// one instance, a range of seeds
+	std::vector<FileMap> runs = getBatchRuns(fromString("Domain ? Blimp\nSeed ? 1\nOutput ? batch.log\nBatchSeeds ? 3 6\n"));
+	expect(runs.size() == 4, "one run per seed of the range");
+	std::set<std::string> outputs;
+	for(unsigned int i = 0; i < runs.size(); ++i) {
+		expect(runs[i].integerVal("Seed") == (int)(3 + i), "the seeds in order");
+		expect(runs[i].stringVal("Output") == "batch.log.0." + std::to_string(3 + i), "the log named after instance and seed");
+		expect(runs[i].stringVal("Domain") == "Blimp", "the batch file is the instance");
+		outputs.insert(runs[i].stringVal("Output"));
+	}
+	expect(outputs.size() == runs.size(), "every run has its own log");
+
+	// two instance files, each with its own settings
+	std::string first = directory + "/batchrunscheck-a.inst", second = directory + "/batchrunscheck-b.inst";
+	std::ofstream(first.c_str()) << "Domain ? Blimp\nSeed ? 10\nOutput ? a.log\n";
+	std::ofstream(second.c_str()) << "Domain ? Quadrotor\nSeed ? 20\nOutput ? b.log\n";
+
+	runs = getBatchRuns(fromString("Output ? batch.log\nBatchInstances ? " + first + " " + second + "\nBatchSeeds ? 1 2\n"));
+	expect(runs.size() == 4, "one run per instance and seed");
+	const char *expected[][3] = {{"Blimp", "1", "batch.log.0.1"}, {"Blimp", "2", "batch.log.0.2"},
+	                             {"Quadrotor", "1", "batch.log.1.1"}, {"Quadrotor", "2", "batch.log.1.2"}};
+	for(unsigned int i = 0; i < runs.size() && i < 4; ++i) {
+		expect(runs[i].stringVal("Domain") == expected[i][0], "each run keeps its instance's settings");
+		expect(runs[i].stringVal("Seed") == expected[i][1], "each run gets its seed");
+		expect(runs[i].stringVal("Output") == expected[i][2], "each run logs next to the batch's Output");
+	}
+
+	// without BatchSeeds every instance runs once with its own seed
+	runs = getBatchRuns(fromString("Output ? batch.log\nBatchInstances ? " + first + " " + second + "\n"));
+	expect(runs.size() == 2 && runs[0].stringVal("Seed") == "10" && runs[1].stringVal("Seed") == "20", "instances keep their seeds");
+	expect(runs.size() == 2 && runs[0].stringVal("Output") == "batch.log.0.10" && runs[1].stringVal("Output") == "batch.log.1.20",
+	       "logs named after the instances' seeds");
+	remove(first.c_str());
+	remove(second.c_str());
+
+	// anything but a range of two values
+	expect(getBatchRuns(fromString("Seed ? 1\nOutput ? o\nBatchSeeds ? 5 5\n")).size() == 1, "a range of one seed");
+	expect(rejects("Seed ? 1\nOutput ? o\nBatchSeeds ? 1 5 9\n"), "a list of three seeds is rejected");
+	expect(rejects("Seed ? 1\nOutput ? o\nBatchSeeds ? 7\n"), "a single seed is rejected");
+	expect(rejects("Seed ? 1\nOutput ? o\nBatchSeeds ? 5 1\n"), "a range running backwards is rejected");
+
+	// runForked in a child of its own whose stdout goes to a file, exiting with the failure count
+	runs = getBatchRuns(fromString("Seed ? 1\nOutput ? forked.log\nBatchSeeds ? 1 14\n"));
+	std::string printed = directory + "/batchrunscheck-stdout.txt";
+	fflush(stdout);
+	pid_t pid = fork();
+	if(pid == 0) {
+		freopen(printed.c_str(), "w", stdout);
+		freopen("/dev/null", "w", stderr);
+		_exit(runForked(runs, 3, fakeRun));
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	expect(WIFEXITED(status) && WEXITSTATUS(status) == 8, "the odd seeds and the crash fail, got %d", WEXITSTATUS(status));
+	std::set<std::string> lines;
+	std::ifstream file(printed.c_str());
+	for(std::string line; std::getline(file, line);) lines.insert(line);
+	bool allPrinted = lines.size() == runs.size() - 1;
+	for(unsigned int i = 0; i + 1 < runs.size(); ++i) allPrinted = allPrinted && lines.count(runs[i].stringVal("Output")) == 1;
+	expect(allPrinted, "every child's output is flushed before it exits");
+	remove(printed.c_str());
+
+	return finishCheck("batch runs");
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/* What the correctness checks in checks/ share: expect and fail count failures and print the first few
+with a printf style description, finishCheck prints the verdict and gives main its exit status. The
+timing benchmarks stay in benchmarks/. */
+
+#include <cstdarg>
+#include <cstdio>
+
+unsigned int checkFailures = 0;
+
+inline void vfail(const char *format, va_list args) {
+	if(checkFailures++ < 10) {
+		fprintf(stderr, "FAILED ");
+		vfprintf(stderr, format, args);
+		fprintf(stderr, "\n");
+	}
+}
+
+inline void fail(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	vfail(format, args);
+	va_end(args);
+}
+
+inline bool expect(bool ok, const char *format, ...) {
+	if(!ok) {
+		va_list args;
+		va_start(args, format);
+		vfail(format, args);
+		va_end(args);
+	}
+	return ok;
+}
+
+inline int finishCheck(const char *name) {
+	if(checkFailures == 0) {
+		printf("%s check passed\n", name);
+		return 0;
+	}
+	fprintf(stderr, "%s check: %u failures\n", name, checkFailures);
+	return 1;
+}
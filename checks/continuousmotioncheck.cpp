@@ -0,0 +1,160 @@
+/* Checks the conservative advancement behind FCLContinuousMotionValidator
+(domains/geometry/detail/ConservativeAdvancement.hpp) without OMPL or FCL, against a dense scan of the same
+motions: a disc moving in a straight line through a box of disc obstacles.
+
+A motion passed as valid must have no colliding state in the scan (up to a graze thinner than the resolution
+once the search fell back to resolution checks), a motion with a colliding state must be rejected, and the
+last valid fraction handed back must be valid and come before the first collision. Motions that start within
+the contact distance of an obstacle must pass when they move away from it and fail when they move into it.
+
+  ./ContinuousMotionCheck [-n motions]
+*/
+
+#include "check.hpp"
+#include "../domains/geometry/detail/ConservativeAdvancement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Disc {
+	double x, y, radius;
+};
+
+struct World {
+	std::vector<Disc> obstacles;
+	double size = 10;
+
+	// distance from a disc of radius at (x, y) to the nearest obstacle, negative when they overlap
+	double clearance(double x, double y, double radius) const {
+		double c = 1e9;
+		for(const Disc &o : obstacles) {
+			c = std::min(c, std::hypot(x - o.x, y - o.y) - o.radius - radius);
+		}
+		return c;
+	}
+
+	bool inBounds(double x, double y) const {
+		return x >= 0 && x <= size && y >= 0 && y <= size;
+	}
+};
+
+// one straight line motion of the robot disc, advanced through and scanned densely
+struct Outcome {
+	bool passed, fellBack;
+	double lastValidTime, firstInvalid, minClearance;
+};
+
+Outcome runMotion(const World &world, double robot, double resolution, double ax, double ay, double bx, double by,
+                  const ompl::app::ConservativeAdvancement &advancement) {
+	auto clearance = [&](double t) {
+		return world.clearance(ax + t * (bx - ax), ay + t * (by - ay), robot);
+	};
+	unsigned int validityQueries = 0;
+	auto isValid = [&](double t) {
+		validityQueries++;
+		double x = ax + t * (bx - ax), y = ay + t * (by - ay);
+		return world.inBounds(x, y) && world.clearance(x, y, robot) > 0;
+	};
+
+	Outcome outcome;
+	double length = std::hypot(bx - ax, by - ay);
+	unsigned int segments = std::max(1u, (unsigned int)std::ceil(length / resolution));
+	outcome.passed = advancement.advance(length, segments, world.inBounds(bx, by), clearance, isValid, outcome.lastValidTime);
+	// a motion ending in bounds only has its states checked once the search fell back to resolution checks
+	outcome.fellBack = validityQueries > 0;
+
+	const unsigned int scan = 5000;
+	outcome.firstInvalid = -1;
+	outcome.minClearance = 1e9;
+	for(unsigned int i = 0; i <= scan; ++i) {
+		double t = (double)i / scan;
+		outcome.minClearance = std::min(outcome.minClearance, clearance(t));
+		if(outcome.firstInvalid < 0 && !isValid(t)) outcome.firstInvalid = t;
+	}
+	return outcome;
+}
+
+int main(int argc, char **argv) {
+	unsigned int motions = 5000;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			motions = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n motions]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> unit(0, 1);
+
+	World world;
+	for(unsigned int i = 0; i < 12; ++i) {
+		world.obstacles.push_back(Disc{ 10 * unit(rng), 10 * unit(rng), 0.3 + 0.7 * unit(rng) });
+	}
+
+	const double robot = 0.1, resolution = 0.01;
+	unsigned int valid = 0, invalid = 0, fallbacks = 0;
+
+	for(unsigned int m = 0; m < motions; ++m) {
+		// mostly short motions inside the box, some that end outside it
+		double ax = 10 * unit(rng), ay = 10 * unit(rng);
+		double length = m % 4 == 0 ? 6 * unit(rng) : 1.5 * unit(rng), angle = 2 * M_PI * unit(rng);
+		double bx = ax + length * cos(angle), by = ay + length * sin(angle);
+
+		ompl::app::ConservativeAdvancement advancement;
+		if(m % 5 == 0) advancement.maxIterations = 3;
+
+		Outcome o = runMotion(world, robot, resolution, ax, ay, bx, by, advancement);
+		bool startValid = world.inBounds(ax, ay) && world.clearance(ax, ay, robot) > 0;
+		double x = ax + o.lastValidTime * (bx - ax), y = ay + o.lastValidTime * (by - ay);
+		bool lastValid = world.inBounds(x, y) && world.clearance(x, y, robot) > 0;
+
+		if(o.passed) {
+			valid++;
+			if(o.fellBack) fallbacks++;
+			if(o.firstInvalid >= 0 && (!o.fellBack || o.minClearance < -1e-4 || !world.inBounds(bx, by)))
+				fail("passed a motion that collides (motion %u)", m);
+		} else {
+			invalid++;
+			if(o.firstInvalid < 0 && o.minClearance > 0)
+				fail("rejected a motion that keeps its distance (motion %u)", m);
+			if(startValid && !lastValid)
+				fail("the last valid fraction is not valid (motion %u)", m);
+			if(o.firstInvalid >= 0 && o.lastValidTime > o.firstInvalid)
+				fail("the last valid fraction is past the first collision (motion %u)", m);
+		}
+	}
+
+	// motions starting within the contact distance of an obstacle, straight away from it or into it
+	unsigned int contacts = 0;
+	for(unsigned int m = 0; m < motions / 5; ++m) {
+		ompl::app::ConservativeAdvancement advancement;
+		const Disc &disc = world.obstacles[m % world.obstacles.size()];
+		double angle = 2 * M_PI * unit(rng), gap = advancement.contactDistance * (0.01 + 0.99 * unit(rng));
+		double ax = disc.x + (disc.radius + robot + gap) * cos(angle), ay = disc.y + (disc.radius + robot + gap) * sin(angle);
+		if(!world.inBounds(ax, ay) || world.clearance(ax, ay, robot) < gap) continue;
+		contacts++;
+
+		double length = 0.05 + 0.5 * unit(rng);
+		Outcome away = runMotion(world, robot, resolution, ax, ay, ax + length * cos(angle), ay + length * sin(angle), advancement);
+		if(away.firstInvalid < 0 && away.minClearance > 0)
+			expect(away.passed, "rejected a motion moving away from the obstacle it touches (contact %u)", m);
+		else if(away.minClearance < -1e-4)
+			expect(!away.passed, "passed a motion that leaves one obstacle and collides with another (contact %u)", m);
+
+		Outcome into = runMotion(world, robot, resolution, ax, ay, ax - length * cos(angle), ay - length * sin(angle), advancement);
+		expect(!into.passed, "passed a motion into the obstacle it touches (contact %u)", m);
+		expect(into.firstInvalid < 0 || into.lastValidTime <= into.firstInvalid,
+		       "the last valid fraction is past the first collision (contact %u)", m);
+	}
+
+	printf("%u motions valid (%u after falling back to resolution checks), %u invalid, %u starting in contact\n", valid,
+	       fallbacks, invalid, contacts);
+	return finishCheck("continuous motion");
+}
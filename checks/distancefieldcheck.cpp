@@ -0,0 +1,200 @@
+/* Checks the voxel distance field (structs/distancefield.hpp) against brute force on a small grid: the seeds
+are exactly the voxels with a triangle within half a voxel diagonal of their center, the transform gives
+every voxel its exact squared distance to the nearest seed, the distance bounds hold the true distance to
+the triangles, segment verdicts agree with a dense scan of the segment and a written field reads back the
+same. Some triangles reach past the grid, so the clipped bounds get checked too.
+
+  ./DistanceFieldCheck [-s seed]
+*/
+
+#include "check.hpp"
+#include "../structs/distancefield.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Vector {
+	double x, y, z;
+	Vector operator-(const Vector &o) const { return Vector{x - o.x, y - o.y, z - o.z}; }
+	Vector operator+(const Vector &o) const { return Vector{x + o.x, y + o.y, z + o.z}; }
+	Vector operator*(double s) const { return Vector{x * s, y * s, z * s}; }
+	double dot(const Vector &o) const { return x * o.x + y * o.y + z * o.z; }
+	Vector cross(const Vector &o) const { return Vector{y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+};
+
+double segmentDistance(const Vector &p, const Vector &a, const Vector &b) {
+	Vector ab = b - a;
+	double t = std::max(0., std::min(1., (p - a).dot(ab) / ab.dot(ab)));
+	Vector d = p - (a + ab * t);
+	return sqrt(d.dot(d));
+}
+
+// by projection onto the plane, not the Voronoi regions the field uses
+double triangleDistance(const Vector &p, const Vector &a, const Vector &b, const Vector &c) {
+	Vector normal = (b - a).cross(c - a);
+	double height = (p - a).dot(normal) / sqrt(normal.dot(normal));
+	Vector q = p - normal * ((p - a).dot(normal) / normal.dot(normal));
+	bool inside = (b - a).cross(q - a).dot(normal) >= 0 && (c - b).cross(q - b).dot(normal) >= 0 &&
+	              (a - c).cross(q - c).dot(normal) >= 0;
+	if(inside) return std::fabs(height);
+	return std::min(segmentDistance(p, a, b), std::min(segmentDistance(p, b, c), segmentDistance(p, c, a)));
+}
+
+struct Mesh {
+	std::vector<double> vertices;
+	std::vector<unsigned int> triangles;
+
+	Vector vertex(unsigned int i) const {
+		return Vector{vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]};
+	}
+
+	double distance(const Vector &p) const {
+		double best = std::numeric_limits<double>::infinity();
+		for(unsigned int t = 0; t < triangles.size(); t += 3) {
+			best = std::min(best, triangleDistance(p, vertex(triangles[t]), vertex(triangles[t + 1]), vertex(triangles[t + 2])));
+		}
+		return best;
+	}
+};
+
+int main(int argc, char **argv) {
+	unsigned int seed = 1;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> unit(0, 1);
+
+	const double low[3] = {-1, 0, 0.5}, high[3] = {3, 3, 3}, voxel = 0.25;
+
+	// a few triangles around the grid, the first one reaching out of it
+	Mesh mesh;
+	for(unsigned int t = 0; t < 6; ++t) {
+		double center[3];
+		for(unsigned int d = 0; d < 3; ++d) {
+			center[d] = low[d] + (high[d] - low[d]) * (t == 0 ? 1.1 : unit(rng));
+		}
+		for(unsigned int k = 0; k < 3; ++k) {
+			for(unsigned int d = 0; d < 3; ++d) {
+				mesh.vertices.push_back(center[d] + 1.2 * (unit(rng) - 0.5));
+			}
+			mesh.triangles.push_back(mesh.triangles.size());
+		}
+	}
+
+	DistanceField field(mesh.vertices, mesh.triangles, low, high, voxel);
+	unsigned int dims[3] = {field.getCellCount(0), field.getCellCount(1), field.getCellCount(2)};
+
+	// seeds, against the center to triangle distance computed another way
+	double halfDiagonal = voxel * sqrt(3.) / 2;
+	std::vector<unsigned int> seeds;
+	for(unsigned int z = 0; z < dims[2]; ++z) {
+		for(unsigned int y = 0; y < dims[1]; ++y) {
+			for(unsigned int x = 0; x < dims[0]; ++x) {
+				Vector center{low[0] + (x + 0.5) * voxel, low[1] + (y + 0.5) * voxel, low[2] + (z + 0.5) * voxel};
+				double distance = mesh.distance(center);
+				bool seeded = field.getSquaredVoxelDistance(x, y, z) == 0;
+				if(seeded) {
+					seeds.insert(seeds.end(), {x, y, z});
+				}
+				if(std::fabs(distance - halfDiagonal) > 1e-9 && seeded != (distance <= halfDiagonal)) {
+					fail("a voxel is seeded exactly when a triangle is within half a diagonal of its center");
+				}
+			}
+		}
+	}
+	if(seeds.empty()) fail("the mesh seeds the grid");
+
+	// the transform, against the nearest seed by brute force
+	for(unsigned int z = 0; z < dims[2]; ++z) {
+		for(unsigned int y = 0; y < dims[1]; ++y) {
+			for(unsigned int x = 0; x < dims[0]; ++x) {
+				long long best = -1;
+				for(unsigned int s = 0; s < seeds.size(); s += 3) {
+					long long dx = (long long)x - seeds[s], dy = (long long)y - seeds[s + 1], dz = (long long)z - seeds[s + 2];
+					long long squared = dx * dx + dy * dy + dz * dz;
+					if(best < 0 || squared < best) best = squared;
+				}
+				uint32_t stored = field.getSquaredVoxelDistance(x, y, z);
+				if(best < 0 ? stored != DistanceField::Unreachable : stored != (uint32_t)best) {
+					fail("every voxel holds its squared distance to the nearest seed");
+				}
+			}
+		}
+	}
+
+	// the bounds, at random points of the grid
+	for(unsigned int i = 0; i < 20000; ++i) {
+		double p[3], lower, upper;
+		for(unsigned int d = 0; d < 3; ++d) {
+			p[d] = low[d] + (dims[d] * voxel) * unit(rng) * 0.999999;
+		}
+		if(!field.distanceBounds(p, lower, upper)) {
+			fail("points in the grid have bounds");
+			continue;
+		}
+		double distance = mesh.distance(Vector{p[0], p[1], p[2]});
+		if(distance < lower - 1e-9 || distance > upper + 1e-9) {
+			fail("the bounds hold the distance to the mesh");
+		}
+	}
+	double outside[3] = {low[0] - 0.1, low[1], low[2]}, lower, upper;
+	if(field.distanceBounds(outside, lower, upper)) fail("points outside the grid have no bounds");
+
+	// segment verdicts, against a scan of the segment
+	unsigned int verdicts[3] = {0, 0, 0};
+	for(unsigned int i = 0; i < 3000; ++i) {
+		double a[3], b[3];
+		for(unsigned int d = 0; d < 3; ++d) {
+			a[d] = low[d] + (dims[d] * voxel) * unit(rng) * 0.999999;
+			b[d] = std::min(low[d] + dims[d] * voxel - 1e-6, std::max(low[d], a[d] + 1.5 * (unit(rng) - 0.5)));
+		}
+		double radius = 0.3 * unit(rng), coreRadius = i % 2 == 0 ? 0 : 0.8 * unit(rng);
+		DistanceField::SegmentStatus status = field.checkSegment(a, b, radius, coreRadius);
+		verdicts[status]++;
+
+		Vector from{a[0], a[1], a[2]}, to{b[0], b[1], b[2]};
+		double length = sqrt((to - from).dot(to - from)), closest = std::numeric_limits<double>::infinity();
+		unsigned int steps = std::max(1u, (unsigned int)(length / 0.001));
+		for(unsigned int k = 0; k <= steps; ++k) {
+			closest = std::min(closest, mesh.distance(from + (to - from) * ((double)k / steps)));
+		}
+		if(status == DistanceField::Free && closest < radius - 1e-9) fail("free segments keep the radius");
+		if(status == DistanceField::Blocked && closest > coreRadius + 0.001) fail("blocked segments come within the core radius");
+		if(status == DistanceField::Blocked && coreRadius <= 0) fail("a zero core radius never blocks");
+	}
+	if(verdicts[DistanceField::Free] == 0 || verdicts[DistanceField::Blocked] == 0) fail("segments of every verdict");
+
+	// a written field reads back the same
+	FILE *file = tmpfile();
+	DistanceField copy;
+	if(file == NULL || !field.write(file) || fseek(file, 0, SEEK_SET) != 0 || !copy.read(file)) {
+		fail("write and read");
+	} else {
+		for(unsigned int i = 0; i < 2000; ++i) {
+			double p[3], l1, u1, l2, u2;
+			for(unsigned int d = 0; d < 3; ++d) {
+				p[d] = low[d] + (dims[d] * voxel) * unit(rng) * 0.999999;
+			}
+			if(field.distanceBounds(p, l1, u1) != copy.distanceBounds(p, l2, u2) || l1 != l2 || u1 != u2) {
+				fail("a field read back gives the same bounds");
+			}
+		}
+	}
+	if(file != NULL) fclose(file);
+
+	printf("%u seeds in %u x %u x %u voxels, segments %u free, %u blocked, %u unknown\n", (unsigned int)seeds.size() / 3,
+	       dims[0], dims[1], dims[2], verdicts[DistanceField::Free], verdicts[DistanceField::Blocked], verdicts[DistanceField::Unknown]);
+	return finishCheck("distance field");
+}
@@ -0,0 +1,164 @@
+/* Checks every heap in structs against a reference ordered set over random push, pop, peek, sift, remove
+and clear operations: each pop gives the reference's minimum, inHeap agrees with the reference, and
+createFromVector builds a heap that pops the same. Keys are ordered with the item id as a tie breaker, so
+the comparison heaps must pop exactly the reference's item. The radix heap only gets monotone operations
+(nothing pushed or sifted below the last popped key) and its ties come out in any order, so only its keys
+are compared.
+
+  ./HeapCheck [-n operations] [-s seed]
+*/
+
+#include "check.hpp"
+#include "../structs/inplacebinaryheap.hpp"
+#include "../structs/inplacedaryheap.hpp"
+#include "../structs/monotoneradixheap.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+struct Item {
+	double key = 0;
+	unsigned int id = 0;
+	unsigned int heapIndex = std::numeric_limits<unsigned int>::max();
+
+	static bool pred(const Item *a, const Item *b) {
+		return a->key != b->key ? a->key < b->key : a->id < b->id;
+	}
+	static unsigned int getHeapIndex(const Item *r) {
+		return r->heapIndex;
+	}
+	static void setHeapIndex(Item *r, unsigned int i) {
+		r->heapIndex = i;
+	}
+
+	struct HeapKey {
+		double key;
+		unsigned int id;
+		bool operator<(const HeapKey &k) const {
+			return key != k.key ? key < k.key : id < k.id;
+		}
+	};
+	static HeapKey getHeapKey(const Item *r) {
+		HeapKey key = {r->key, r->id};
+		return key;
+	}
+};
+
+// the radix heap's Ops, its keys are plain doubles
+struct RadixItem : Item {
+	static double getHeapKey(const Item *r) {
+		return r->key;
+	}
+};
+
+template <class Heap, class Ops>
+void checkHeap(const char *name, bool monotone, unsigned int operations, unsigned int seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> unit(0, 1);
+
+	const unsigned int itemCount = 2000;
+	std::vector<Item> items(itemCount);
+	for(unsigned int i = 0; i < itemCount; ++i) {
+		items[i].id = i;
+	}
+
+	// the reference, and whether each item is in it
+	std::set<std::pair<double, unsigned int>> reference;
+	std::vector<bool> inReference(itemCount, false);
+	double lastPopped = 0;
+
+	// a key with few distinct values so there are ties, never below the last pop for the radix heap
+	auto drawKey = [&]() {
+		double key = (double)(rng() % 64) / 4;
+		return monotone ? lastPopped + key : key;
+	};
+	auto popsLikeReference = [&](Item *popped) {
+		auto front = *reference.begin();
+		bool ok = monotone ? popped->key == front.first : popped->id == front.second;
+		reference.erase(std::make_pair(popped->key, popped->id));
+		inReference[popped->id] = false;
+		lastPopped = popped->key;
+		return ok;
+	};
+
+	Heap heap;
+	for(unsigned int op = 0; op < operations; ++op) {
+		Item &item = items[rng() % itemCount];
+		unsigned int kind = rng() % 100;
+
+		if(kind < 35) {
+			if(!inReference[item.id]) {
+				item.key = drawKey();
+				heap.push(&item);
+				reference.insert(std::make_pair(item.key, item.id));
+				inReference[item.id] = true;
+			}
+		} else if(kind < 60) {
+			if(!expect(heap.isEmpty() == reference.empty(), "%s: empty when the reference is", name)) return;
+			if(!heap.isEmpty()) {
+				Item *peeked = heap.peek();
+				Item *popped = heap.pop();
+				expect(peeked == popped, "%s: peek gives what pop gives", name);
+				expect(popsLikeReference(popped), "%s: pop gives the minimum (operation %u)", name, op);
+				expect(!heap.inHeap(popped), "%s: a popped item is out of the heap", name);
+			}
+		} else if(kind < 80) {
+			if(inReference[item.id]) {
+				reference.erase(std::make_pair(item.key, item.id));
+				item.key = monotone ? std::max(lastPopped, item.key + (unit(rng) - 0.5) * 4) : drawKey();
+				heap.siftFromItem(&item);
+				reference.insert(std::make_pair(item.key, item.id));
+			}
+		} else if(kind < 92) {
+			if(inReference[item.id]) {
+				heap.remove(&item);
+				reference.erase(std::make_pair(item.key, item.id));
+				inReference[item.id] = false;
+				expect(!heap.inHeap(&item), "%s: a removed item is out of the heap", name);
+			}
+		} else if(kind < 99) {
+			expect(heap.inHeap(&item) == inReference[item.id], "%s: inHeap agrees with the reference", name);
+			expect(heap.getFill() == (int)reference.size(), "%s: the fill is the reference's size", name);
+		} else if(op % 7 == 0) {
+			// the heaps leave indices alone on clear, so the items are handed new ones by rebuilding
+			std::vector<Item *> rest;
+			for(auto &entry : reference) {
+				rest.push_back(&items[entry.second]);
+			}
+			heap.clear();
+			heap.createFromVector(rest);
+			expect(heap.getFill() == (int)reference.size(), "%s: createFromVector takes every item", name);
+		}
+	}
+
+	while(!heap.isEmpty()) {
+		if(!expect(popsLikeReference(heap.pop()), "%s: draining pops the minimum", name)) return;
+	}
+	expect(reference.empty(), "%s: drained with the reference", name);
+}
+
+int main(int argc, char **argv) {
+	unsigned int operations = 300000, seed = 1;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			operations = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n operations] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	checkHeap<InPlaceBinaryHeap<Item, Item>, Item>("binary", false, operations, seed);
+	checkHeap<InPlaceDaryHeap<Item, Item, 2>, Item>("2-ary", false, operations, seed);
+	checkHeap<InPlaceDaryHeap<Item, Item, 4>, Item>("4-ary", false, operations, seed);
+	checkHeap<InPlaceDaryHeap<Item, Item, 8>, Item>("8-ary", false, operations, seed);
+	checkHeap<MonotoneRadixHeap<Item, RadixItem>, RadixItem>("radix", true, operations, seed);
+	return finishCheck("heap");
+}
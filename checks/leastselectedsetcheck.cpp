@@ -0,0 +1,142 @@
+/* Checks LeastSelectedSet (structs/leastselectedset.hpp) against a brute force count per item over random
+add (new or with a count, as BeastSamplerBase's remap re-adds), remove by handle and by pointer, select,
+selectLeast, selectMost and clear: the least and most selected buckets hold exactly the items with the
+smallest and largest count, every handle gives its item and count, and forEach walks every item once in
+ascending count order.
+
+  ./LeastSelectedSetCheck [-n operations] [-s seed]
+*/
+
+#include "check.hpp"
+#include "../structs/leastselectedset.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+struct Item {
+	unsigned int name;
+};
+
+typedef LeastSelectedSet<Item> Set;
+
+int main(int argc, char **argv) {
+	unsigned int operations = 400000, seed = 1;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			operations = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n operations] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	const unsigned int itemCount = 500;
+	std::vector<Item> items(itemCount);
+	for(unsigned int i = 0; i < itemCount; ++i) items[i].name = i;
+
+	// the reference: each item's count and handle while it is in the set
+	std::map<Item *, unsigned int> counts;
+	std::map<Item *, Set::Handle> handles;
+	auto extreme = [&](bool least) {
+		unsigned int best = least ? Set::None : 0;
+		for(auto &count : counts) best = least ? std::min(best, count.second) : std::max(best, count.second);
+		return best;
+	};
+	auto randomMember = [&]() {
+		auto it = counts.begin();
+		std::advance(it, rng() % counts.size());
+		return it->first;
+	};
+
+	Set set;
+	for(unsigned int op = 0; op < operations; ++op) {
+		unsigned int kind = rng() % 1000;
+		Item *item = &items[rng() % itemCount];
+
+		if(kind < 300) {
+			if(counts.count(item) == 0) {
+				unsigned int selected = rng() % 2 == 0 ? 0 : rng() % 8;
+				handles[item] = set.add(item, selected);
+				counts[item] = selected;
+			}
+		} else if(kind < 400) {
+			bool member = counts.count(item) > 0;
+			expect(set.remove(item) == member, "removing by pointer tells whether the item was in the set");
+			counts.erase(item);
+			handles.erase(item);
+		} else if(kind < 450) {
+			if(!counts.empty()) {
+				Item *member = randomMember();
+				set.remove(handles[member]);
+				counts.erase(member);
+				handles.erase(member);
+			}
+		} else if(kind < 650) {
+			if(!counts.empty()) {
+				Item *member = randomMember();
+				expect(set.select(handles[member]) == member, "select hands back the item");
+				counts[member]++;
+			}
+		} else if(kind < 850) {
+			if(!counts.empty()) {
+				unsigned int least = extreme(true);
+				Item *picked = set.selectLeast();
+				expect(counts.count(picked) && counts[picked] == least, "selectLeast picks an item with the smallest count");
+				counts[picked]++;
+			}
+		} else if(kind < 900) {
+			if(!counts.empty()) {
+				unsigned int most = extreme(false);
+				Item *picked = set.selectMost();
+				expect(counts.count(picked) && counts[picked] == most, "selectMost picks an item with the largest count");
+				counts[picked]++;
+			}
+		} else if(kind < 999) {
+			expect(set.size() == counts.size() && set.empty() == counts.empty(), "the size is the reference's");
+			expect(set.getHandle(item) == (counts.count(item) ? handles[item] : Set::None), "getHandle finds members only");
+			if(counts.empty()) continue;
+
+			for(bool least : {true, false}) {
+				unsigned int count = extreme(least), members = 0;
+				for(auto &entry : counts) members += entry.second == count;
+				const auto &bucket = least ? set.leastSelected() : set.mostSelected();
+				bool exact = bucket.size() == members;
+				for(Set::Handle handle : bucket) exact = exact && counts[set.get(handle)] == count;
+				expect(exact, "the %s selected bucket holds exactly the items with that count", least ? "least" : "most");
+			}
+
+			bool handlesAgree = true;
+			for(auto &entry : handles) {
+				handlesAgree = handlesAgree && set.get(entry.second) == entry.first && set.getSelected(entry.second) == counts[entry.first];
+			}
+			expect(handlesAgree, "every handle gives its item and count");
+
+			std::map<Item *, unsigned int> seen;
+			unsigned int previous = 0;
+			bool ascending = true;
+			set.forEach([&](Item *member, unsigned int selected) {
+				ascending = ascending && selected >= previous;
+				previous = selected;
+				seen[member] += 1;
+				ascending = ascending && counts.count(member) && counts[member] == selected;
+			});
+			bool once = seen.size() == counts.size();
+			for(auto &entry : seen) once = once && entry.second == 1;
+			expect(ascending && once, "forEach visits every item once, in ascending count order");
+		} else {
+			set.clear();
+			counts.clear();
+			handles.clear();
+		}
+	}
+
+	return finishCheck("least selected set");
+}
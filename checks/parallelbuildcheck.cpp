@@ -0,0 +1,145 @@
+/* Checks the chunked sampling behind PRMLite::sampleVertices (ThreadPool::parallelForChunks) without OMPL:
+every index in [from, to) is written by exactly one chunk, a chunk's checker is never used by two threads at
+once, samplers stop at their attempt limit, and the vertices come out the same on every run and the same as
+running the chunks one after another.
+
+  ./ParallelBuildCheck [-r repetitions]
+*/
+
+#include "check.hpp"
+#include "../structs/threadpool.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// stands in for a validity checker, counts how many threads are inside it
+struct Checker {
+	Checker() : inside(0), overlaps(0) {}
+
+	bool isValid(double x, double y) {
+		if(inside++ != 0) overlaps++;
+		bool valid = !blockEverything && (x - 0.5) * (x - 0.5) + (y - 0.5) * (y - 0.5) > 0.1;
+		inside--;
+		return valid;
+	}
+
+	std::atomic<int> inside, overlaps;
+	bool blockEverything = false;
+};
+
+// stands in for OMPL's UniformValidStateSampler: a bounded number of tries, the last one is kept on failure
+struct Sampler {
+	Sampler(Checker &checker, unsigned int seed) : checker(checker), rng(seed) {}
+
+	bool sample(double *point) {
+		std::uniform_real_distribution<double> uniform(0, 1);
+		for(unsigned int attempt = 0; attempt < Attempts; ++attempt) {
+			point[0] = uniform(rng);
+			point[1] = uniform(rng);
+			tries++;
+			if(checker.isValid(point[0], point[1])) return true;
+		}
+		return false;
+	}
+
+	static const unsigned int Attempts = 100;
+	Checker &checker;
+	std::mt19937 rng;
+	unsigned int tries = 0;
+};
+
+struct Result {
+	std::vector<double> points;
+	std::vector<unsigned int> writes;
+	unsigned int overlaps = 0;
+	unsigned int maxTries = 0;
+};
+
+// what sampleVertices does, with a pool or (sequential) the chunks run in order on this thread
+Result sampleVertices(ThreadPool &pool, unsigned int from, unsigned int to, bool blockEverything, bool sequential) {
+	unsigned int chunks = pool.getThreadCount();
+	std::vector<Checker> checkers(chunks);
+	std::vector<Sampler> samplers;
+	std::mt19937 seeds(1);
+	for(unsigned int i = 0; i < chunks; ++i) {
+		checkers[i].blockEverything = blockEverything;
+		samplers.emplace_back(checkers[i], seeds());
+	}
+
+	Result result;
+	result.points.assign(2 * to, -1);
+	result.writes.assign(to, 0);
+	std::vector<std::atomic<unsigned int>> writes(to);
+	for(auto &w : writes) w = 0;
+
+	auto work = [&](unsigned int chunk, unsigned int first, unsigned int last, unsigned int) {
+		for(unsigned int i = first; i < last; ++i) {
+			samplers[chunk].sample(&result.points[2 * i]);
+			writes[i]++;
+		}
+	};
+
+	if(sequential) {
+		unsigned int chunkSize = to > from ? (to - from + chunks - 1) / chunks : 0;
+		for(unsigned int chunk = 0; chunk < chunks; ++chunk) {
+			unsigned int first = std::min(to, from + chunk * chunkSize);
+			unsigned int last = std::min(to, first + chunkSize);
+			work(chunk, first, last, 0);
+		}
+	} else {
+		pool.parallelForChunks(from, to, work);
+	}
+
+	for(unsigned int i = 0; i < to; ++i) {
+		result.writes[i] = writes[i];
+	}
+	for(unsigned int i = 0; i < chunks; ++i) {
+		result.overlaps += checkers[i].overlaps;
+		result.maxTries = std::max(result.maxTries, samplers[i].tries);
+	}
+	return result;
+}
+
+int main(int argc, char **argv) {
+	unsigned int repetitions = 20;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			repetitions = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-r repetitions]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	const unsigned int ranges[][2] = {{2, 2000}, {2, 2}, {2, 4}, {100, 103}, {0, 1}, {500, 1501}};
+	for(unsigned int threads : {1u, 2u, 3u, 4u, 8u}) {
+		ThreadPool pool(threads);
+		for(auto range : ranges) {
+			unsigned int from = range[0], to = range[1];
+			Result expected = sampleVertices(pool, from, to, false, true);
+
+			for(unsigned int r = 0; r < repetitions; ++r) {
+				Result result = sampleVertices(pool, from, to, false, false);
+				bool once = true;
+				for(unsigned int i = 0; i < to; ++i) {
+					once = once && result.writes[i] == (i >= from ? 1u : 0u);
+				}
+				expect(once, "every vertex sampled exactly once (%u threads, [%u, %u))", threads, from, to);
+				expect(result.points == expected.points, "same vertices as the chunks run in order (%u threads, [%u, %u))",
+				       threads, from, to);
+				expect(result.overlaps == 0, "no checker used by two threads at once (%u threads, [%u, %u))", threads, from, to);
+			}
+
+			Result blocked = sampleVertices(pool, from, to, true, false);
+			unsigned int perChunk = to > from ? (to - from + threads - 1) / threads : 0;
+			expect(blocked.maxTries == perChunk * Sampler::Attempts, "attempt limit with no valid states (%u threads, [%u, %u))",
+			       threads, from, to);
+		}
+	}
+
+	return finishCheck("parallel build");
+}
@@ -0,0 +1,124 @@
+/* Checks the probability density function (structs/probabilitydensityfunction.hpp) that the FBiased
+samplers draw from, with a stand in for OMPL's RNG: random add, update and remove sequences keep the
+subtree sums (checkInvariant) and the ids in step with a plain array, and the samples of the final weights
+come out in proportion to them, zero weights never.
+
+  ./PDFCheck [-n operations] [-d draws] [-s seed]
+*/
+
+#undef NDEBUG
+
+#include "check.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace ompl {
+class RNG {
+public:
+	double uniform01() {
+		return unit(rng);
+	}
+
+	static unsigned int seed;
+
+private:
+	std::mt19937 rng{seed++};
+	std::uniform_real_distribution<double> unit{0, 1};
+};
+unsigned int RNG::seed = 1;
+}
+
+#include "../structs/probabilitydensityfunction.hpp"
+
+struct Data {
+	unsigned int name;
+};
+
+int main(int argc, char **argv) {
+	unsigned int operations = 200000, draws = 2000000;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			operations = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			draws = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			ompl::RNG::seed = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n operations] [-d draws] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(ompl::RNG::seed);
+	std::uniform_real_distribution<double> unit(0, 1);
+	auto drawWeight = [&]() {
+		return rng() % 8 == 0 ? 0 : 10 * unit(rng);
+	};
+
+	// the elements by id (1 based like the pdf's) and their weights
+	std::vector<Data> data(operations + 1);
+	std::vector<Data *> byId(1, NULL);
+	std::vector<double> weights(1, 0);
+
+	ProbabilityDensityFunction<Data> pdf;
+	unsigned int added = 0;
+	for(unsigned int op = 0; op < operations; ++op) {
+		unsigned int kind = rng() % 100;
+		unsigned int id = byId.size() > 1 ? 1 + rng() % (byId.size() - 1) : 0;
+
+		// grow to a few hundred elements, then hover there
+		if(id == 0 || kind < (byId.size() < 300 ? 50u : 25u)) {
+			Data *d = &data[added];
+			d->name = added++;
+			double weight = drawWeight();
+			auto element = pdf.add(d, weight);
+			byId.push_back(d);
+			weights.push_back(weight);
+			expect(element->getData() == d && element->getId() == byId.size() - 1, "add hands back the new element at the end");
+		} else if(kind < 70) {
+			double weight = drawWeight();
+			auto element = pdf.update(id, weight);
+			weights[id] = weight;
+			expect(element->getData() == byId[id] && element->getId() == id, "update hands back the element it changed");
+		} else {
+			auto element = pdf.remove(id);
+			byId[id] = byId.back();
+			weights[id] = weights.back();
+			byId.pop_back();
+			weights.pop_back();
+			if(id < byId.size()) {
+				expect(element != NULL && element->getData() == byId[id] && element->getId() == id,
+				       "remove moves the last element into the hole");
+			} else {
+				expect(element == NULL, "removing the last element hands back nothing");
+			}
+		}
+		expect(pdf.size() == byId.size() - 1, "the size follows adds and removes");
+		pdf.checkInvariant();
+	}
+
+	// the final weights, sampled: every element within five standard deviations of its expected count
+	double total = 0;
+	for(double weight : weights) total += weight;
+	std::vector<unsigned int> counts(added, 0);
+	for(unsigned int i = 0; i < draws && total > 0; ++i) {
+		counts[pdf.sample()->name]++;
+	}
+	for(unsigned int id = 1; id < byId.size() && total > 0; ++id) {
+		double p = weights[id] / total, expected = draws * p;
+		unsigned int count = counts[byId[id]->name];
+		if(weights[id] == 0) {
+			expect(count == 0, "zero weight element %u is never sampled", id);
+		} else {
+			expect(std::fabs(count - expected) <= 5 * sqrt(expected * (1 - p)) + 1, "element %u sampled %u times, expected %g",
+			       id, count, expected);
+		}
+	}
+
+	printf("%u elements after %u operations, %u draws\n", pdf.size(), operations, draws);
+	return finishCheck("probability density function");
+}
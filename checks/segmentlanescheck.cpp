@@ -0,0 +1,133 @@
+/* Checks the Linkage domain's SegmentLanes (domains/detail/segmentlanes.hpp) against the scalar
+segmentsIntersect on random chains built the way KinematicChainValidityChecker::isValid builds them and on
+random environments, some with segments touching the chain's or nearly parallel to it: anyIntersection
+agrees with segmentsIntersect over every block and first index, and intersectsItself and intersects agree
+with testing every pair, so skipping consecutive links loses nothing.
+
+  ./SegmentLanesCheck [-n chains] [-s seed]
+*/
+
+#include "check.hpp"
+#include "../domains/detail/segmentlanes.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// what the checker tested before SegmentLanes: every pair of links, consecutive ones included
+bool selfIntersectionScalar(const std::vector<Segment> &chain) {
+	for(unsigned int i = 0; i < chain.size(); ++i)
+		for(unsigned int j = i + 1; j < chain.size(); ++j)
+			if(segmentsIntersect(chain[i], chain[j])) return true;
+	return false;
+}
+
+bool environmentIntersectionScalar(const std::vector<Segment> &chain, const std::vector<Segment> &env) {
+	for(const Segment &link : chain)
+		for(const Segment &segment : env)
+			if(segmentsIntersect(link, segment)) return true;
+	return false;
+}
+
+SegmentLanes toLanes(const std::vector<Segment> &segments) {
+	SegmentLanes lanes;
+	lanes.resize(segments.size());
+	for(unsigned int i = 0; i < segments.size(); ++i) lanes.set(i, segments[i]);
+	lanes.computeBoxes();
+	return lanes;
+}
+
+// anyIntersection for segment i of from against every block and first index of to
+void checkBlocks(const std::vector<Segment> &from, const SegmentLanes &fromLanes, unsigned int i,
+                 const std::vector<Segment> &to, const SegmentLanes &toLanes, unsigned int chain) {
+	for(unsigned int b = 0; b < toLanes.blockCount(); ++b) {
+		unsigned int base = b * SegmentLanes::Lanes;
+		for(unsigned int first = base; first <= base + SegmentLanes::Lanes; ++first) {
+			bool scalar = false;
+			for(unsigned int j = first; j < base + SegmentLanes::Lanes && j < to.size(); ++j)
+				scalar = scalar || segmentsIntersect(from[i], to[j]);
+			if(toLanes.anyIntersection(fromLanes, i, b, first) != scalar) {
+				fail("anyIntersection of segment %u against block %u from %u is %d, segmentsIntersect says %d (chain %u)",
+				     i, b, first, !scalar, scalar, chain);
+				return;
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned int chains = 200000, seed = 1;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			chains = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n chains] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> unit(0, 1);
+	const double pi = 3.14159265358979323846;
+
+	unsigned int selfHits = 0, environmentHits = 0;
+	for(unsigned int c = 0; c < chains; ++c) {
+		// n links with accumulated angles, mostly small turns so not every chain folds onto itself, then
+		// the short tip segment
+		unsigned int n = 2 + rng() % 30;
+		double linkLength = 1. / n, spread = unit(rng) < 0.5 ? 0.5 : 2 * pi;
+		double theta = 0., x = 0., y = 0., xN, yN;
+		std::vector<Segment> chain;
+		for(unsigned int i = 0; i < n; ++i) {
+			theta += (unit(rng) - 0.5) * spread;
+			xN = x + cos(theta) * linkLength;
+			yN = y + sin(theta) * linkLength;
+			chain.push_back(Segment(x, y, xN, yN));
+			x = xN;
+			y = yN;
+		}
+		chain.push_back(Segment(x, y, x + cos(theta) * 0.001, y + sin(theta) * 0.001));
+
+		// random walls, some starting on a joint of the chain, some nearly parallel to a link, some degenerate
+		std::vector<Segment> env;
+		unsigned int walls = rng() % 20;
+		for(unsigned int w = 0; w < walls; ++w) {
+			const Segment &link = chain[rng() % chain.size()];
+			unsigned int kind = rng() % 4;
+			double x0 = unit(rng) * 2 - 1, y0 = unit(rng) * 2 - 1;
+			if(kind == 0) {
+				env.push_back(Segment(x0, y0, unit(rng) * 2 - 1, unit(rng) * 2 - 1));
+			} else if(kind == 1) {
+				env.push_back(Segment(link.x1, link.y1, x0, y0));
+			} else if(kind == 2) {
+				double tilt = (unit(rng) - 0.5) * 1e-6;
+				double dx = link.x1 - link.x0, dy = link.y1 - link.y0;
+				env.push_back(Segment(link.x0 + dy * 0.01, link.y0 - dx * 0.01,
+				                      link.x1 + dy * tilt, link.y1 - dx * tilt));
+			} else {
+				env.push_back(Segment(x0, y0, x0, y0));
+			}
+		}
+
+		SegmentLanes chainLanes = toLanes(chain), envLanes = toLanes(env);
+		for(unsigned int i = 0; i < chain.size(); ++i) {
+			checkBlocks(chain, chainLanes, i, chain, chainLanes, c);
+			checkBlocks(chain, chainLanes, i, env, envLanes, c);
+		}
+
+		bool self = selfIntersectionScalar(chain), environment = environmentIntersectionScalar(chain, env);
+		expect(chainLanes.intersectsItself() == self, "intersectsItself is %d, the pairwise test says %d (chain %u)",
+		       !self, self, c);
+		expect(chainLanes.intersects(envLanes) == environment, "intersects is %d, the pairwise test says %d (chain %u)",
+		       !environment, environment, c);
+		selfHits += self;
+		environmentHits += environment;
+	}
+
+	printf("%u chains, %u intersect themselves, %u the environment\n", chains, selfHits, environmentHits);
+	return finishCheck("segment lanes");
+}
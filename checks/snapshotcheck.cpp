@@ -0,0 +1,121 @@
+/* Checks abstraction snapshots (samplers/abstractions/snapshot.hpp) without OMPL: what is written maps
+back unchanged, a snapshot is only taken for the key it was written under (and not when cut short), and
+the key moves with every input PRMLite hashes through the Hasher, including instance keys that are
+missing and each of the validity settings.
+
+  ./SnapshotCheck [directory]      (default /tmp)
+*/
+
+#include "check.hpp"
+#include "../samplers/abstractions/snapshot.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+template <class T>
+bool sameSection(const AbstractionSnapshot &snapshot, AbstractionSnapshot::Section section, const std::vector<T> &values) {
+	const T *mapped = snapshot.getSection<T>(section);
+	for(size_t i = 0; i < values.size(); ++i) {
+		if(mapped[i] != values[i]) return false;
+	}
+	return true;
+}
+
+const std::vector<std::string> keys = { "Domain", "AgentMesh", "EnvironmentMesh", "Seed", "AbstractionThreads" };
+
+uint64_t getKey(const std::string &instance, const AbstractionSnapshot::Validity &validity) {
+	std::istringstream stream(instance);
+	FileMap params(stream);
+	AbstractionSnapshot::Hasher hasher;
+	hasher.add(params, keys);
+	hasher.add(validity);
+	return hasher.get();
+}
+
+int main(int argc, char **argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+	// a small roadmap: three vertices in 2D, a triangle of edges
+	AbstractionSnapshot::Contents contents;
+	contents.dimension = 2;
+	contents.prmSize = 3;
+	contents.states = { 0, 0, 1, 0.5, -2, 3.25 };
+	contents.edgeOffsets = { 0, 2, 4, 6 };
+	contents.edgeTargets = { 1, 2, 0, 2, 0, 1 };
+	contents.edgeStatuses = { 1, 2, 1, 0, 2, 0 };
+	contents.neighborOffsets = { 0, 1, 2, 3 };
+	contents.neighborTargets = { 1, 0, 0 };
+	contents.kthNeighborDistance = { 1.1, 1.1, 3.6 };
+
+	const uint64_t key = 0x0123456789abcdefULL;
+	std::string path = AbstractionSnapshot::getPath(directory, key);
+	expect(AbstractionSnapshot::write(path, key, contents), "write");
+
+	{
+		AbstractionSnapshot snapshot;
+		expect(snapshot.map(path, key), "map what was written");
+		const AbstractionSnapshot::Header &header = snapshot.getHeader();
+		expect(header.dimension == 2 && header.prmSize == 3 && header.vertexCount == 3 && header.edgeCount == 6 &&
+		       header.neighborCount == 3, "header round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::States, contents.states), "states round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::EdgeOffsets, contents.edgeOffsets), "edge offsets round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::EdgeTargets, contents.edgeTargets), "edge targets round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::EdgeStatuses, contents.edgeStatuses), "edge statuses round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::NeighborOffsets, contents.neighborOffsets), "neighbor offsets round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::NeighborTargets, contents.neighborTargets), "neighbor targets round trip");
+		expect(sameSection(snapshot, AbstractionSnapshot::KthNeighborDistance, contents.kthNeighborDistance), "k-th distances round trip");
+
+		expect(!snapshot.map(path, key + 1), "a different key misses");
+	}
+
+	{
+		FILE *file = fopen(path.c_str(), "r+b");
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+		expect(truncate(path.c_str(), size - 8) == 0, "truncate");
+		AbstractionSnapshot snapshot;
+		expect(!snapshot.map(path, key), "a cut short snapshot misses");
+		remove(path.c_str());
+		expect(!snapshot.map(path, key), "a missing snapshot misses");
+	}
+
+	// instances without AgentMesh (acrobot, robot arm) hash fine, and differ from one that sets it empty
+	std::string instance = "Domain ? Acrobot\nSeed ? 1\n";
+	AbstractionSnapshot::Validity validity;
+	validity.checkingResolution = 0.01;
+	uint64_t base = getKey(instance, validity);
+	expect(base == getKey(instance, validity), "the key is stable");
+	expect(base != getKey(instance + "AgentMesh ?\n", validity), "a missing key differs from an empty one");
+	expect(base != getKey("Domain ? Acrobot\nSeed ? 2\n", validity), "the seed changes the key");
+	expect(base == getKey(instance + "PRMResizeFactor ? 3\n", validity), "keys outside the list don't change the key");
+
+	AbstractionSnapshot::Validity changed = validity;
+	changed.checkingResolution = 0.005;
+	expect(base != getKey(instance, changed), "the validity checking resolution changes the key");
+	changed = validity;
+	changed.cacheResolution = 0.1;
+	expect(base != getKey(instance, changed), "the validity cache resolution changes the key");
+	changed = validity;
+	changed.cacheRotationResolution = 0.02;
+	expect(base != getKey(instance, changed), "the validity cache rotation resolution changes the key");
+	changed = validity;
+	changed.cacheConservative = false;
+	expect(base != getKey(instance, changed), "a non conservative validity cache changes the key");
+	changed = validity;
+	changed.cacheInvalidCells = true;
+	expect(base != getKey(instance, changed), "invalid validity cache cells change the key");
+	changed = validity;
+	changed.continuousMotionValidation = true;
+	expect(base != getKey(instance, changed), "continuous motion validation changes the key");
+	changed = validity;
+	changed.distanceFieldVoxelSize = 0.25;
+	expect(base != getKey(instance, changed), "a distance field changes the key");
+	AbstractionSnapshot::Validity withField = changed;
+	changed.distanceFieldCoreRadius = 0.1;
+	expect(getKey(instance, withField) != getKey(instance, changed), "the distance field's core radius changes the key");
+
+	return finishCheck("snapshot");
+}
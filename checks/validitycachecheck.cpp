@@ -0,0 +1,210 @@
+/* Checks the collision result cache (structs/validitycache.hpp) without OMPL or FCL, with a made up check
+standing in for FCL: a stick robot among disc obstacles in the plane, or its tip in space.
+
+With the default settings every answer through the cache must equal the check's, single threaded and with
+threads sharing one cache, and repeated poses must hit. The lossy cell modes may only err in the direction
+they document (invalid cells never accept a colliding pose, valid cells never reject a free one), and
+clearValidityCaches must make the old entries unreachable.
+
+  ./ValidityCacheCheck [-n queries]
+*/
+
+#include "check.hpp"
+#include "../structs/validitycache.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Obstacle {
+	double x, y, z, radius;
+};
+
+std::vector<Obstacle> obstacles;
+
+bool pointFree(double x, double y, double z) {
+	for(const Obstacle &o : obstacles) {
+		if((x - o.x) * (x - o.x) + (y - o.y) * (y - o.y) + (z - o.z) * (z - o.z) < o.radius * o.radius) return false;
+	}
+	return true;
+}
+
+// a stick of length 0.5 from (x, y) along yaw, free if its base and tip are
+bool check2D(double x, double y, double yaw) {
+	return pointFree(x, y, 0) && pointFree(x + 0.5 * cos(yaw), y + 0.5 * sin(yaw), 0);
+}
+
+// the tip of a stick of length 0.5 along the rotated x axis, the same for q and -q
+bool check3D(const double *values) {
+	double x = values[3], y = values[4], z = values[5], w = values[6];
+	double tip[3] = {1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w)};
+	return pointFree(values[0], values[1], values[2]) &&
+	       pointFree(values[0] + 0.5 * tip[0], values[1] + 0.5 * tip[1], values[2] + 0.5 * tip[2]);
+}
+
+struct Query {
+	double values[7];
+	bool spatial;
+
+	ValidityCache::Pose getPose() const {
+		if(spatial) return ValidityCache::Pose(values[0], values[1], values[2], values[3], values[4], values[5], values[6]);
+		return ValidityCache::Pose(values[0], values[1], values[2]);
+	}
+
+	bool check() const {
+		return spatial ? check3D(values) : check2D(values[0], values[1], values[2]);
+	}
+};
+
+// what FCLStateValidityChecker::isValid does with a cache
+bool cachedCheck(ValidityCache &cache, const Query &query) {
+	ValidityCache::Pose pose = query.getPose();
+	ValidityCache::Result cached = cache.lookup(pose);
+	if(cached != ValidityCache::Unknown) return cached == ValidityCache::Valid;
+	bool valid = query.check();
+	cache.store(pose, valid);
+	return valid;
+}
+
+// a pool of poses drawn again and again, with neighbors a little off them (same cell, different pose) and
+// quaternions flipped to -q
+std::vector<Query> makeQueries(unsigned int count, std::mt19937 &rng) {
+	std::uniform_real_distribution<double> unit(0, 1);
+	std::normal_distribution<double> normal(0, 1);
+	std::vector<Query> pool(count / 8 + 1);
+	for(Query &q : pool) {
+		q.spatial = unit(rng) < 0.5;
+		for(unsigned int d = 0; d < 3; ++d) q.values[d] = 10 * unit(rng);
+		if(q.spatial) {
+			double n = 0;
+			for(unsigned int d = 3; d < 7; ++d) {
+				q.values[d] = normal(rng);
+				n += q.values[d] * q.values[d];
+			}
+			for(unsigned int d = 3; d < 7; ++d) q.values[d] /= sqrt(n);
+		} else {
+			q.values[2] = 2 * M_PI * unit(rng) - M_PI;
+		}
+	}
+
+	std::vector<Query> queries;
+	for(unsigned int i = 0; i < count; ++i) {
+		Query q = pool[rng() % pool.size()];
+		double kind = unit(rng);
+		if(kind < 0.3) {
+			for(unsigned int d = 0; d < 2; ++d) q.values[d] += 1e-3 * (unit(rng) - 0.5);
+		} else if(kind < 0.4 && q.spatial) {
+			for(unsigned int d = 3; d < 7; ++d) q.values[d] = -q.values[d];
+		}
+		queries.push_back(q);
+	}
+	return queries;
+}
+
+int main(int argc, char **argv) {
+	unsigned int count = 200000;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-n queries]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> unit(0, 1);
+	for(unsigned int i = 0; i < 30; ++i) {
+		obstacles.push_back(Obstacle{10 * unit(rng), 10 * unit(rng), 10 * unit(rng), 0.3 + unit(rng)});
+	}
+	std::vector<Query> queries = makeQueries(count, rng);
+
+	// coarse cells, so the lossy modes would show up if they leaked into the default
+	ValidityCacheSettings settings;
+	settings.resolution = 0.5;
+	settings.rotationResolution = 0.5;
+	settings.log2Size = 16;
+
+	{
+		ValidityCache cache(settings);
+		validityCacheCounters.reset();
+		unsigned int wrong = 0;
+		for(const Query &q : queries) {
+			if(cachedCheck(cache, q) != q.check()) wrong++;
+		}
+		ValidityCacheCounts counts = validityCacheCounters.get();
+		expect(wrong == 0, "a hit gives what the check gives");
+		expect(counts.hits > count / 4, "repeated poses hit");
+		printf("default: %llu hits, %llu misses, %u wrong\n", (unsigned long long)counts.hits, (unsigned long long)counts.misses, wrong);
+	}
+
+	{
+		// a few rounds of new threads, like the per run pools: the counts of exited threads are kept and
+		// their copies reused
+		ValidityCache cache(settings);
+		const unsigned int threads = 4, rounds = 3;
+		std::vector<unsigned int> wrong(threads, 0);
+		validityCacheCounters.reset();
+		for(unsigned int round = 0; round < rounds; ++round) {
+			std::vector<std::thread> workers;
+			for(unsigned int t = 0; t < threads; ++t) {
+				workers.emplace_back([&, t] {
+					for(unsigned int i = t; i < queries.size(); i += threads) {
+						if(cachedCheck(cache, queries[i]) != queries[i].check()) wrong[t]++;
+					}
+				});
+			}
+			for(auto &worker : workers) worker.join();
+		}
+		unsigned int total = 0;
+		for(unsigned int w : wrong) total += w;
+		expect(total == 0, "a hit gives what the check gives with threads sharing the cache");
+		ValidityCacheCounts counts = validityCacheCounters.get();
+		expect(counts.hits + counts.misses == rounds * queries.size(), "the counts of exited threads are kept");
+		expect(validityCacheCounters.size() <= threads + 1, "exited threads' counters are reused (%u for %u threads)",
+		       validityCacheCounters.size(), threads);
+	}
+
+	{
+		ValidityCacheSettings invalidCells = settings;
+		invalidCells.invalidCells = true;
+		ValidityCache cache(invalidCells);
+		unsigned int accepted = 0, rejected = 0;
+		for(const Query &q : queries) {
+			bool cached = cachedCheck(cache, q), truth = q.check();
+			if(cached && !truth) accepted++;
+			if(!cached && truth) rejected++;
+		}
+		expect(accepted == 0, "invalid cells never accept a colliding pose");
+		printf("invalid cells: %u free poses rejected\n", rejected);
+	}
+
+	{
+		ValidityCacheSettings validCells = settings;
+		validCells.conservative = false;
+		ValidityCache cache(validCells);
+		unsigned int accepted = 0, rejected = 0;
+		for(const Query &q : queries) {
+			bool cached = cachedCheck(cache, q), truth = q.check();
+			if(cached && !truth) accepted++;
+			if(!cached && truth) rejected++;
+		}
+		expect(rejected == 0, "valid cells never reject a free pose");
+		printf("valid cells: %u colliding poses accepted\n", accepted);
+	}
+
+	{
+		ValidityCache cache(settings);
+		ValidityCache::Pose pose = queries[0].getPose();
+		cache.store(pose, queries[0].check());
+		expect(cache.lookup(pose) != ValidityCache::Unknown, "a stored pose is found");
+		clearValidityCaches();
+		expect(cache.lookup(pose) == ValidityCache::Unknown, "clearing the caches forgets it");
+	}
+
+	return finishCheck("validity cache");
+}
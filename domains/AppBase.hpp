@@ -14,6 +14,7 @@
 #define OMPLAPP_APP_BASE_
 
 #include "geometry/RigidBodyGeometry.hpp"
+#include "geometry/detail/FCLContinuousMotionValidator.hpp"
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/control/SimpleSetup.h>
 #include "detail/appUtil.hpp"
@@ -96,6 +97,10 @@ public:
 		if(AppTypeSelector<T>::SimpleSetup::si_->getStateValidityChecker() != svc)
 			AppTypeSelector<T>::SimpleSetup::si_->setStateValidityChecker(svc);
 
+		if(fclContinuousMotionValidation && ctype_ == FCL)
+			AppTypeSelector<T>::SimpleSetup::si_->setMotionValidator(
+			    base::MotionValidatorPtr(new FCLContinuousMotionValidator(AppTypeSelector<T>::SimpleSetup::si_.get(), svc, mtype_)));
+
 		AppTypeSelector<T>::SimpleSetup::getStateSpace()->setup();
 
 		if(!AppTypeSelector<T>::SimpleSetup::getStateSpace()->hasDefaultProjection())
@@ -14,8 +14,8 @@
 #define OMPLAPP_BLIMP_PLANNING_
 
 #include "AppBase.hpp"
+#include "detail/odePropagator.hpp"
 #include <ompl/base/spaces/SE3StateSpace.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 
 namespace ompl {
@@ -33,12 +33,15 @@ namespace app {
 */
 class BlimpPlanning : public AppBase<CONTROL> {
 public:
+	// dimensions of the ode, see detail/odePropagator.hpp
+	static const unsigned int StateDimension = 11, ControlDimension = 3;
+
 	BlimpPlanning()
-		: AppBase<CONTROL>(constructControlSpace(), Motion_3D), timeStep_(1e-2), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&BlimpPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(constructControlSpace(), Motion_3D), timeStep_(1e-2) {
 		name_ = std::string("Blimp");
 		setDefaultBounds();
 
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&BlimpPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<BlimpPlanning>(si_, this)));
 	}
 	~BlimpPlanning() {
 	}
@@ -103,6 +106,7 @@ public:
 	}
 
 protected:
+	friend class detail::ODEPropagator<BlimpPlanning>;
 
 	virtual const base::State *getGeometricComponentStateInternal(const base::State *state, unsigned int /*index*/) const {
 		return state->as<base::CompoundState>()->components[0];
@@ -121,23 +125,22 @@ protected:
 		getStateSpace()->as<base::CompoundStateSpace>()->getSubspace(2)->enforceBounds(s[2]);
 	}
 
-	virtual void ode(const control::ODESolver::StateType &q, const control::Control *ctrl, control::ODESolver::StateType &qdot) {
-		// Retrieving control inputs
-		const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-		// zero out qdot
-		qdot.resize(q.size(), 0);
-
-		qdot[0] = q[7];
-		qdot[1] = q[8];
-		qdot[2] = q[9];
-
-		qdot[3] = q[10];
-
-		qdot[7] = u[0] * cos(q[3]);
-		qdot[8] = u[0] * sin(q[3]);
-		qdot[9] = u[1];
-		qdot[10] = u[2];
+	void ode(const detail::LaneArray<const double> &q, const detail::LaneArray<const double> &u, const detail::LaneArray<double> &qdot) const {
+		for(unsigned int k = 0; k < q.lanes; ++k) {
+			qdot[0][k] = q[7][k];
+			qdot[1][k] = q[8][k];
+			qdot[2][k] = q[9][k];
+
+			qdot[3][k] = q[10][k];
+			qdot[4][k] = 0;
+			qdot[5][k] = 0;
+			qdot[6][k] = 0;
+
+			qdot[7][k] = u[0][k] * cos(q[3][k]);
+			qdot[8][k] = u[0][k] * sin(q[3][k]);
+			qdot[9][k] = u[1][k];
+			qdot[10][k] = u[2][k];
+		}
 	}
 
 	static control::ControlSpacePtr constructControlSpace(void) {
@@ -154,7 +157,6 @@ protected:
 	}
 
 	double timeStep_;
-	control::ODESolverPtr odeSolver;
 };
 
 }
@@ -14,8 +14,8 @@
 #define OMPLAPP_DYNAMIC_CAR_PLANNING_
 
 #include "AppBase.hpp"
+#include "detail/odePropagator.hpp"
 #include <ompl/base/spaces/SE2StateSpace.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 #include <boost/math/constants/constants.hpp>
 
@@ -40,12 +40,15 @@ namespace app {
 */
 class DynamicCarPlanning : public AppBase<CONTROL> {
 public:
+	// dimensions of the ode, see detail/odePropagator.hpp
+	static const unsigned int StateDimension = 5, ControlDimension = 2;
+
 	DynamicCarPlanning()
-		: AppBase<CONTROL>(constructControlSpace(), Motion_2D), timeStep_(1e-2), lengthInv_(1.), mass_(1.), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&DynamicCarPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(constructControlSpace(), Motion_2D), timeStep_(1e-2), lengthInv_(1.), mass_(1.) {
 		name_ = std::string("DynamicCar");
 		setDefaultBounds();
 
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&DynamicCarPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<DynamicCarPlanning>(si_, this)));
 	}
 
 	~DynamicCarPlanning() {
@@ -120,24 +123,21 @@ public:
 	}
 
 protected:
+	friend class detail::ODEPropagator<DynamicCarPlanning>;
 
 	virtual const base::State *getGeometricComponentStateInternal(const base::State *state, unsigned int /*index*/) const {
 		return state->as<base::CompoundState>()->components[0];
 	}
 
-	virtual void ode(const control::ODESolver::StateType &q, const control::Control *ctrl, control::ODESolver::StateType &qdot) {
-		// Retrieving control inputs
-		const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-		// zero out qdot
-		qdot.resize(q.size(), 0);
-
-		qdot[0] = q[3] * cos(q[2]);
-		qdot[1] = q[3] * sin(q[2]);
-		qdot[2] = q[3] * mass_ * lengthInv_ * tan(q[4]);
+	void ode(const detail::LaneArray<const double> &q, const detail::LaneArray<const double> &u, const detail::LaneArray<double> &qdot) const {
+		for(unsigned int k = 0; k < q.lanes; ++k) {
+			qdot[0][k] = q[3][k] * cos(q[2][k]);
+			qdot[1][k] = q[3][k] * sin(q[2][k]);
+			qdot[2][k] = q[3][k] * mass_ * lengthInv_ * tan(q[4][k]);
 
-		qdot[3] = u[0];
-		qdot[4] = u[1];
+			qdot[3][k] = u[0][k];
+			qdot[4][k] = u[1][k];
+		}
 	}
 
 
@@ -165,7 +165,6 @@ protected:
 	double timeStep_;
 	double lengthInv_;
 	double mass_;
-	control::ODESolverPtr odeSolver;
 };
 
 }
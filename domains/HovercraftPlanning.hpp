@@ -1,8 +1,8 @@
 #pragma once
 
 #include "AppBase.hpp"
+#include "detail/odePropagator.hpp"
 #include <ompl/base/spaces/SE2StateSpace.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 #include <boost/math/constants/constants.hpp>
 
@@ -11,11 +11,14 @@ namespace app {
 
 class HovercraftPlanning : public AppBase<CONTROL> {
 public:
+	// dimensions of the ode, see detail/odePropagator.hpp
+	static const unsigned int StateDimension = 6, ControlDimension = 2;
+
 	// Controllability of a Hovercraft with Unilateral Thrusters?
 	// http://msl.cs.uiuc.edu/~lavalle/cs476_1998/projects/marlow/
 
 	HovercraftPlanning()
-		: AppBase<CONTROL>(constructControlSpace(), Motion_2D), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&HovercraftPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(constructControlSpace(), Motion_2D) {
 		name_ = std::string("Hovercraft");
 
 		mass = 1;
@@ -25,7 +28,7 @@ public:
 		timeStep = 0.01;
 
 		setDefaultBounds();
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&HovercraftPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<HovercraftPlanning>(si_, this)));
 	}
 
 	~HovercraftPlanning() {}
@@ -88,25 +91,22 @@ public:
 	}
 
 protected:
+	friend class detail::ODEPropagator<HovercraftPlanning>;
 
 	virtual const base::State *getGeometricComponentStateInternal(const base::State *state, unsigned int /*index*/) const {
 		return state->as<base::CompoundState>()->components[0];
 	}
 
-	virtual void ode(const control::ODESolver::StateType &q, const control::Control *ctrl, control::ODESolver::StateType &qdot) {
-		// Retrieving control inputs
-		const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-		// zero out qdot
-		qdot.resize(q.size(), 0);
-
-		qdot[0] = q[3];
-		qdot[1] = q[4];
-		qdot[2] = q[5];
+	void ode(const detail::LaneArray<const double> &q, const detail::LaneArray<const double> &u, const detail::LaneArray<double> &qdot) const {
+		for(unsigned int k = 0; k < q.lanes; ++k) {
+			qdot[0][k] = q[3][k];
+			qdot[1][k] = q[4][k];
+			qdot[2][k] = q[5][k];
 
-		qdot[3] = (u[0] / mass) * cos(q[2]) - (translational_friction / mass) * q[3];
-		qdot[4] = (u[0] / mass) * sin(q[2]) - (translational_friction / mass) * q[4];
-		qdot[5] = u[1] / (0.5 * mass * radius * radius) - (rotational_friction / mass) * q[5];
+			qdot[3][k] = (u[0][k] / mass) * cos(q[2][k]) - (translational_friction / mass) * q[3][k];
+			qdot[4][k] = (u[0][k] / mass) * sin(q[2][k]) - (translational_friction / mass) * q[4][k];
+			qdot[5][k] = u[1][k] / (0.5 * mass * radius * radius) - (rotational_friction / mass) * q[5][k];
+		}
 	}
 
 
@@ -132,7 +132,6 @@ protected:
 	}
 
 	double timeStep, mass, radius, translational_friction, rotational_friction;
-	control::ODESolverPtr odeSolver;
 };
 
 }
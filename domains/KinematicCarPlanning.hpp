@@ -14,8 +14,8 @@
 #define OMPLAPP_KINEMATIC_CAR_PLANNING_
 
 #include "AppBase.hpp"
+#include "detail/odePropagator.hpp"
 #include <ompl/base/spaces/SE2StateSpace.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 #include <boost/math/constants/constants.hpp>
 
@@ -37,20 +37,23 @@ namespace app {
 */
 class KinematicCarPlanning : public AppBase<CONTROL> {
 public:
+	// dimensions of the ode, see detail/odePropagator.hpp
+	static const unsigned int StateDimension = 3, ControlDimension = 2;
+
 	KinematicCarPlanning()
-		: AppBase<CONTROL>(constructControlSpace(), Motion_2D), timeStep_(1e-2), lengthInv_(1.), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&KinematicCarPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(constructControlSpace(), Motion_2D), timeStep_(1e-2), lengthInv_(1.) {
 		name_ = std::string("KinematicCar");
 		setDefaultControlBounds();
 
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&KinematicCarPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<KinematicCarPlanning>(si_, this)));
 	}
 
 
 	KinematicCarPlanning(const control::ControlSpacePtr &controlSpace)
-		: AppBase<CONTROL>(controlSpace, Motion_2D), timeStep_(1e-2), lengthInv_(1.), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&KinematicCarPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(controlSpace, Motion_2D), timeStep_(1e-2), lengthInv_(1.) {
 		setDefaultControlBounds();
 
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&KinematicCarPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<KinematicCarPlanning>(si_, this)));
 	}
 
 	~KinematicCarPlanning() {
@@ -99,20 +102,18 @@ public:
 	}
 
 protected:
+	friend class detail::ODEPropagator<KinematicCarPlanning>;
 
 	virtual const base::State *getGeometricComponentStateInternal(const base::State *state, unsigned int /*index*/) const {
 		return state;
 	}
 
-	virtual void ode(const control::ODESolver::StateType &q, const control::Control *ctrl, control::ODESolver::StateType &qdot) {
-		const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-		// zero out qdot
-		qdot.resize(q.size(), 0);
-
-		qdot[0] = u[0] * cos(q[2]);
-		qdot[1] = u[0] * sin(q[2]);
-		qdot[2] = u[0] * lengthInv_ * tan(u[1]);
+	void ode(const detail::LaneArray<const double> &q, const detail::LaneArray<const double> &u, const detail::LaneArray<double> &qdot) const {
+		for(unsigned int k = 0; k < q.lanes; ++k) {
+			qdot[0][k] = u[0][k] * cos(q[2][k]);
+			qdot[1][k] = u[0][k] * sin(q[2][k]);
+			qdot[2][k] = u[0][k] * lengthInv_ * tan(u[1][k]);
+		}
 	}
 
 	virtual void postPropagate(const base::State * /*state*/, const control::Control * /*control*/, const double /*duration*/, base::State *result) {
@@ -133,7 +134,6 @@ protected:
 
 	double timeStep_;
 	double lengthInv_;
-	control::ODESolverPtr odeSolver;
 };
 }
 }
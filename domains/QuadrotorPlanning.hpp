@@ -14,8 +14,8 @@
 #define OMPLAPP_QUADROTOR_PLANNING_
 
 #include "AppBase.hpp"
+#include "detail/odePropagator.hpp"
 #include <ompl/base/spaces/SE3StateSpace.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 
 namespace ompl {
@@ -33,12 +33,15 @@ namespace app {
 */
 class QuadrotorPlanning : public AppBase<CONTROL> {
 public:
+	// dimensions of the ode, see detail/odePropagator.hpp
+	static const unsigned int StateDimension = 13, ControlDimension = 4;
+
 	QuadrotorPlanning()
-		: AppBase<CONTROL>(constructControlSpace(), Motion_3D), timeStep_(1e-2), massInv_(1.), beta_(1.), odeSolver(new control::ODEBasicSolver<>(si_, boost::bind(&QuadrotorPlanning::ode, this, _1, _2, _3))) {
+		: AppBase<CONTROL>(constructControlSpace(), Motion_3D), timeStep_(1e-2), massInv_(1.), beta_(1.) {
 		name_ = std::string("Quadrotor");
 		setDefaultBounds();
 
-		si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver, boost::bind(&QuadrotorPlanning::postPropagate, this, _1, _2, _3, _4)));
+		si_->setStatePropagator(control::StatePropagatorPtr(new detail::ODEPropagator<QuadrotorPlanning>(si_, this)));
 	}
 	~QuadrotorPlanning() {
 	}
@@ -104,52 +107,46 @@ public:
 	}
 
 protected:
+	friend class detail::ODEPropagator<QuadrotorPlanning>;
 
 	virtual const base::State *getGeometricComponentStateInternal(const base::State *state, unsigned int /*index*/) const {
 		return state->as<base::CompoundState>()->components[0];
 	}
 
-	virtual void ode(const control::ODESolver::StateType &q, const control::Control *ctrl, control::ODESolver::StateType &qdot) {
-		const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-		// zero out qdot
-		qdot.resize(q.size(), 0);
-
-		// derivative of position
-		qdot[0] = q[7];
-		qdot[1] = q[8];
-		qdot[2] = q[9];
+	void ode(const detail::LaneArray<const double> &q, const detail::LaneArray<const double> &u, const detail::LaneArray<double> &qdot) const {
+		for(unsigned int k = 0; k < q.lanes; ++k) {
+			// derivative of position
+			qdot[0][k] = q[7][k];
+			qdot[1][k] = q[8][k];
+			qdot[2][k] = q[9][k];
 
-		// derivative of orientation
-		// 1. First convert omega to quaternion: qdot = omega * q / 2
-		base::SO3StateSpace::StateType qomega;
-		qomega.w = 0;
-		qomega.x = .5*q[10];
-		qomega.y = .5*q[11];
-		qomega.z = .5*q[12];
+			// derivative of orientation
+			// 1. First convert omega to quaternion: qdot = omega * q / 2
+			double ox = .5*q[10][k], oy = .5*q[11][k], oz = .5*q[12][k];
 
-		// 2. We include a numerical correction so that dot(q,qdot) = 0. This constraint is
-		// obtained by differentiating q * q_conj = 1
-		double delta = q[3] * qomega.x + q[4] * qomega.y + q[5] * qomega.z;
+			// 2. We include a numerical correction so that dot(q,qdot) = 0. This constraint is
+			// obtained by differentiating q * q_conj = 1
+			double delta = q[3][k] * ox + q[4][k] * oy + q[5][k] * oz;
 
-		// 3. Finally, set the derivative of orientation
-		qdot[3] = qomega.x - delta * q[3];
-		qdot[4] = qomega.y - delta * q[4];
-		qdot[5] = qomega.z - delta * q[5];
-		qdot[6] = qomega.w - delta * q[6];
+			// 3. Finally, set the derivative of orientation
+			qdot[3][k] = ox - delta * q[3][k];
+			qdot[4][k] = oy - delta * q[4][k];
+			qdot[5][k] = oz - delta * q[5][k];
+			qdot[6][k] = -delta * q[6][k];
 
-		// derivative of velocity
-		// the z-axis of the body frame in world coordinates is equal to
-		// (2(wy+xz), 2(yz-wx), w^2-x^2-y^2+z^2).
-		// This can be easily verified by working out q * (0,0,1).
-		qdot[7] = massInv_ * (-2*u[0]*(q[6]*q[4] + q[3]*q[5]) - beta_ * q[7]);
-		qdot[8] = massInv_ * (-2*u[0]*(q[4]*q[5] - q[6]*q[3]) - beta_ * q[8]);
-		qdot[9] = massInv_ * (-u[0]*(q[6]*q[6]-q[3]*q[3]-q[4]*q[4]+q[5]*q[5]) - beta_ * q[9]) - 9.81;
+			// derivative of velocity
+			// the z-axis of the body frame in world coordinates is equal to
+			// (2(wy+xz), 2(yz-wx), w^2-x^2-y^2+z^2).
+			// This can be easily verified by working out q * (0,0,1).
+			qdot[7][k] = massInv_ * (-2*u[0][k]*(q[6][k]*q[4][k] + q[3][k]*q[5][k]) - beta_ * q[7][k]);
+			qdot[8][k] = massInv_ * (-2*u[0][k]*(q[4][k]*q[5][k] - q[6][k]*q[3][k]) - beta_ * q[8][k]);
+			qdot[9][k] = massInv_ * (-u[0][k]*(q[6][k]*q[6][k]-q[3][k]*q[3][k]-q[4][k]*q[4][k]+q[5][k]*q[5][k]) - beta_ * q[9][k]) - 9.81;
 
-		// derivative of rotational velocity
-		qdot[10] = u[1];
-		qdot[11] = u[2];
-		qdot[12] = u[3];
+			// derivative of rotational velocity
+			qdot[10][k] = u[1][k];
+			qdot[11][k] = u[2][k];
+			qdot[12][k] = u[3][k];
+		}
 	}
 
 	virtual void postPropagate(const base::State * /*state*/, const control::Control * /*control*/, const double /*duration*/, base::State *result) {
@@ -179,7 +176,6 @@ protected:
 	double timeStep_;
 	double massInv_;
 	double beta_;
-	control::ODESolverPtr odeSolver;
 };
 
 }
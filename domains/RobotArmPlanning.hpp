@@ -17,7 +17,9 @@ public:
 	class RobotArmPropagator : public ompl::control::StatePropagator {
 	public:
 		RobotArmPropagator(const ompl::control::SpaceInformationPtr &si, const std::vector<KinematicChainHelpers::TransformPair> &transformPairs, const std::vector<std::vector<double>> &jointAxes,
-			const ompl::base::RealVectorBounds &jointRanges) : ompl::control::StatePropagator(si), transformPairs(transformPairs), jointAxes(jointAxes), jointRanges(jointRanges) {
+			const ompl::base::RealVectorBounds &jointRanges) : ompl::control::StatePropagator(si), transformPairs(transformPairs), jointAxes(jointAxes), jointRanges(jointRanges),
+			axes(KinematicChainHelpers::getAxes(jointAxes)) {
+			assert(jointAxes.size() == KinematicChainHelpers::ChainLinks);
 		}
 
 		virtual bool steer(const ompl::base::State *from, const ompl::base::State *to, ompl::control::Control *result, double &duration) const {
@@ -27,8 +29,8 @@ public:
 		virtual void propagate(const ompl::base::State *state, const ompl::control::Control *control, const double duration, ompl::base::State *result) const {
 			const auto controlRVC = control->as<ompl::control::RealVectorControlSpace::ControlType>();
 
-			std::vector<double> angles(jointAxes.size());
-			KinematicChainHelpers::getJointAngles(state, transformPairs, jointAxes, angles);
+			double angles[KinematicChainHelpers::ChainLinks];
+			KinematicChainHelpers::getJointAngles(state, transformPairs, axes.data(), angles);
 
 			for(unsigned int i = 0; i < jointAxes.size(); i++) {
 				angles[i] += controlRVC->values[i] * duration;
@@ -41,7 +43,7 @@ public:
 				}
 			}
 
-			KinematicChainHelpers::buildState(angles, transformPairs, jointAxes, result);
+			KinematicChainHelpers::buildState(angles, transformPairs, axes.data(), result);
 		}
 
 		virtual bool canPropagateBackward() const {
@@ -55,6 +57,7 @@ public:
 		std::vector<KinematicChainHelpers::TransformPair> transformPairs;
 		std::vector<std::vector<double>> jointAxes;
 		ompl::base::RealVectorBounds jointRanges;
+		std::vector<unsigned int> axes;
 	};
 
 
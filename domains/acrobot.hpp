@@ -115,7 +115,8 @@ BenchmarkData acrobotBenchmark(const FileMap &params) {
 
 	ompl::app::SE2RigidBodyPlanning *abstract = new ompl::app::SE2RigidBodyPlanning();
 
-	abstract->getSpaceInformation()->setValidStateSamplerAllocator(AbstractAcrobotValidStateSamplerAllocator);
+	globalParameters.abstractValidStateSamplerAllocator = AbstractAcrobotValidStateSamplerAllocator;
+	abstract->getSpaceInformation()->setValidStateSamplerAllocator(globalParameters.abstractValidStateSamplerAllocator);
 
 	globalParameters.globalAbstractAppBaseGeometric = abstract;
 
@@ -129,7 +129,8 @@ BenchmarkData blimpBenchmark(const FileMap &params) {
 		OMPL_WARN("using default environment bounds");
 	}
 
-	abstract->getSpaceInformation()->setValidStateSamplerAllocator(SE3ZOnlyValidStateSamplerAllocator);
+	globalParameters.abstractValidStateSamplerAllocator = SE3ZOnlyValidStateSamplerAllocator;
+	abstract->getSpaceInformation()->setValidStateSamplerAllocator(globalParameters.abstractValidStateSamplerAllocator);
 
 	// define start state
 	ompl::base::ScopedState<ompl::base::SE3StateSpace> start(blimp->getGeometricComponentStateSpace());
@@ -0,0 +1,162 @@
+#pragma once
+
+/* Fixed size math behind KinematicChainHelpers: 4x4 row major transforms as one aligned block of 16
+doubles, quaternions as (w, x, y, z), and the chain walks of buildState and getJointAngles with the
+number of links as a template parameter, so the walks unroll and nothing is allocated. None of this
+needs OMPL, the helpers convert to and from states around it.
+
+Every link of the chain has two transform pairs, the joint rotation follows the first one. The walks
+do exactly what the helpers always did, including the link's own rotation only being applied to the
+transform handed out, not to the rest of the chain.
+*/
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace KinematicChainHelpers {
+	struct alignas(32) Matrix4 {
+		double m[16];
+
+		double &operator[](unsigned int i) {
+			return m[i];
+		}
+
+		const double &operator[](unsigned int i) const {
+			return m[i];
+		}
+
+		static constexpr Matrix4 identity() {
+			return Matrix4{{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+		}
+
+		static Matrix4 translation(double x, double y, double z) {
+			Matrix4 t = identity();
+			t[3] = x;
+			t[7] = y;
+			t[11] = z;
+			return t;
+		}
+
+		// rotation by angle around x (axis 0), y (1) or z (2)
+		static Matrix4 axisRotation(unsigned int axis, double angle) {
+			Matrix4 r = identity();
+			double c = cos(angle), s = sin(angle);
+			if(axis == 0) {
+				r[5] = c;
+				r[6] = -s;
+				r[9] = s;
+				r[10] = c;
+			} else if(axis == 1) {
+				r[0] = c;
+				r[2] = s;
+				r[8] = -s;
+				r[10] = c;
+			} else if(axis == 2) {
+				r[0] = c;
+				r[1] = -s;
+				r[4] = s;
+				r[5] = c;
+			}
+			return r;
+		}
+	};
+
+	inline Matrix4 operator*(const Matrix4 &a, const Matrix4 &b) {
+		Matrix4 out;
+		for(unsigned int row = 0; row < 4; ++row) {
+			for(unsigned int col = 0; col < 4; ++col) {
+				double sum = 0;
+				for(unsigned int i = 0; i < 4; i++) {
+					sum += a[row * 4 + i] * b[col + 4 * i];
+				}
+				out[row * 4 + col] = sum;
+			}
+		}
+		return out;
+	}
+
+	struct Quaternion {
+		double w, x, y, z;
+
+		// of the rotation part of m, assumes its trace is > -1
+		static Quaternion fromMatrix(const Matrix4 &m) {
+			Quaternion q;
+			q.w = sqrt(1 + m[0] + m[5] + m[10]) / 2;
+			q.x = (m[9] - m[6]) / (4 * q.w);
+			q.y = (m[2] - m[8]) / (4 * q.w);
+			q.z = (m[4] - m[1]) / (4 * q.w);
+			return q;
+		}
+
+		Matrix4 toMatrix() const {
+			return Matrix4{{1 - 2 * y * y - 2 * z * z, 2 * x * y - 2 * z * w, 2 * x * z + 2 * y * w, 0,
+			                2 * x * y + 2 * z * w, 1 - 2 * x * x - 2 * z * z, 2 * y * z - 2 * x * w, 0,
+			                2 * x * z - 2 * y * w, 2 * y * z + 2 * x * w, 1 - 2 * x * x - 2 * y * y, 0,
+			                0, 0, 0, 1}};
+		}
+	};
+
+	struct TransformPair {
+		TransformPair(const Matrix4 &translation, const Matrix4 &rotation) : translation(translation), rotation(rotation) {}
+		Matrix4 translation, rotation;
+	};
+
+	// transform is (x, y, z, rotation around x, around y, around z), the rotations applied in that order
+	inline TransformPair getTransformPair(const std::vector<double> &transform) {
+		Matrix4 rotation = Matrix4::identity();
+		for(unsigned int j = 0; j < 3; j++) {
+			double rotValue = transform[3 + j];
+			if(rotValue == 0) continue;
+			rotation = Matrix4::axisRotation(j, rotValue) * rotation;
+		}
+		return TransformPair(Matrix4::translation(transform[0], transform[1], transform[2]), rotation);
+	}
+
+	// which coordinate axis a joint turns around (the first non zero component)
+	inline unsigned int getAxis(const std::vector<double> &jointAxis) {
+		for(unsigned int axis = 0; axis < 3; axis++) {
+			if(std::fabs(jointAxis[axis]) > 0) return axis;
+		}
+		assert(false);
+		return 0;
+	}
+
+	// the signed angle around axis that takes the rotation of a to b
+	inline double getRotationAngle(const Matrix4 &a, const Matrix4 &b, unsigned int axis) {
+		Quaternion q0 = Quaternion::fromMatrix(a), q1 = Quaternion::fromMatrix(b);
+		double innerProduct = q0.w * q1.w + q0.x * q1.x + q0.y * q1.y + q0.z * q1.z;
+		double angle = acos(2 * innerProduct * innerProduct - 1);
+
+		Matrix4 rotated = a * Matrix4::axisRotation(axis, angle);
+		for(unsigned int i = 0; i < 16; i++) {
+			if(fabs(b[i] - rotated[i]) >= 0.0000001) {
+				return -angle;
+			}
+		}
+		return angle;
+	}
+
+	// the transform of every link for these joint angles
+	template <unsigned int Links>
+	void forwardKinematics(const TransformPair *pairs, const unsigned int *axes, const double *jointAngles, Matrix4 *links) {
+		Matrix4 transform = Matrix4::identity();
+		for(unsigned int link = 0; link < Links; link++) {
+			const TransformPair &joint = pairs[2 * link], &next = pairs[2 * link + 1];
+			transform = transform * joint.translation * Matrix4::axisRotation(axes[link], jointAngles[link]) * next.translation;
+			links[link] = transform * (next.rotation * joint.rotation);
+		}
+	}
+
+	// the joint angles of a chain whose links have these rotations, forwardKinematics backwards
+	template <unsigned int Links>
+	void inverseKinematics(const TransformPair *pairs, const unsigned int *axes, const Quaternion *linkRotations, double *jointAngles) {
+		Matrix4 transform = Matrix4::identity();
+		for(unsigned int link = 0; link < Links; link++) {
+			transform = transform * pairs[2 * link].translation;
+			double angle = getRotationAngle(transform, linkRotations[link].toMatrix(), axes[link]);
+			jointAngles[link] = angle;
+			transform = transform * Matrix4::axisRotation(axes[link], angle) * pairs[2 * link + 1].translation;
+		}
+	}
+};
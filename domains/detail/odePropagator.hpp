@@ -0,0 +1,141 @@
+#pragma once
+
+/* Native RK4 propagation for the ODE models.
+
+This replaces control::ODEBasicSolver<> for the models in this directory. The integration is the same
+(classic fourth order Runge-Kutta with fixed steps of intStep, no partial last step, postPropagate once at
+the end) but the state is kept in fixed size arrays on the stack and the model's ode is called directly,
+so a propagation does no allocation and no std::function dispatch per step.
+
+The model integrates a whole batch of (state, control) pairs in lockstep. Its ode gets the batch laid out a
+component at a time, q[i][k] is component i of lane k, so the loop over lanes is straight line code over
+contiguous doubles that the compiler can vectorize:
+
+	static const unsigned int StateDimension, ControlDimension;
+	void ode(const LaneArray<const double> &q, const LaneArray<const double> &u, const LaneArray<double> &qdot) const;
+	void postPropagate(const base::State *state, const control::Control *control, const double duration, base::State *result);
+
+State components are in the order of StateSpace::getValueAddressAtIndex, the same order copyToReals used.
+*/
+
+#include <ompl/control/StatePropagator.h>
+#include <ompl/control/SpaceInformation.h>
+#include <ompl/control/spaces/RealVectorControlSpace.h>
+#include <cassert>
+#include <cmath>
+
+namespace ompl {
+namespace app {
+
+/* A propagator that can also advance several (state, control) pairs at once. */
+class BatchStatePropagator : public control::StatePropagator {
+public:
+	BatchStatePropagator(const control::SpaceInformationPtr &si) : control::StatePropagator(si) {}
+
+	// results[k] may be states[k]
+	virtual void propagateBatch(const base::State *const *states, const control::Control *const *controls, unsigned int count,
+	                            const double duration, base::State **results) const = 0;
+};
+
+namespace detail {
+
+template <class T>
+struct LaneArray {
+	LaneArray(T *values, unsigned int lanes) : values(values), lanes(lanes) {}
+
+	T *operator[](unsigned int component) const {
+		return values + component * lanes;
+	}
+
+	T *values;
+	unsigned int lanes;
+};
+
+template <class Model>
+class ODEPropagator : public BatchStatePropagator {
+public:
+	static const unsigned int StateDimension = Model::StateDimension;
+	static const unsigned int ControlDimension = Model::ControlDimension;
+	static const unsigned int MaxLanes = 16;
+
+	ODEPropagator(const control::SpaceInformationPtr &si, Model *model, double intStep = 1e-2)
+		: BatchStatePropagator(si), model(model), intStep(intStep), space(si->getStateSpace().get()) {
+		assert(space->getValueLocations().size() == StateDimension);
+	}
+
+	virtual void propagate(const base::State *state, const control::Control *control, const double duration, base::State *result) const {
+		integrate(&state, &control, 1, duration, &result);
+	}
+
+	// batches bigger than MaxLanes are done MaxLanes at a time
+	virtual void propagateBatch(const base::State *const *states, const control::Control *const *controls, unsigned int count,
+	                            const double duration, base::State **results) const {
+		for(unsigned int first = 0; first < count; first += MaxLanes) {
+			unsigned int lanes = count - first < MaxLanes ? count - first : MaxLanes;
+			integrate(states + first, controls + first, lanes, duration, results + first);
+		}
+	}
+
+	double getIntegrationStep() const {
+		return intStep;
+	}
+
+	void setIntegrationStep(double step) {
+		intStep = step;
+	}
+
+private:
+	typedef LaneArray<const double> In;
+	typedef LaneArray<double> Out;
+
+	void integrate(const base::State *const *states, const control::Control *const *controls, unsigned int lanes,
+	               const double duration, base::State **results) const {
+		double x[StateDimension * MaxLanes], u[ControlDimension * MaxLanes];
+		double k1[StateDimension * MaxLanes], k2[StateDimension * MaxLanes], k3[StateDimension * MaxLanes], k4[StateDimension * MaxLanes];
+		double tmp[StateDimension * MaxLanes];
+		const unsigned int n = StateDimension * lanes;
+
+		for(unsigned int i = 0; i < StateDimension; ++i) {
+			for(unsigned int k = 0; k < lanes; ++k) {
+				x[i * lanes + k] = *space->getValueAddressAtIndex(states[k], i);
+			}
+		}
+		for(unsigned int k = 0; k < lanes; ++k) {
+			const double *values = controls[k]->as<control::RealVectorControlSpace::ControlType>()->values;
+			for(unsigned int j = 0; j < ControlDimension; ++j) {
+				u[j * lanes + k] = values[j];
+			}
+		}
+
+		// same step count as odeint's integrate_const: whole steps only, with a little slack for round off
+		unsigned int steps = duration > 0 ? (unsigned int)std::floor(duration / intStep + 1e-9) : 0;
+		const double dt = intStep, dt2 = dt / 2, dt3 = dt / 3, dt6 = dt / 6;
+		const In control(u, lanes);
+
+		for(unsigned int s = 0; s < steps; ++s) {
+			model->ode(In(x, lanes), control, Out(k1, lanes));
+			for(unsigned int i = 0; i < n; ++i) tmp[i] = x[i] + dt2 * k1[i];
+			model->ode(In(tmp, lanes), control, Out(k2, lanes));
+			for(unsigned int i = 0; i < n; ++i) tmp[i] = x[i] + dt2 * k2[i];
+			model->ode(In(tmp, lanes), control, Out(k3, lanes));
+			for(unsigned int i = 0; i < n; ++i) tmp[i] = x[i] + dt * k3[i];
+			model->ode(In(tmp, lanes), control, Out(k4, lanes));
+			for(unsigned int i = 0; i < n; ++i) x[i] += dt6 * k1[i] + dt3 * k2[i] + dt3 * k3[i] + dt6 * k4[i];
+		}
+
+		for(unsigned int k = 0; k < lanes; ++k) {
+			for(unsigned int i = 0; i < StateDimension; ++i) {
+				*space->getValueAddressAtIndex(results[k], i) = x[i * lanes + k];
+			}
+			model->postPropagate(states[k], controls[k], duration, results[k]);
+		}
+	}
+
+	Model *model;
+	double intStep;
+	const base::StateSpace *space;
+};
+
+}
+}
+}
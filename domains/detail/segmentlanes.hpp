@@ -0,0 +1,196 @@
+#pragma once
+
+/* The 2D segment test of the Linkage domain, apart from OMPL so it can be checked on its own
+(checks/segmentlanescheck.cpp). */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// a 2D line segment
+struct Segment
+{
+  Segment(double p0_x, double p0_y, double p1_x, double p1_y)
+      : x0(p0_x), y0(p0_y), x1(p1_x), y1(p1_y)
+  {
+  }
+  double x0, y0, x1, y1;
+};
+
+// true iff segment s0 intersects segment s1, the scalar form of SegmentLanes::anyIntersection
+inline bool segmentsIntersect(const Segment& s0, const Segment& s1)
+{
+  // adopted from:
+  // http://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/1201356#1201356
+  double s10_x = s0.x1 - s0.x0;
+  double s10_y = s0.y1 - s0.y0;
+  double s32_x = s1.x1 - s1.x0;
+  double s32_y = s1.y1 - s1.y0;
+  double denom = s10_x * s32_y - s32_x * s10_y;
+  if (fabs(denom) < std::numeric_limits<double>::epsilon())
+    return false; // Collinear
+  bool denomPositive = denom > 0;
+
+  double s02_x = s0.x0 - s1.x0;
+  double s02_y = s0.y0 - s1.y0;
+  double s_numer = s10_x * s02_y - s10_y * s02_x;
+  if ((s_numer < std::numeric_limits<float>::epsilon()) == denomPositive)
+    return false; // No collision
+  double t_numer = s32_x * s02_y - s32_y * s02_x;
+  if ((t_numer < std::numeric_limits<float>::epsilon()) == denomPositive)
+    return false; // No collision
+  if (((s_numer - denom > -std::numeric_limits<float>::epsilon()) == denomPositive)
+      || ((t_numer - denom > std::numeric_limits<float>::epsilon()) == denomPositive))
+    return false; // No collision
+  return true;
+}
+
+/* Segments laid out for testing one segment against a block of Lanes of them at a time.
+
+The coordinates are kept as structure of arrays (start point and direction per lane) padded with
+degenerate segments to a whole number of blocks, so anyIntersection is one straight line loop over
+the lanes that the compiler vectorizes. Every block also keeps the bounding box of its segments, padded
+by the intersection test's tolerance, so a segment can skip blocks it can't reach. */
+class SegmentLanes
+{
+ public:
+  static const unsigned int Lanes = 8;
+
+  struct Box
+  {
+    double minX, minY, maxX, maxY;
+
+    bool overlaps(const Box &other) const
+    {
+      return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+  };
+
+  // keeps the storage of earlier calls, so refilling with the same count doesn't allocate
+  void resize(unsigned int count)
+  {
+    count_ = count;
+    unsigned int padded = (count + Lanes - 1) / Lanes * Lanes;
+    x0_.assign(padded, 0.);
+    y0_.assign(padded, 0.);
+    dx_.assign(padded, 0.);
+    dy_.assign(padded, 0.);
+    boxes_.resize(padded / Lanes);
+  }
+
+  void set(unsigned int i, const Segment &segment)
+  {
+    x0_[i] = segment.x0;
+    y0_[i] = segment.y0;
+    dx_[i] = segment.x1 - segment.x0;
+    dy_[i] = segment.y1 - segment.y0;
+  }
+
+  // to be called after all the segments are set
+  void computeBoxes()
+  {
+    for(unsigned int b = 0; b < boxes_.size(); ++b)
+    {
+      Box &box = boxes_[b];
+      box = boxOf(b * Lanes);
+      for(unsigned int i = b * Lanes + 1; i < std::min(count_, (b + 1) * Lanes); ++i)
+      {
+        Box other = boxOf(i);
+        box.minX = std::min(box.minX, other.minX);
+        box.minY = std::min(box.minY, other.minY);
+        box.maxX = std::max(box.maxX, other.maxX);
+        box.maxY = std::max(box.maxY, other.maxY);
+      }
+    }
+  }
+
+  unsigned int size() const
+  {
+    return count_;
+  }
+
+  unsigned int blockCount() const
+  {
+    return boxes_.size();
+  }
+
+  const Box &blockBox(unsigned int block) const
+  {
+    return boxes_[block];
+  }
+
+  Box boxOf(unsigned int i) const
+  {
+    const double pad = std::numeric_limits<float>::epsilon();
+    Box box;
+    box.minX = std::min(x0_[i], x0_[i] + dx_[i]) - pad;
+    box.maxX = std::max(x0_[i], x0_[i] + dx_[i]) + pad;
+    box.minY = std::min(y0_[i], y0_[i] + dy_[i]) - pad;
+    box.maxY = std::max(y0_[i], y0_[i] + dy_[i]) + pad;
+    return box;
+  }
+
+  // true iff segment i of from intersects one of the segments in the block with index >= first,
+  // the same test as segmentsIntersect with segment i as the first segment; padding lanes are
+  // degenerate and so collinear with everything
+  bool anyIntersection(const SegmentLanes &from, unsigned int i, unsigned int block, unsigned int first) const
+  {
+    const double fEps = std::numeric_limits<float>::epsilon();
+    const double dEps = std::numeric_limits<double>::epsilon();
+    const double s0_x = from.x0_[i], s0_y = from.y0_[i];
+    const double s10_x = from.dx_[i], s10_y = from.dy_[i];
+    const unsigned int base = block * Lanes;
+    const double *x0 = &x0_[base], *y0 = &y0_[base], *dx = &dx_[base], *dy = &dy_[base];
+
+    int hits = 0;
+    for(unsigned int k = 0; k < Lanes; ++k)
+    {
+      double denom = s10_x * dy[k] - dx[k] * s10_y;
+      bool denomPositive = denom > 0;
+      double s02_x = s0_x - x0[k];
+      double s02_y = s0_y - y0[k];
+      double s_numer = s10_x * s02_y - s10_y * s02_x;
+      double t_numer = dx[k] * s02_y - dy[k] * s02_x;
+      hits |= (std::fabs(denom) >= dEps)
+          & ((s_numer < fEps) != denomPositive)
+          & ((t_numer < fEps) != denomPositive)
+          & ((s_numer - denom > -fEps) != denomPositive)
+          & ((t_numer - denom > fEps) != denomPositive)
+          & (base + k >= first);
+    }
+    return hits != 0;
+  }
+
+  // true iff two non consecutive segments intersect, consecutive ones share an end point and
+  // segmentsIntersect never counts that
+  bool intersectsItself() const
+  {
+    for(unsigned int i = 0; i < size(); ++i)
+    {
+      Box box = boxOf(i);
+      for(unsigned int b = (i + 2) / Lanes; b < blockCount(); ++b)
+        if(box.overlaps(blockBox(b)) && anyIntersection(*this, i, b, i + 2))
+          return true;
+    }
+    return false;
+  }
+
+  // true iff one of these segments intersects one of other's
+  bool intersects(const SegmentLanes &other) const
+  {
+    for(unsigned int i = 0; i < size(); ++i)
+    {
+      Box box = boxOf(i);
+      for(unsigned int b = 0; b < other.blockCount(); ++b)
+        if(box.overlaps(other.blockBox(b)) && other.anyIntersection(*this, i, b, 0))
+          return true;
+    }
+    return false;
+  }
+
+ protected:
+  unsigned int count_ = 0;
+  std::vector<double> x0_, y0_, dx_, dy_;
+  std::vector<Box> boxes_;
+};
@@ -208,9 +208,9 @@ public:
 #endif
 		case FCL:
 			if(mtype_ == Motion_2D)
-				validitySvc_.reset(new FCLStateValidityChecker<Motion_2D>(si, geom, se, selfCollision));
+				validitySvc_.reset(withValidityCache(new FCLStateValidityChecker<Motion_2D>(si, geom, se, selfCollision)));
 			else
-				validitySvc_.reset(new FCLStateValidityChecker<Motion_3D>(si, geom, se, selfCollision));
+				validitySvc_.reset(withValidityCache(new FCLStateValidityChecker<Motion_3D>(si, geom, se, selfCollision)));
 			break;
 
 		default:
@@ -220,6 +220,36 @@ public:
 		return validitySvc_;
 	}
 
+	/** \brief Allocate a new state validity checker that is not shared with the space information,
+	    so it can be used from a worker thread. FCL checkers share the built (read only) BVH models
+	    through FCLModelCache, PQP checkers build their own. */
+	ompl::base::StateValidityCheckerPtr allocThreadLocalStateValidityChecker(const base::SpaceInformationPtr &si, const GeometricStateExtractor &se, bool selfCollision) const {
+		GeometrySpecification geom = getGeometrySpecification();
+		ompl::base::StateValidityCheckerPtr svc;
+
+		switch(ctype_) {
+#if OMPL_HAS_PQP
+		case PQP:
+			if(mtype_ == Motion_2D)
+				svc.reset(new PQPStateValidityChecker<Motion_2D>(si, geom, se, selfCollision));
+			else
+				svc.reset(new PQPStateValidityChecker<Motion_3D>(si, geom, se, selfCollision));
+			break;
+#endif
+		case FCL:
+			if(mtype_ == Motion_2D)
+				svc.reset(withValidityCache(new FCLStateValidityChecker<Motion_2D>(si, geom, se, selfCollision)));
+			else
+				svc.reset(withValidityCache(new FCLStateValidityChecker<Motion_3D>(si, geom, se, selfCollision)));
+			break;
+
+		default:
+			OMPL_ERROR("Unexpected collision checker type (%d) encountered", ctype_);
+		};
+
+		return svc;
+	}
+
 	const ompl::app::GeometrySpecification &getGeometrySpecification(void) const {
 		return geom_;
 	}
@@ -273,8 +303,18 @@ public:
 
 protected:
 
+	/** \brief Give a collision checker the results cache shared by all the checkers of this geometry */
+	template<class Checker>
+	Checker *withValidityCache(Checker *checker) const {
+		if(!validityCache_)
+			validityCache_ = ValidityCache::allocFromSettings();
+		checker->setValidityCache(validityCache_);
+		return checker;
+	}
+
 	void computeGeometrySpecification(void) {
 		validitySvc_.reset();
+		validityCache_.reset();
 		geom_.obstacles.clear();
 		geom_.obstaclesShift.clear();
 		geom_.robot.clear();
@@ -312,6 +352,9 @@ protected:
 	/** \brief Instance of the state validity checker for collision checking */
 	base::StateValidityCheckerPtr validitySvc_;
 
+	/** \brief Collision results shared by validitySvc_ and the thread local checkers, null when disabled */
+	mutable std::shared_ptr<ValidityCache> validityCache_;
+
 	/** \brief Value containing the type of collision checking to use */
 	CollisionChecker              ctype_;
 
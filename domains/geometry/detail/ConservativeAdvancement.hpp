@@ -0,0 +1,113 @@
+#ifndef OMPLAPP_GEOMETRY_DETAIL_CONSERVATIVE_ADVANCEMENT_
+#define OMPLAPP_GEOMETRY_DETAIL_CONSERVATIVE_ADVANCEMENT_
+
+/* The search FCLContinuousMotionValidator runs along a motion, over the interpolation fraction t in [0, 1]
+and without OMPL or FCL, so it can be checked on its own (checks/continuousmotioncheck.cpp).
+
+The caller hands in clearance(t), the robot's distance to the environment at fraction t, isValid(t), the
+full state check, and rate, a bound on how far any point of the robot moves per unit of t. No point can
+move clearance(t) before t grows by clearance(t) / rate, so every fraction stepped to is collision free.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+namespace ompl {
+namespace app {
+
+struct ConservativeAdvancement {
+	/// \brief Clearance at which the robot counts as touching the environment
+	double contactDistance = 1e-3;
+
+	/// \brief Advancement steps before the rest of the motion is checked at the space's resolution
+	unsigned int maxIterations = 100;
+
+	/// \brief Width of the interval the bisection for the last valid fraction stops at
+	double bisectionTolerance = 1e-3;
+
+	/// \brief True if the whole motion is valid, otherwise lastValidTime is the last fraction of it known
+	/// to be valid. segments is the number of resolution steps over the whole motion, endInBounds whether
+	/// the end state satisfies the bounds (they are convex, so only the end can leave them).
+	template <class Clearance, class IsValid>
+	bool advance(double rate, unsigned int segments, bool endInBounds, const Clearance &clearance, const IsValid &isValid,
+	             double &lastValidTime) const {
+		lastValidTime = 0;
+
+		double t = 0, safe = 0;
+		for(unsigned int iteration = 0; ; ++iteration) {
+			double c = clearance(t);
+			// overlapping only happens if the start wasn't valid. A motion that ends out of bounds may have left
+			// them already, then only the start is known to be valid
+			if(c <= 0) {
+				lastValidTime = bisect(isValid, endInBounds ? safe : 0, t);
+				return false;
+			}
+			// touching, the steps would be too small to get anywhere and the motion may well move away, so check
+			// the rest at the space's resolution
+			if(c <= contactDistance)
+				return finishDiscretely(segments, endInBounds, isValid, t, lastValidTime);
+
+			safe = t;
+			if(rate <= 0)
+				break;
+			t += c / rate;
+			if(t >= 1)
+				break;
+
+			// the robot is creeping along something, check the rest at the space's resolution
+			if(iteration == maxIterations)
+				return finishDiscretely(segments, endInBounds, isValid, safe, lastValidTime);
+		}
+
+		if(!endInBounds) {
+			lastValidTime = bisect(isValid, 0, 1);
+			return false;
+		}
+		return true;
+	}
+
+	/// \brief Check [from, 1] at the space's resolution once advancing gets nowhere; from is collision free but
+	/// may be out of bounds if the end is
+	template <class IsValid>
+	bool finishDiscretely(unsigned int segments, bool endInBounds, const IsValid &isValid, double from,
+	                      double &lastValidTime) const {
+		if(!endInBounds && !isValid(from)) {
+			lastValidTime = bisect(isValid, 0, from);
+			return false;
+		}
+		return checkDiscretely(segments, isValid, from, lastValidTime);
+	}
+
+	/// \brief Check [from, 1] at the space's resolution, like DiscreteMotionValidator
+	template <class IsValid>
+	bool checkDiscretely(unsigned int segments, const IsValid &isValid, double from, double &lastValidTime) const {
+		segments = std::max(1u, (unsigned int)std::ceil((1 - from) * segments));
+		for(unsigned int j = 1; j <= segments; ++j) {
+			double t = j == segments ? 1 : from + (1 - from) * j / segments;
+			if(!isValid(t)) {
+				lastValidTime = bisect(isValid, from + (1 - from) * (j - 1) / segments, t);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// \brief The fraction at lo is valid and the one at hi is not, halve the interval until it is
+	/// narrower than the tolerance and return its valid end
+	template <class IsValid>
+	double bisect(const IsValid &isValid, double lo, double hi) const {
+		while(hi - lo > bisectionTolerance) {
+			double mid = (lo + hi) / 2;
+			if(isValid(mid))
+				lo = mid;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+};
+
+}
+}
+
+#endif
@@ -16,39 +16,60 @@
 #include <ompl/base/MotionValidator.h>
 #include <ompl/base/SpaceInformation.h>
 
-#include "omplapp/geometry/detail/FCLMethodWrapper.h"
-#include "omplapp/geometry/detail/FCLStateValidityChecker.h"
-#include "omplapp/geometry/GeometrySpecification.h"
+#include "ConservativeAdvancement.hpp"
+#include "FCLMethodWrapper.hpp"
+#include "FCLStateValidityChecker.hpp"
+#include "../GeometrySpecification.hpp"
+
+#include <algorithm>
+#include <vector>
 
 namespace ob = ompl::base;
 
 namespace ompl {
 namespace app {
-/// \brief A motion validator that utilizes FCL's continuous collision checking
+
+/// \brief Install FCLContinuousMotionValidator (AppBase::setup) in place of OMPL's discrete one
+bool fclContinuousMotionValidation = false;
+
+/// \brief A motion validator that advances along the motion as far as the
+/// robot's clearance allows (conservative advancement). A distance query at
+/// the current state gives the clearance d, and no point of the robot can move
+/// d before the interpolation fraction grows by d / FCLMethodWrapper::motionBound,
+/// so every fraction stepped to is collision free. Once the clearance drops to
+/// the contact distance the steps get nowhere, and the rest of the motion is
+/// checked at the space's resolution, as it may touch and move away. With self
+/// collision the clearance doesn't cover every contact, so FCL's continuous
+/// check is used instead and the last valid fraction is found by bisection.
 class FCLContinuousMotionValidator : public ob::MotionValidator {
 public:
 
 	/// \brief Constructor
 	FCLContinuousMotionValidator(ob::SpaceInformation *si, MotionModel mm) : ob::MotionValidator(si) {
-		defaultSettings(mm);
+		defaultSettings(mm, si_->getStateValidityChecker());
 	}
 
 	/// \brief Constructor
 	FCLContinuousMotionValidator(const ob::SpaceInformationPtr &si, MotionModel mm) : ob::MotionValidator(si) {
-		defaultSettings(mm);
+		defaultSettings(mm, si_->getStateValidityChecker());
+	}
+
+	/// \brief Constructor for a validator using its own (thread local) state validity checker
+	/// instead of the space information's
+	FCLContinuousMotionValidator(ob::SpaceInformation *si, const ob::StateValidityCheckerPtr &checker, MotionModel mm) :
+		ob::MotionValidator(si), checker_(checker) {
+		defaultSettings(mm, checker);
 	}
 
 	/// \brief Destructor
 	virtual ~FCLContinuousMotionValidator(void) {
+		si_->freeState(test_);
 	}
 
 	/// \brief Returns true if motion between s1 and s2 is collision free.
 	virtual bool checkMotion(const ob::State *s1, const ob::State *s2) const {
-		double unused;
-
-		// assume motion starts in a valid configuration so s1 is valid
-		// Must check validity of s2 before performing collision check between s1 and s2
-		bool valid = si_->isValid(s2) && fclWrapper_->isValid(s1, s2, unused);
+		double lastValidTime;
+		bool valid = advance(s1, s2, lastValidTime);
 
 		// Increment valid/invalid motion counters
 		valid ? valid_++ : invalid_++;
@@ -60,42 +81,17 @@ public:
 	/// invalid, lastValid contains the last valid state and the
 	/// parameterized time [0,1) when this state occurs.
 	virtual bool checkMotion(const ob::State *s1, const ob::State *s2, std::pair<ob::State *, double> &lastValid) const {
-		bool valid = false;
-
-		// if there is a collision, collisionTime will contain the time to collision,
-		// parameterized from [0,1), where s1 is 0 and s2 is 1.
-		double collisionTime;
-		valid = fclWrapper_->isValid(s1, s2, collisionTime);
+		double lastValidTime;
+		bool valid = advance(s1, s2, lastValidTime);
 
-		// Find the last valid state before collision...
-		// NOTE: This should probably be refactored so that the continuous checker
-		// returns the last valid time.  Last valid transformation may also be
-		// possible, but that introduces a dependency on the geometry.
 		if(!valid) {
-			ob::State *lastValidState;
-			if(lastValid.first)
-				lastValidState = lastValid.first;
-			else
-				lastValidState = si_->allocState();
-
-			collisionTime -= 0.01;
-			stateSpace_->interpolate(s1, s2, collisionTime, lastValidState);
-
-			while(!si_->isValid(lastValidState) && collisionTime > 0) {
-				collisionTime -= 0.01;
-				stateSpace_->interpolate(s1, s2, collisionTime, lastValidState);
-			}
-
-			// ensure that collisionTime is greater than zero
-			if(collisionTime < 0.01) {
-				collisionTime = 0.0;
-				si_->copyState(lastValidState, s1);
+			if(lastValid.first) {
+				if(lastValidTime > 0)
+					stateSpace_->interpolate(s1, s2, lastValidTime, lastValid.first);
+				else
+					si_->copyState(lastValid.first, s1);
 			}
-
-			lastValid.second = collisionTime;
-
-			if(!lastValid.first)
-				si_->freeState(lastValidState);
+			lastValid.second = lastValidTime;
 		}
 
 		// Increment valid/invalid motion counters
@@ -104,19 +100,76 @@ public:
 		return valid;
 	}
 
+	/// \brief Clearance at which the robot counts as touching the environment
+	void setContactDistance(double distance) {
+		advancement_.contactDistance = distance;
+	}
+
+	double getContactDistance(void) const {
+		return advancement_.contactDistance;
+	}
+
+	/// \brief Advancement steps before the rest of the motion is checked discretely
+	void setMaxIterations(unsigned int iterations) {
+		advancement_.maxIterations = iterations;
+	}
+
+	/// \brief Width of the interval the bisection for the last valid fraction stops at
+	void setBisectionTolerance(double tolerance) {
+		advancement_.bisectionTolerance = tolerance;
+	}
+
 protected:
 
+	bool isValid(const ob::State *state) const {
+		return checker_ ? si_->satisfiesBounds(state) && checker_->isValid(state) : si_->isValid(state);
+	}
+
+	/// \brief True if the whole motion is valid, otherwise lastValidTime is the last
+	/// fraction of it known to be valid.
+	bool advance(const ob::State *s1, const ob::State *s2, double &lastValidTime) const {
+		// the state at fraction t, s1 and s2 themselves at the ends
+		auto stateAt = [&](double t) -> const ob::State * {
+			if(t <= 0)
+				return s1;
+			if(t >= 1)
+				return s2;
+			stateSpace_->interpolate(s1, s2, t, test_);
+			return test_;
+		};
+		auto validAt = [&](double t) {
+			return isValid(stateAt(t));
+		};
+
+		if(fclWrapper_->checksSelfCollision()) {
+			lastValidTime = 0;
+			double collisionTime = 1;
+			if(isValid(s2) && fclWrapper_->isValid(s1, s2, collisionTime))
+				return true;
+			lastValidTime = advancement_.bisect(validAt, 0, collisionTime);
+			return false;
+		}
+
+		fclWrapper_->getPartPoses(s1, fromPoses_);
+		fclWrapper_->getPartPoses(s2, toPoses_);
+		double rate = fclWrapper_->motionBound(fromPoses_, toPoses_);
+
+		return advancement_.advance(rate, stateSpace_->validSegmentCount(s1, s2), si_->satisfiesBounds(s2),
+		                            [&](double t) { return fclWrapper_->clearance(stateAt(t)); }, validAt, lastValidTime);
+	}
+
 	/// \brief Restore settings to default values.
-	void defaultSettings(MotionModel mm) {
+	void defaultSettings(MotionModel mm, const ob::StateValidityCheckerPtr &checker) {
 		stateSpace_ = si_->getStateSpace().get();
 		if(!stateSpace_)
 			throw Exception("No state space for motion validator");
+		test_ = si_->allocState();
 
 		// Extract FCLWrapper from FCLStateValidityChecker.
 		switch(mm) {
 		case app::Motion_2D:
 			const app::FCLStateValidityChecker<app::Motion_2D> *fcl_2d_state_checker;
-			fcl_2d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_2D>* >(si_->getStateValidityChecker().get());
+			fcl_2d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_2D>* >(checker.get());
 
 			if(!fcl_2d_state_checker) {
 				// Be extra verbose in this fatal error
@@ -129,7 +182,7 @@ protected:
 
 		case app::Motion_3D:
 			const app::FCLStateValidityChecker<app::Motion_3D> *fcl_3d_state_checker;
-			fcl_3d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_3D>* >(si_->getStateValidityChecker().get());
+			fcl_3d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_3D>* >(checker.get());
 
 			if(!fcl_3d_state_checker) {
 				// Be extra verbose in this fatal error
@@ -157,6 +210,16 @@ protected:
 
 	/// \brief Handle to the statespace that this motion validator operates in.
 	ob::StateSpace             *stateSpace_;
+
+	/// \brief The checker used instead of the space information's, if any
+	ob::StateValidityCheckerPtr checker_;
+
+	/// \brief The search along the motion and its settings
+	ConservativeAdvancement     advancement_;
+
+	/// \brief Scratch space, a validator is used by one thread at a time
+	ob::State                  *test_;
+	mutable std::vector<FCLMethodWrapper::PartPose> fromPoses_, toPoses_;
 };
 }
 }
@@ -0,0 +1,160 @@
+#ifndef OMPLAPP_GEOMETRY_DETAIL_FCL_DISTANCE_FIELD_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_FCL_DISTANCE_FIELD_CACHE_
+
+/* Distance fields (structs/distancefield.hpp) of environment models, shared in the process and saved
+next to the BVH builds of FCLModelCache when fclModelCacheDirectory is set.
+
+A field is keyed by a hash of the model's triangles and the grid (bounds and voxel size), a saved file
+is checked against the whole key and rebuilt when it doesn't match or can't be read to the end.
+*/
+
+#include "FCLModelCache.hpp"
+#include "../../../structs/distancefield.hpp"
+
+#include <ompl/util/Console.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace ompl {
+namespace app {
+
+class FCLDistanceFieldCache {
+public:
+	typedef boost::shared_ptr<const DistanceField> FieldPtr;
+
+	/// \brief The field of the model over [low, high], the same instance for everyone asking while it is alive
+	static FieldPtr get(const FCLModelCache::Model &environment, const double low[3], const double high[3], double voxelSize) {
+		std::vector<double> vertices;
+		std::vector<unsigned int> triangles;
+		vertices.reserve(3 * environment.num_vertices);
+		for(int i = 0; i < environment.num_vertices; ++i) {
+			for(unsigned int d = 0; d < 3; ++d) {
+				vertices.push_back(environment.vertices[i][d]);
+			}
+		}
+		triangles.reserve(3 * environment.num_tris);
+		for(int i = 0; i < environment.num_tris; ++i) {
+			for(unsigned int k = 0; k < 3; ++k) {
+				triangles.push_back(environment.tri_indices[i][k]);
+			}
+		}
+
+		uint64_t key = hash(vertices, triangles, low, high, voxelSize);
+
+		static boost::mutex mutex;
+		static std::map<uint64_t, boost::weak_ptr<const DistanceField> > fields;
+		boost::mutex::scoped_lock lock(mutex);
+
+		FieldPtr field = fields[key].lock();
+		if(!field) {
+			field = build(key, vertices, triangles, low, high, voxelSize);
+			fields[key] = field;
+		}
+		return field;
+	}
+
+private:
+	static const uint32_t Version = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint64_t key;
+	};
+
+	static uint64_t hash(const std::vector<double> &vertices, const std::vector<unsigned int> &triangles,
+	                     const double low[3], const double high[3], double voxelSize) {
+		uint64_t h = 14695981039346656037ULL;
+		auto add = [&h](double value) {
+			unsigned char bytes[sizeof(value)];
+			memcpy(bytes, &value, sizeof(value));
+			for(unsigned int i = 0; i < sizeof(value); ++i) {
+				h = (h ^ bytes[i]) * 1099511628211ULL;
+			}
+		};
+		add(vertices.size());
+		for(double value : vertices) {
+			add(value);
+		}
+		add(triangles.size());
+		for(unsigned int index : triangles) {
+			add(index);
+		}
+		for(unsigned int d = 0; d < 3; ++d) {
+			add(low[d]);
+			add(high[d]);
+		}
+		add(voxelSize);
+		return h;
+	}
+
+	static FieldPtr build(uint64_t key, const std::vector<double> &vertices, const std::vector<unsigned int> &triangles,
+	                      const double low[3], const double high[3], double voxelSize) {
+		std::string path;
+		if(!fclModelCacheDirectory.empty()) {
+			char name[32];
+			snprintf(name, sizeof(name), "esdf-%016llx.esdf", (unsigned long long)key);
+			path = fclModelCacheDirectory + "/" + name;
+
+			boost::shared_ptr<DistanceField> field(new DistanceField());
+			if(load(path, key, *field)) {
+				return field;
+			}
+		}
+
+		FieldPtr field(new DistanceField(vertices, triangles, low, high, voxelSize));
+		if(!path.empty() && !save(path, key, *field)) {
+			OMPL_WARN("could not write distance field cache file %s", path.c_str());
+		}
+		return field;
+	}
+
+	static bool load(const std::string &path, uint64_t key, DistanceField &field) {
+		FILE *file = fopen(path.c_str(), "rb");
+		if(file == NULL) return false;
+
+		Header header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "BEASTDF ", 8) == 0 &&
+		          header.version == Version && header.key == key && field.read(file);
+		fclose(file);
+		if(!ok) {
+			OMPL_WARN("ignoring stale distance field cache file %s", path.c_str());
+		}
+		return ok;
+	}
+
+	// written to a temporary name and renamed like the BVH files
+	static bool save(const std::string &path, uint64_t key, const DistanceField &field) {
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "BEASTDF ", 8);
+		header.version = Version;
+		header.key = key;
+
+		std::string temporary = path + ".tmp" + std::to_string(getpid());
+		FILE *file = fopen(temporary.c_str(), "wb");
+		if(file == NULL) return false;
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 && field.write(file);
+		written = fclose(file) == 0 && written;
+		if(!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+};
+
+}
+}
+
+#endif
@@ -18,6 +18,8 @@
 // OMPL and OMPL.app headers
 #include "../GeometrySpecification.hpp"
 #include "assimpUtil.hpp"
+#include "FCLModelCache.hpp"
+#include "../../../structs/threadcounters.hpp"
 
 // FCL Headers
 #include <fcl/collision.h>
@@ -31,6 +33,8 @@
 #include <vector>
 #include <limits>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
 
 namespace ob = ompl::base;
 
@@ -38,6 +42,30 @@ namespace ompl {
 namespace app {
 OMPL_CLASS_FORWARD(FCLMethodWrapper);
 
+/// \brief Don't check consecutive robot parts against each other (links sharing a joint)
+bool fclSkipAdjacentParts = false;
+
+/// \brief What the discrete checks of FCLMethodWrapper did, the broad phase tests are box
+/// overlap tests and only the ones that overlap go on to a narrow phase fcl::collide
+struct CollisionCheckCounts {
+	uint64_t checks = 0;
+	uint64_t broadPhaseTests = 0;
+	uint64_t narrowPhaseCalls = 0;
+	uint64_t clearanceSkips = 0; //checks answered by the clearance of an earlier one (fclClearanceReuse)
+	uint64_t distanceFieldDecisions = 0; //abstract edges decided by the environment's distance field
+
+	CollisionCheckCounts &operator+=(const CollisionCheckCounts &other) {
+		checks += other.checks;
+		broadPhaseTests += other.broadPhaseTests;
+		narrowPhaseCalls += other.narrowPhaseCalls;
+		clearanceSkips += other.clearanceSkips;
+		distanceFieldDecisions += other.distanceFieldDecisions;
+		return *this;
+	}
+};
+
+ThreadCounters<CollisionCheckCounts> collisionCheckCounters;
+
 /// \brief Wrapper for FCL discrete and continuous collision checking and distance queries
 class FCLMethodWrapper {
 public:
@@ -53,41 +81,64 @@ public:
 	}
 
 	virtual ~FCLMethodWrapper(void) {
-		for(unsigned int i=0; i<robotParts_.size(); ++i)
-			delete robotParts_[i];
 	}
 
 	/// \brief Checks whether the given robot state collides with the
-	/// environment or itself.
+	/// environment or itself. Every part's pose and world box is computed
+	/// once, then only the parts whose box overlaps the environment's and
+	/// the checked part pairs whose boxes overlap get an fcl::collide.
 	virtual bool isValid(const base::State *state) const {
 		fcl::CollisionRequest collisionRequest;
 		fcl::CollisionResult collisionResult;
 		fcl::Quaternion3f rot;
 		fcl::Vec3f pos;
-		fcl::Transform3f transform;
+		CollisionCheckCounts &counts = collisionCheckCounters.local();
+		counts.checks++;
+
+		for(std::size_t i = 0; i < robotParts_.size(); ++i) {
+			poseFromStateCallback_(pos, rot, extractState_(state, i));
+			partTransforms_[i].setTransform(rot, pos);
+			partBoxes_[i] = Box(*robotParts_[i], partTransforms_[i]);
+		}
 
-		if(environment_.num_tris > 0) {
+		if(environment_->num_tris > 0) {
 			// Performing collision checking with environment.
 			for(std::size_t i = 0; i < robotParts_.size(); ++i) {
-				poseFromStateCallback_(pos, rot, extractState_(state, i));
-				transform.setTransform(rot, pos);
-				if(fcl::collide(robotParts_[i], transform, &environment_,
+				counts.broadPhaseTests++;
+				if(!partBoxes_[i].overlaps(environmentBox_))
+					continue;
+				counts.narrowPhaseCalls++;
+				if(fcl::collide(robotParts_[i].get(), partTransforms_[i], environment_.get(),
 				                fcl::Transform3f(), collisionRequest, collisionResult) > 0)
 					return false;
 			}
 		}
 
-		// Checking for self collision
+		// Checking for self collision, sweep and prune along x. The order is kept
+		// from the last check so the insertion sort is usually a single pass.
 		if(selfCollision_) {
-			fcl::Transform3f trans_i, trans_j;
-			for(std::size_t i = 0 ; i < robotParts_.size(); ++i) {
-				poseFromStateCallback_(pos, rot, extractState_(state, i));
-				trans_i.setTransform(rot, pos);
+			const std::size_t n = robotParts_.size();
+			for(std::size_t a = 1; a < n; ++a) {
+				unsigned int part = partOrder_[a];
+				std::size_t b = a;
+				for(; b > 0 && partBoxes_[partOrder_[b - 1]].low[0] > partBoxes_[part].low[0]; --b)
+					partOrder_[b] = partOrder_[b - 1];
+				partOrder_[b] = part;
+			}
 
-				for(std::size_t j  = i + 1 ; j < robotParts_.size(); ++j) {
-					poseFromStateCallback_(pos, rot, extractState_(state, j));
-					trans_j.setTransform(rot, pos);
-					if(fcl::collide(robotParts_[i], trans_i, robotParts_[j], trans_j,
+			for(std::size_t a = 0; a < n; ++a) {
+				for(std::size_t b = a + 1; b < n; ++b) {
+					unsigned int i = std::min(partOrder_[a], partOrder_[b]);
+					unsigned int j = std::max(partOrder_[a], partOrder_[b]);
+					if(partBoxes_[partOrder_[b]].low[0] > partBoxes_[partOrder_[a]].high[0])
+						break;
+					if(!checkPair_[i * n + j])
+						continue;
+					counts.broadPhaseTests++;
+					if(!partBoxes_[i].overlaps(partBoxes_[j]))
+						continue;
+					counts.narrowPhaseCalls++;
+					if(fcl::collide(robotParts_[i].get(), partTransforms_[i], robotParts_[j].get(), partTransforms_[j],
 					                collisionRequest, collisionResult) > 0)
 						return false;
 				}
@@ -108,7 +159,7 @@ public:
 		fcl::ContinuousCollisionResult collisionResult;
 
 		// Checking for collision with environment
-		if(environment_.num_tris > 0) {
+		if(environment_->num_tris > 0) {
 			for(size_t i = 0; i < robotParts_.size(); ++i) {
 				// Getting the translation and rotation from s1 and s2
 				poseFromStateCallback_(pos, rot, extractState_(s1, i));
@@ -117,8 +168,8 @@ public:
 				transi_end.setTransform(rot, pos);
 
 				// Checking for collision
-				fcl::continuousCollide(robotParts_[i], transi_beg, transi_end,
-				                       &environment_, trans, trans,
+				fcl::continuousCollide(robotParts_[i].get(), transi_beg, transi_end,
+				                       environment_.get(), trans, trans,
 				                       collisionRequest, collisionResult);
 				if(collisionResult.is_collide) {
 					collisionTime = collisionResult.time_of_contact;
@@ -143,8 +194,8 @@ public:
 					transj_end.setTransform(rot, pos);
 
 					// Checking for collision
-					fcl::continuousCollide(robotParts_[i], transi_beg, transi_end,
-					                       robotParts_[j], transj_beg, transj_end,
+					fcl::continuousCollide(robotParts_[i].get(), transi_beg, transi_end,
+					                       robotParts_[j].get(), transj_beg, transj_end,
 					                       collisionRequest, collisionResult);
 					if(collisionResult.is_collide) {
 						collisionTime = collisionResult.time_of_contact;
@@ -159,7 +210,7 @@ public:
 	/// \brief Returns the minimum distance from the given robot state and the environment
 	virtual double clearance(const base::State *state) const {
 		double minDist = std::numeric_limits<double>::infinity();
-		if(environment_.num_tris > 0) {
+		if(environment_->num_tris > 0) {
 			fcl::DistanceRequest distanceRequest(true);
 			fcl::DistanceResult distanceResult;
 			fcl::Transform3f trans, trans_env;
@@ -169,7 +220,7 @@ public:
 			for(size_t i = 0; i < robotParts_.size(); ++i) {
 				poseFromStateCallback_(pos, rot, extractState_(state, i));
 				trans.setTransform(rot, pos);
-				fcl::initialize(distanceNode, *robotParts_[i], trans, environment_, trans_env, distanceRequest, distanceResult);
+				fcl::initialize(distanceNode, *robotParts_[i], trans, *environment_, trans_env, distanceRequest, distanceResult);
 				fcl::distance(&distanceNode);
 				if(distanceResult.min_distance < minDist)
 					minDist = distanceResult.min_distance;
@@ -179,42 +230,100 @@ public:
 		return minDist;
 	}
 
+	/// \brief Where one robot part is in some state
+	struct PartPose {
+		fcl::Vec3f position;
+		fcl::Quaternion3f rotation;
+	};
+
+	void getPartPoses(const base::State *state, std::vector<PartPose> &poses) const {
+		poses.resize(robotParts_.size());
+		for(std::size_t i = 0; i < robotParts_.size(); ++i)
+			poseFromStateCallback_(poses[i].position, poses[i].rotation, extractState_(state, i));
+	}
+
+	/// \brief Upper bound on how far any point of the robot moves between poses a and b, the
+	/// translation plus the part's radius times the rotation angle. Along an interpolation
+	/// (linear translation, shortest rotation) the points move at most this times the fraction.
+	double motionBound(const std::vector<PartPose> &a, const std::vector<PartPose> &b) const {
+		double bound = 0;
+		for(std::size_t i = 0; i < robotParts_.size(); ++i) {
+			const fcl::Quaternion3f &p = a[i].rotation, &q = b[i].rotation;
+			double dot = std::fabs(p.getW() * q.getW() + p.getX() * q.getX() + p.getY() * q.getY() + p.getZ() * q.getZ());
+			double angle = 2 * std::acos(std::min(1.0, dot));
+			bound = std::max(bound, (b[i].position - a[i].position).length() + partRadius_[i] * angle);
+		}
+		return bound;
+	}
+
+	bool checksSelfCollision() const {
+		return selfCollision_;
+	}
+
+	std::size_t getRobotPartCount() const {
+		return robotParts_.size();
+	}
+
+	/// \brief Farthest vertex of any robot part from the part's origin
+	double getRobotRadius() const {
+		double radius = 0;
+		for(std::size_t i = 0; i < partRadius_.size(); ++i)
+			radius = std::max(radius, partRadius_[i]);
+		return radius;
+	}
+
+	const FCLModelCache::ModelPtr &getEnvironmentModel() const {
+		return environment_;
+	}
+
 protected:
 
 	/// \brief Configures the geometry of the robot and the environment
-	/// to setup validity checking.
+	/// to setup validity checking. The BVH models come from FCLModelCache,
+	/// so every wrapper over the same meshes shares them.
 	void configure(const GeometrySpecification &geom) {
 		// Configuring the model of the environment
-		environment_.beginModel();
 		std::pair <std::vector <fcl::Vec3f>, std::vector<fcl::Triangle> > tri_model;
 		tri_model = getFCLModelFromScene(geom.obstacles, geom.obstaclesShift);
-		environment_.addSubModel(tri_model.first, tri_model.second);
-
-		environment_.endModel();
-		environment_.computeLocalAABB();
+		environment_ = FCLModelCache::get(tri_model.first, tri_model.second);
 
-		if(environment_.num_tris == 0)
+		if(environment_->num_tris == 0)
 			OMPL_INFORM("Empty environment loaded");
 		else
-			OMPL_INFORM("Loaded environment model with %d triangles.", environment_.num_tris);
+			OMPL_INFORM("Loaded environment model with %d triangles.", environment_->num_tris);
 
 		// Configuring the model of the robot, composed of one or more pieces
 		for(size_t rbt = 0; rbt < geom.robot.size(); ++rbt) {
-			Model *model = new Model();
-			model->beginModel();
 			aiVector3D shift(0.0, 0.0, 0.0);
 			if(geom.robotShift.size() > rbt)
 				shift = geom.robotShift[rbt];
 
 			tri_model = getFCLModelFromScene(geom.robot[rbt], shift);
-			model->addSubModel(tri_model.first, tri_model.second);
-
-			model->endModel();
-			model->computeLocalAABB();
+			ModelPtr model = FCLModelCache::get(tri_model.first, tri_model.second);
 
 			OMPL_INFORM("Robot piece with %d triangles loaded", model->num_tris);
 			robotParts_.push_back(model);
 		}
+
+		// How far the farthest vertex of every part is from its origin, for motionBound
+		partRadius_.assign(robotParts_.size(), 0);
+		for(std::size_t i = 0; i < robotParts_.size(); ++i)
+			for(int k = 0; k < robotParts_[i]->num_vertices; ++k)
+				partRadius_[i] = std::max(partRadius_[i], (double)robotParts_[i]->vertices[k].length());
+
+		environmentBox_ = Box(*environment_, fcl::Transform3f());
+
+		// Parts that may touch each other, and the per check scratch space
+		const std::size_t n = robotParts_.size();
+		checkPair_.assign(n * n, 1);
+		if(fclSkipAdjacentParts)
+			for(std::size_t i = 0; i + 1 < n; ++i)
+				checkPair_[i * n + i + 1] = 0;
+		partTransforms_.resize(n);
+		partBoxes_.resize(n);
+		partOrder_.resize(n);
+		for(std::size_t i = 0; i < n; ++i)
+			partOrder_[i] = i;
 	}
 
 	/// \brief Convert a mesh to a FCL BVH model
@@ -256,15 +365,60 @@ protected:
 	}
 
 	/// \brief The type of geometric bounding done for the robot and environment
-	typedef fcl::OBBRSS  BVType;
+	typedef FCLModelCache::BVType BVType;
 	/// \brief The type geometric model used for the meshes
-	typedef fcl::BVHModel <BVType> Model;
+	typedef FCLModelCache::Model Model;
+	/// \brief A built model, shared and never changed
+	typedef FCLModelCache::ModelPtr ModelPtr;
+
+	/// \brief World axis aligned box around a model's local AABB
+	struct Box {
+		Box() {}
+
+		Box(const Model &model, const fcl::Transform3f &transform) {
+			const fcl::Matrix3f &rotation = transform.getRotation();
+			const fcl::Vec3f &translation = transform.getTranslation();
+			fcl::Vec3f center = (model.aabb_local.min_ + model.aabb_local.max_) * 0.5;
+			fcl::Vec3f extent = (model.aabb_local.max_ - model.aabb_local.min_) * 0.5;
+			for(unsigned int d = 0; d < 3; ++d) {
+				double c = translation[d], e = 0;
+				for(unsigned int k = 0; k < 3; ++k) {
+					c += rotation(d, k) * center[k];
+					e += std::fabs(rotation(d, k)) * extent[k];
+				}
+				low[d] = c - e;
+				high[d] = c + e;
+			}
+		}
+
+		bool overlaps(const Box &other) const {
+			return low[0] <= other.high[0] && other.low[0] <= high[0] &&
+			       low[1] <= other.high[1] && other.low[1] <= high[1] &&
+			       low[2] <= other.high[2] && other.low[2] <= high[2];
+		}
+
+		double low[3], high[3];
+	};
 
 	/// \brief Geometric model used for the environment
-	Model environment_;
+	ModelPtr environment_;
+
+	/// \brief Farthest vertex of every robot part from the part's origin
+	std::vector<double> partRadius_;
+
+	/// \brief Box of the environment, the static side of the broad phase
+	Box environmentBox_;
+
+	/// \brief checkPair_[i * parts + j] for i < j says if parts i and j are checked against each other
+	std::vector<char> checkPair_;
+
+	/// \brief Per check scratch space: part poses, their world boxes and the parts ordered by low x
+	mutable std::vector<fcl::Transform3f> partTransforms_;
+	mutable std::vector<Box> partBoxes_;
+	mutable std::vector<unsigned int> partOrder_;
 
 	/// \brief List of components for the geometric model of the robot
-	mutable std::vector <Model *> robotParts_;
+	std::vector <ModelPtr> robotParts_;
 
 	/// \brief Callback to get the geometric portion of a specific state
 	GeometricStateExtractor     extractState_;
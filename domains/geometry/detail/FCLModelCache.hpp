@@ -0,0 +1,324 @@
+#ifndef OMPLAPP_GEOMETRY_DETAIL_FCL_MODEL_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_FCL_MODEL_CACHE_
+
+/* Built FCL models, shared in the process and optionally saved between processes.
+
+Every mesh (robot piece or environment, already shifted) is keyed by a hash of its triangles. Checkers that
+ask for the same triangles get the same model, so the control domain, the geometric abstract domain and
+all their thread local checkers build each mesh once. The models are never changed after they are built
+and the OBBRSS queries FCLMethodWrapper makes only read them.
+
+With fclModelCacheDirectory set (the CollisionModelCache key) the BVH is also saved to disk. FCL has no
+serializer for BVHModel, so what gets saved is the build itself: the bounding volume the fitter returned
+for every node and the side the splitter put every primitive on, in the order buildTree asked for them. A
+later process replays them through the bv_fitter / bv_splitter extension points, which skips every
+covariance, eigen decomposition and split rule and gives back exactly the same tree. A file that doesn't
+replay to the end (different FCL, stale file) is ignored and the model is built and saved again.
+*/
+
+#include <fcl/BVH/BVH_model.h>
+#include <fcl/BVH/BV_fitter.h>
+#include <fcl/BVH/BV_splitter.h>
+#include <fcl/BV/OBBRSS.h>
+
+#include <ompl/util/Console.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace ompl {
+namespace app {
+
+/// \brief Directory for saved BVH builds, empty only shares them within the process
+std::string fclModelCacheDirectory;
+
+class FCLModelCache {
+public:
+	typedef fcl::OBBRSS BVType;
+	typedef fcl::BVHModel<BVType> Model;
+	typedef boost::shared_ptr<const Model> ModelPtr;
+
+	/// \brief The model of these triangles, the same instance for everyone asking while it is alive
+	static ModelPtr get(const std::vector<fcl::Vec3f> &points, const std::vector<fcl::Triangle> &triangles) {
+		uint64_t key = hash(points, triangles);
+
+		static boost::mutex mutex;
+		static std::map<uint64_t, boost::weak_ptr<const Model> > models;
+		boost::mutex::scoped_lock lock(mutex);
+
+		ModelPtr model = models[key].lock();
+		if(!model) {
+			model = build(key, points, triangles);
+			models[key] = model;
+		}
+		return model;
+	}
+
+private:
+	static const uint32_t Version = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t volumeSize;
+		uint64_t key;
+		uint64_t volumeCount;
+		uint64_t splitCount;
+	};
+
+	/* the fitter's volumes and the splitter's decisions of one build, in call order */
+	struct Recording {
+		std::vector<BVType> volumes;
+		std::vector<bool> splits;
+		size_t nextVolume = 0, nextSplit = 0;
+		bool exhausted = false;
+
+		bool replayedAll() const {
+			return !exhausted && nextVolume == volumes.size() && nextSplit == splits.size();
+		}
+	};
+
+	class RecordingFitter : public fcl::BVFitterBase<BVType> {
+	public:
+		RecordingFitter(Recording &recording) : recording(recording) {}
+
+		void set(fcl::Vec3f *vertices, fcl::Triangle *triangles, fcl::BVHModelType type) {
+			fitter.set(vertices, triangles, type);
+		}
+
+		void set(fcl::Vec3f *vertices, fcl::Vec3f *previous, fcl::Triangle *triangles, fcl::BVHModelType type) {
+			fitter.set(vertices, previous, triangles, type);
+		}
+
+		BVType fit(unsigned int *primitives, int count) {
+			BVType volume = fitter.fit(primitives, count);
+			recording.volumes.push_back(volume);
+			return volume;
+		}
+
+		void clear() {
+			fitter.clear();
+		}
+
+	private:
+		fcl::BVFitter<BVType> fitter;
+		Recording &recording;
+	};
+
+	class RecordingSplitter : public fcl::BVSplitterBase<BVType> {
+	public:
+		RecordingSplitter(Recording &recording) : splitter(fcl::SPLIT_METHOD_MEAN), recording(recording) {}
+
+		void set(fcl::Vec3f *vertices, fcl::Triangle *triangles, fcl::BVHModelType type) {
+			splitter.set(vertices, triangles, type);
+		}
+
+		void computeRule(const BVType &volume, unsigned int *primitives, int count) {
+			splitter.computeRule(volume, primitives, count);
+		}
+
+		bool apply(const fcl::Vec3f &q) const {
+			bool side = splitter.apply(q);
+			recording.splits.push_back(side);
+			return side;
+		}
+
+		void clear() {
+			splitter.clear();
+		}
+
+	private:
+		fcl::BVSplitter<BVType> splitter;
+		Recording &recording;
+	};
+
+	// falls back to fitting for real if the recording runs out, the build is then thrown away
+	class ReplayFitter : public fcl::BVFitterBase<BVType> {
+	public:
+		ReplayFitter(Recording &recording) : recording(recording) {}
+
+		void set(fcl::Vec3f *vertices, fcl::Triangle *triangles, fcl::BVHModelType type) {
+			fitter.set(vertices, triangles, type);
+		}
+
+		void set(fcl::Vec3f *vertices, fcl::Vec3f *previous, fcl::Triangle *triangles, fcl::BVHModelType type) {
+			fitter.set(vertices, previous, triangles, type);
+		}
+
+		BVType fit(unsigned int *primitives, int count) {
+			if(recording.nextVolume < recording.volumes.size()) {
+				return recording.volumes[recording.nextVolume++];
+			}
+			recording.exhausted = true;
+			return fitter.fit(primitives, count);
+		}
+
+		void clear() {
+			fitter.clear();
+		}
+
+	private:
+		fcl::BVFitter<BVType> fitter;
+		Recording &recording;
+	};
+
+	class ReplaySplitter : public fcl::BVSplitterBase<BVType> {
+	public:
+		ReplaySplitter(Recording &recording) : recording(recording) {}
+
+		void set(fcl::Vec3f *, fcl::Triangle *, fcl::BVHModelType) {}
+
+		void computeRule(const BVType &, unsigned int *, int) {}
+
+		bool apply(const fcl::Vec3f &) const {
+			if(recording.nextSplit < recording.splits.size()) {
+				return recording.splits[recording.nextSplit++];
+			}
+			recording.exhausted = true;
+			return false;
+		}
+
+		void clear() {}
+
+	private:
+		Recording &recording;
+	};
+
+	static uint64_t hash(const std::vector<fcl::Vec3f> &points, const std::vector<fcl::Triangle> &triangles) {
+		uint64_t h = 14695981039346656037ULL;
+		auto add = [&h](double value) {
+			unsigned char bytes[sizeof(value)];
+			memcpy(bytes, &value, sizeof(value));
+			for(unsigned int i = 0; i < sizeof(value); ++i) {
+				h = (h ^ bytes[i]) * 1099511628211ULL;
+			}
+		};
+		add(points.size());
+		for(const fcl::Vec3f &point : points) {
+			add(point[0]);
+			add(point[1]);
+			add(point[2]);
+		}
+		add(triangles.size());
+		for(const fcl::Triangle &triangle : triangles) {
+			add(triangle[0]);
+			add(triangle[1]);
+			add(triangle[2]);
+		}
+		return h;
+	}
+
+	static ModelPtr build(uint64_t key, const std::vector<fcl::Vec3f> &points, const std::vector<fcl::Triangle> &triangles) {
+		if(fclModelCacheDirectory.empty()) {
+			return make(points, triangles, NULL, NULL);
+		}
+
+		char name[32];
+		snprintf(name, sizeof(name), "bvh-%016llx.bvh", (unsigned long long)key);
+		std::string path = fclModelCacheDirectory + "/" + name;
+
+		Recording recording;
+		if(load(path, key, recording)) {
+			ModelPtr model = make(points, triangles, new ReplayFitter(recording), new ReplaySplitter(recording));
+			if(recording.replayedAll()) {
+				return model;
+			}
+			OMPL_WARN("ignoring stale BVH cache file %s", path.c_str());
+			recording = Recording();
+		}
+
+		ModelPtr model = make(points, triangles, new RecordingFitter(recording), new RecordingSplitter(recording));
+		if(!save(path, key, recording)) {
+			OMPL_WARN("could not write BVH cache file %s", path.c_str());
+		}
+		return model;
+	}
+
+	// the model goes back to FCL's own fitter and splitter once it is built, the recording doesn't outlive build()
+	static ModelPtr make(const std::vector<fcl::Vec3f> &points, const std::vector<fcl::Triangle> &triangles,
+	                     fcl::BVFitterBase<BVType> *fitter, fcl::BVSplitterBase<BVType> *splitter) {
+		boost::shared_ptr<Model> model(new Model());
+		if(fitter != NULL) {
+			model->bv_fitter.reset(fitter);
+			model->bv_splitter.reset(splitter);
+		}
+
+		model->beginModel();
+		model->addSubModel(points, triangles);
+		model->endModel();
+		model->computeLocalAABB();
+
+		if(fitter != NULL) {
+			model->bv_fitter.reset(new fcl::BVFitter<BVType>());
+			model->bv_splitter.reset(new fcl::BVSplitter<BVType>(fcl::SPLIT_METHOD_MEAN));
+		}
+		return model;
+	}
+
+	static bool load(const std::string &path, uint64_t key, Recording &recording) {
+		FILE *file = fopen(path.c_str(), "rb");
+		if(file == NULL) return false;
+
+		Header header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "BEASTBVH", 8) == 0 &&
+		          header.version == Version && header.volumeSize == sizeof(BVType) && header.key == key;
+		if(ok) {
+			recording.volumes.resize(header.volumeCount);
+			ok = header.volumeCount == 0 || fread(recording.volumes.data(), sizeof(BVType), header.volumeCount, file) == header.volumeCount;
+		}
+		if(ok) {
+			std::vector<unsigned char> bits((header.splitCount + 7) / 8);
+			ok = bits.empty() || fread(bits.data(), 1, bits.size(), file) == bits.size();
+			recording.splits.resize(header.splitCount);
+			for(uint64_t i = 0; ok && i < header.splitCount; ++i) {
+				recording.splits[i] = (bits[i / 8] >> (i % 8)) & 1;
+			}
+		}
+		fclose(file);
+		return ok;
+	}
+
+	// written to a temporary name and renamed, so processes starting side by side never read half a file
+	static bool save(const std::string &path, uint64_t key, const Recording &recording) {
+		Header header;
+		memcpy(header.magic, "BEASTBVH", 8);
+		header.version = Version;
+		header.volumeSize = sizeof(BVType);
+		header.key = key;
+		header.volumeCount = recording.volumes.size();
+		header.splitCount = recording.splits.size();
+
+		std::vector<unsigned char> bits((recording.splits.size() + 7) / 8, 0);
+		for(size_t i = 0; i < recording.splits.size(); ++i) {
+			if(recording.splits[i]) bits[i / 8] |= 1 << (i % 8);
+		}
+
+		std::string temporary = path + ".tmp" + std::to_string(getpid());
+		FILE *file = fopen(temporary.c_str(), "wb");
+		if(file == NULL) return false;
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+		written = written && (recording.volumes.empty() ||
+		                      fwrite(recording.volumes.data(), sizeof(BVType), recording.volumes.size(), file) == recording.volumes.size());
+		written = written && (bits.empty() || fwrite(bits.data(), 1, bits.size(), file) == bits.size());
+		written = fclose(file) == 0 && written;
+		if(!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+};
+
+}
+}
+
+#endif
@@ -21,6 +21,8 @@
 #include <ompl/base/spaces/SE3StateSpace.h>
 
 #include "FCLMethodWrapper.hpp"
+#include "../../../structs/timing.hpp"
+#include "../../../structs/validitycache.hpp"
 #include "../GeometrySpecification.hpp"
 
 // Boost and STL headers
@@ -61,12 +63,16 @@ struct OMPL_FCL_StateType<Motion_2D> {
 };
 /// @endcond
 
+/// \brief Answer checks with clearance queries and skip the ones that stay within the last clearance
+bool fclClearanceReuse = false;
+
 /// \brief Wrapper for FCL collision and distance checking
 template<MotionModel T>
 class FCLStateValidityChecker : public ob::StateValidityChecker {
 public:
 	FCLStateValidityChecker(const ob::SpaceInformationPtr &si, const GeometrySpecification &geom,
 	                        const GeometricStateExtractor &se, bool selfCollision) : ob::StateValidityChecker(si),
+		extractState_(se), cacheable_(geom.robot.size() == 1 && !selfCollision), reuseClearance_(fclClearanceReuse && !selfCollision),
 		fclWrapper_(new FCLMethodWrapper(geom, se, selfCollision, boost::bind(&OMPL_FCL_StateType<T>::FCLPoseFromState, stateConvertor_, _1, _2, _3))) {
 		specs_.clearanceComputationType = base::StateValidityCheckerSpecs::EXACT;
 	}
@@ -77,7 +83,20 @@ public:
 	/// \brief Checks whether the given robot state collides with the
 	/// environment or itself.
 	virtual bool isValid(const ob::State *state) const {
-		return si_->satisfiesBounds(state) && fclWrapper_->isValid(state);
+		PHASE_SCOPE(CollisionCheck);
+		if(!si_->satisfiesBounds(state))
+			return false;
+		if(!validityCache_)
+			return isCollisionFree(state);
+
+		ValidityCache::Pose pose = getCachePose(static_cast<const typename OMPL_FCL_StateType<T>::type *>(extractState_(state, 0)));
+		ValidityCache::Result cached = validityCache_->lookup(pose);
+		if(cached != ValidityCache::Unknown)
+			return cached == ValidityCache::Valid;
+
+		bool valid = isCollisionFree(state);
+		validityCache_->store(pose, valid);
+		return valid;
 	}
 
 	/// \brief Returns the minimum distance from the given robot state and the environment
@@ -89,11 +108,61 @@ public:
 		return fclWrapper_;
 	}
 
+	/// \brief Share a cache of collision results, ignored when the check isn't a single robot's pose
+	void setValidityCache(const std::shared_ptr<ValidityCache> &cache) {
+		if(cacheable_)
+			validityCache_ = cache;
+	}
+
 protected:
 
+	static ValidityCache::Pose getCachePose(const ob::SE2StateSpace::StateType *state) {
+		return ValidityCache::Pose(state->getX(), state->getY(), state->getYaw());
+	}
+
+	static ValidityCache::Pose getCachePose(const ob::SE3StateSpace::StateType *state) {
+		const ob::SO3StateSpace::StateType &q = state->rotation();
+		return ValidityCache::Pose(state->getX(), state->getY(), state->getZ(), q.x, q.y, q.z, q.w);
+	}
+
+	/// \brief With clearance reuse, a state is valid without a query if the robot can't have
+	/// moved as far as the clearance of the last valid state queried, which is what
+	/// consecutive steps of propagateWhileValid mostly are
+	bool isCollisionFree(const ob::State *state) const {
+		if(!reuseClearance_)
+			return fclWrapper_->isValid(state);
+
+		fclWrapper_->getPartPoses(state, poses_);
+		if(margin_ > 0 && fclWrapper_->motionBound(safePoses_, poses_) < margin_) {
+			collisionCheckCounters.local().clearanceSkips++;
+			return true;
+		}
+
+		double clearance = fclWrapper_->clearance(state);
+		if(clearance <= 0)
+			return false;
+		safePoses_.swap(poses_);
+		margin_ = clearance;
+		return true;
+	}
+
 	/// \brief Object to convert a configuration of the robot to a type desirable for FCL
 	OMPL_FCL_StateType<T>       stateConvertor_;
 
+	GeometricStateExtractor     extractState_;
+
+	/// \brief Whether a result only depends on the first robot's pose
+	bool                        cacheable_;
+
+	std::shared_ptr<ValidityCache> validityCache_;
+
+	/// \brief Whether checks go through isCollisionFree's clearance reuse (never with self collision)
+	bool                        reuseClearance_;
+
+	/// \brief The last valid state queried and its clearance
+	mutable std::vector<FCLMethodWrapper::PartPose> safePoses_, poses_;
+	mutable double              margin_ = 0;
+
 	/// \brief Wrapper for FCL collision and distance methods
 	FCLMethodWrapperPtr         fclWrapper_;
 
@@ -16,20 +16,12 @@
 #include <ompl/tools/benchmark/Benchmark.h>
 #include "../planners/beastplannergeometric.hpp"
 
+#include "detail/segmentlanes.hpp"
+
 #include <boost/math/constants/constants.hpp>
 #include <boost/format.hpp>
 #include <fstream>
 
-// a 2D line segment
-struct Segment
-{
-  Segment(double p0_x, double p0_y, double p1_x, double p1_y)
-      : x0(p0_x), y0(p0_y), x1(p1_x), y1(p1_y)
-  {
-  }
-  double x0, y0, x1, y1;
-};
-
 // the robot and environment are modeled both as a vector of segments.
 using Environment = std::vector<Segment>;
 
@@ -105,6 +97,11 @@ class KinematicChainSpace : public ompl::base::CompoundStateSpace
 };
 
 
+/* The chain is checked through SegmentLanes: the links are written into lanes once per call (no
+allocation after the first one), every link is tested only against blocks whose box it overlaps,
+and consecutive links are never tested against each other, they share a joint and segmentsIntersect
+never counts that as an intersection. Keeps its lanes between calls, so like the FCL checkers an
+instance is for one thread at a time. */
 class KinematicChainValidityChecker : public ompl::base::StateValidityChecker
 {
  public:
@@ -118,73 +115,39 @@ class KinematicChainValidityChecker : public ompl::base::StateValidityChecker
     const KinematicChainSpace* space = si_->getStateSpace()->as<KinematicChainSpace>();
     const KinematicChainSpace::StateType *s = state->as<KinematicChainSpace::StateType>();
     unsigned int n = si_->getStateDimension();
-    Environment segments;
     double linkLength = space->linkLength();
     double theta = 0., x = 0., y = 0., xN, yN;
 
-    segments.reserve(n + 1);
+    links_.resize(n + 1);
     for(unsigned int i = 0; i < n; ++i)
     {
       theta += s->as<ompl::base::SO2StateSpace::StateType>(i)->value;
       xN = x + cos(theta) * linkLength;
       yN = y + sin(theta) * linkLength;
-      segments.emplace_back(x, y, xN, yN);
+      links_.set(i, Segment(x, y, xN, yN));
       x = xN;
       y = yN;
     }
     xN = x + cos(theta) * 0.001;
     yN = y + sin(theta) * 0.001;
-    segments.emplace_back(x, y, xN, yN);
-    return selfIntersectionTest(segments)
-        && environmentIntersectionTest(segments, *space->environment());
-  }
+    links_.set(n, Segment(x, y, xN, yN));
+    links_.computeBoxes();
 
- protected:
-  // return true iff env does *not* include a pair of intersecting segments
-  bool selfIntersectionTest(const Environment& env) const
-  {
-    for (unsigned int i = 0; i < env.size(); ++i)
-      for (unsigned int j = i + 1; j < env.size(); ++j)
-        if (intersectionTest(env[i], env[j]))
-          return false;
-    return true;
-  }
-  // return true iff no segment in env0 intersects any segment in env1
-  bool environmentIntersectionTest(const Environment& env0, const Environment& env1) const
-  {
-    for (const auto & i : env0)
-      for (const auto & j : env1)
-        if (intersectionTest(i, j))
-          return false;
-    return true;
-  }
-  // return true iff segment s0 intersects segment s1
-  bool intersectionTest(const Segment& s0, const Segment& s1) const
-  {
-    // adopted from:
-    // http://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/1201356#1201356
-    double s10_x = s0.x1 - s0.x0;
-    double s10_y = s0.y1 - s0.y0;
-    double s32_x = s1.x1 - s1.x0;
-    double s32_y = s1.y1 - s1.y0;
-    double denom = s10_x * s32_y - s32_x * s10_y;
-    if (fabs(denom) < std::numeric_limits<double>::epsilon())
-      return false; // Collinear
-    bool denomPositive = denom > 0;
+    if(space->environment() != environmentSource_)
+    {
+      environmentSource_ = space->environment();
+      environment_.resize(environmentSource_->size());
+      for(unsigned int i = 0; i < environmentSource_->size(); ++i)
+        environment_.set(i, (*environmentSource_)[i]);
+      environment_.computeBoxes();
+    }
 
-    double s02_x = s0.x0 - s1.x0;
-    double s02_y = s0.y0 - s1.y0;
-    double s_numer = s10_x * s02_y - s10_y * s02_x;
-    if ((s_numer < std::numeric_limits<float>::epsilon()) == denomPositive)
-      return false; // No collision
-    double t_numer = s32_x * s02_y - s32_y * s02_x;
-    if ((t_numer < std::numeric_limits<float>::epsilon()) == denomPositive)
-      return false; // No collision
-    if (((s_numer - denom > -std::numeric_limits<float>::epsilon()) == denomPositive)
-        || ((t_numer - denom > std::numeric_limits<float>::epsilon()) == denomPositive))
-      return false; // No collision
-    return true;
+    return !links_.intersectsItself() && !links_.intersects(environment_);
   }
+
+ protected:
+  mutable SegmentLanes links_, environment_;
+  mutable const Environment *environmentSource_ = nullptr;
 };
 
 
@@ -205,7 +205,8 @@ BenchmarkData robotArmBenchmark(const FileMap &params) {
 	ompl::app::SE3RigidBodyPlanning *abstract = new ompl::app::SE3RigidBodyPlanning();
 
 	AbstractRobotArmValidStateSampler::robotArmPlanning = arm;
-	abstract->getSpaceInformation()->setValidStateSamplerAllocator(RobotArmValidStateSamplerAllocator);
+	globalParameters.abstractValidStateSamplerAllocator = RobotArmValidStateSamplerAllocator;
+	abstract->getSpaceInformation()->setValidStateSamplerAllocator(globalParameters.abstractValidStateSamplerAllocator);
 
 	globalParameters.globalAbstractAppBaseGeometric = abstract;
 
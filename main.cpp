@@ -5,6 +5,8 @@ GlobalParameters globalParameters;
 
 #include <flann/flann.h>
 
+#include <thread>
+
 #include <ompl/control/planners/rrt/RRT.h>
 #include <ompl/control/planners/est/EST.h>
 #include <ompl/control/planners/kpiece/KPIECE1.h>
@@ -17,6 +19,7 @@ GlobalParameters globalParameters;
 #include <ompl/control/planners/pdst/PDST.h>
 
 #include "structs/filemap.hpp"
+#include "structs/batchruns.hpp"
 
 #include "domains/DynamicCarPlanning.hpp"
 #include "domains/KinematicCarPlanning.hpp"
@@ -47,7 +50,7 @@ GlobalParameters globalParameters;
 // #include "planners/atemptsplanner.hpp"
 
 
-void doBenchmarkRun(BenchmarkData benchmarkData, const FileMap &params) {
+bool doBenchmarkRun(BenchmarkData benchmarkData, const FileMap &params) {
   auto planner = params.stringVal("Planner");
 
   ompl::base::PlannerPtr plannerPointer;
@@ -95,7 +98,7 @@ void doBenchmarkRun(BenchmarkData benchmarkData, const FileMap &params) {
       // plannerPointer = ompl::base::PlannerPtr(new ompl::control::AtemptsPlanner(benchmarkData.simplesetup->getSpaceInformation(), params));
   } else {
     fprintf(stderr, "unrecognized planner\n");
-    return;
+    return false;
   }
 
   //allow unpenalized time for precomputation -- which is logged to the output file
@@ -107,6 +110,41 @@ void doBenchmarkRun(BenchmarkData benchmarkData, const FileMap &params) {
     plannerPointer->params().setParam("intermediate_states", "true");
   }
   benchmarkData.benchmark->addPlanner(plannerPointer);
+
+  //per phase wall time, steering, collision check and validity cache counts of every run go into the log next to OMPL's own run properties
+  benchmarkData.benchmark->setPreRunEvent([](const ompl::base::PlannerPtr &) {
+    phaseCounters.reset();
+    steeringCounters.reset();
+    validityCacheCounters.reset();
+    ompl::app::collisionCheckCounters.reset();
+    clearValidityCaches();
+  });
+  benchmarkData.benchmark->setPostRunEvent([](const ompl::base::PlannerPtr &, ompl::tools::Benchmark::RunProperties &run) {
+#ifdef PHASE_TIMING
+    for(unsigned int i = 0; i < PhaseCounters::PhaseCount; ++i) {
+      std::string name = std::string("phase ") + PhaseCounters::getName(i);
+      run[name + " time REAL"] = std::to_string(phaseCounters.getSeconds(i));
+      run[name + " calls INTEGER"] = std::to_string(phaseCounters.getCalls(i));
+    }
+#endif
+    SteeringCounts steering = steeringCounters.get();
+    run["steer calls INTEGER"] = std::to_string(steering.calls);
+    run["steer candidates INTEGER"] = std::to_string(steering.candidates);
+    run["steer propagation steps INTEGER"] = std::to_string(steering.propagationSteps);
+    run["steer early outs INTEGER"] = std::to_string(steering.earlyOuts);
+    ompl::app::CollisionCheckCounts collisions = ompl::app::collisionCheckCounters.get();
+    run["collision checks INTEGER"] = std::to_string(collisions.checks);
+    run["collision broad phase tests INTEGER"] = std::to_string(collisions.broadPhaseTests);
+    run["collision narrow phase calls INTEGER"] = std::to_string(collisions.narrowPhaseCalls);
+    run["collision clearance skips INTEGER"] = std::to_string(collisions.clearanceSkips);
+    run["collision distance field decisions INTEGER"] = std::to_string(collisions.distanceFieldDecisions);
+    ValidityCacheCounts cache = validityCacheCounters.get();
+    run["validity cache hits INTEGER"] = std::to_string(cache.hits);
+    run["validity cache misses INTEGER"] = std::to_string(cache.misses);
+    if(cache.hits + cache.misses > 0)
+      run["validity cache hit rate REAL"] = std::to_string(double(cache.hits) / double(cache.hits + cache.misses));
+  });
+
   ompl::tools::Benchmark::Request req;
   req.maxTime = params.doubleVal("Timeout");
   req.maxMem = params.doubleVal("Memory");
@@ -129,17 +167,12 @@ void doBenchmarkRun(BenchmarkData benchmarkData, const FileMap &params) {
       outfile << solution.second << " " << solution.first.value() << "\n";
     }
     outfile.close();
-  }	
-}
-
-int main(int argc, char *argv[]) {
-  FileMap params;
-  if(argc > 1) {
-    params.append(argv[1]);
-  } else {
-    params.append(std::cin);
   }
+  return true;
+}
 
+// false if the domain or planner isn't recognized
+bool runInstance(const FileMap &params) {
   srand(params.integerVal("Seed"));
   flann::seed_random(params.integerVal("Seed"));
   ompl::RNG::setSeed(params.integerVal("Seed"));
@@ -148,38 +181,65 @@ int main(int argc, char *argv[]) {
   if(params.exists("NumControls"))
     howManyControls = params.integerVal("NumControls");
 
+  if(params.exists("NearestNeighbors"))
+    nearestNeighborsType = params.stringVal("NearestNeighbors");
+
+  if(params.exists("CollisionModelCache"))
+    ompl::app::fclModelCacheDirectory = params.stringVal("CollisionModelCache");
+
+  if(params.exists("SelfCollisionSkipAdjacent"))
+    ompl::app::fclSkipAdjacentParts = params.boolVal("SelfCollisionSkipAdjacent");
+
+  if(params.exists("ContinuousMotionValidation"))
+    ompl::app::fclContinuousMotionValidation = params.boolVal("ContinuousMotionValidation");
+
+  if(params.exists("ClearanceReuse"))
+    ompl::app::fclClearanceReuse = params.boolVal("ClearanceReuse");
+
+  if(params.exists("ValidityCacheResolution"))
+    validityCacheSettings.resolution = params.doubleVal("ValidityCacheResolution");
+  if(params.exists("ValidityCacheRotationResolution"))
+    validityCacheSettings.rotationResolution = params.doubleVal("ValidityCacheRotationResolution");
+  if(params.exists("ValidityCacheSize"))
+    validityCacheSettings.log2Size = params.integerVal("ValidityCacheSize");
+  if(params.exists("ValidityCacheConservative"))
+    validityCacheSettings.conservative = params.boolVal("ValidityCacheConservative");
+  if(params.exists("ValidityCacheInvalidCells"))
+    validityCacheSettings.invalidCells = params.boolVal("ValidityCacheInvalidCells");
+
   auto domain = params.stringVal("Domain");
   if(domain.compare("Blimp") == 0) {
     auto benchmarkData = blimpBenchmark(params);
     streamPoint = stream3DPoint;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   } else if(domain.compare("Quadrotor") == 0) {
     auto benchmarkData = quadrotorBenchmark(params);
     streamPoint = stream3DPoint;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   } else if(domain.compare("KinematicCar") == 0) {
     auto benchmarkData = carBenchmark<ompl::app::KinematicCarPlanning>(params);
     streamPoint = stream2DPoint2;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   } else if(domain.compare("DynamicCar") == 0) {
     auto benchmarkData = carBenchmark<ompl::app::DynamicCarPlanning>(params);
     streamPoint = stream2DPoint;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   } else if(domain.compare("StraightLine") == 0) {
     auto benchmarkData = straightLineBenchmark(params);
     streamPoint = stream2DPoint2;
     streamLine = stream2DLine2;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   }
   else if(domain.compare("Hovercraft") == 0) {
     auto benchmarkData = hovercraftBenchmark(params);
     streamPoint = stream2DPoint;
-    doBenchmarkRun(benchmarkData, params);
+    return doBenchmarkRun(benchmarkData, params);
   }
   else if(domain.compare("Linkage") == 0) {
     auto benchmarkData = linkageBenchmark(params);
     streamPoint = stream2DPoint;
     // doBenchmarkRun(benchmarkData, params);
+    return true;
   }
   // else if(domain.compare("RobotArm") == 0) {
   // 	auto benchmarkData = robotArmBenchmark(params);
@@ -193,6 +253,40 @@ int main(int argc, char *argv[]) {
   else {
     fprintf(stderr, "unrecognized domain\n");
   }
+  return false;
+}
+
+/* Batch mode: run every instance in BatchInstances (or just this file) once per seed in BatchSeeds,
+   BatchJobs at a time. Each run is a forked child (runForked), so the domain, abstraction and sampler globals
+   are never shared between runs. Every run keeps its own log, named as getBatchRuns describes. */
+int runBatch(const FileMap &batch) {
+  std::vector<FileMap> runs = getBatchRuns(batch);
+
+  unsigned int jobs = batch.exists("BatchJobs") ? batch.integerVal("BatchJobs") : std::thread::hardware_concurrency();
+  if(jobs == 0) jobs = 1;
+
+  fprintf(stderr, "running %lu benchmark runs %u at a time\n", runs.size(), jobs);
+
+  unsigned int failures = runForked(runs, jobs, runInstance);
+
+  fprintf(stderr, "run logs written to %s.<instance>.<seed>\n", batch.stringVal("Output").c_str());
+  if(failures > 0) {
+    fprintf(stderr, "%u of %lu benchmark runs failed\n", failures, runs.size());
+  }
+  return failures > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  FileMap params;
+  if(argc > 1) {
+    params.append(argv[1]);
+  } else {
+    params.append(std::cin);
+  }
+
+  if(params.exists("BatchInstances") || params.exists("BatchSeeds")) {
+    return runBatch(params);
+  }
 
-  return 0;
+  return runInstance(params) ? 0 : 1;
 }
@@ -158,19 +158,28 @@ public:
 			Motion     *existing = NULL;
 			Grid::Cell *ecell = NULL;
 
-			if(closeSamples.canSample() && rng_.uniform01() < goalBias_) {
-				if(!closeSamples.selectMotion(existing, ecell))
+			{
+				PHASE_SCOPE(Sample);
+				if(closeSamples.canSample() && rng_.uniform01() < goalBias_) {
+					if(!closeSamples.selectMotion(existing, ecell))
+						selectMotion(existing, ecell);
+				} else
 					selectMotion(existing, ecell);
-			} else
-				selectMotion(existing, ecell);
+			}
 			assert(existing);
 
 			/* sample a random control */
-			controlSampler_->sampleNext(rctrl, existing->control, existing->state);
+			{
+				PHASE_SCOPE(Steer);
+				controlSampler_->sampleNext(rctrl, existing->control, existing->state);
+			}
 
 			/* propagate */
 			unsigned int cd = controlSampler_->sampleStepCount(siC_->getMinControlDuration(), siC_->getMaxControlDuration());
-			cd = siC_->propagateWhileValid(existing->state, rctrl, cd, states, false);
+			{
+				PHASE_SCOPE(Propagate);
+				cd = siC_->propagateWhileValid(existing->state, rctrl, cd, states, false);
+			}
 
 			/* if we have enough steps */
 			if(cd >= siC_->getMinControlDuration()) {
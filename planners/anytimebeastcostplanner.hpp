@@ -76,7 +76,7 @@ class AnytimeBeastCostPlanner : public ompl::control::RRT {
 
   virtual base::PlannerStatus solve(const base::
                                     PlannerTerminationCondition &ptc) {
-    start = clock();
+    start = wallNow();
 
     checkValidity();
     base::Goal *goal = pdef_->getGoal().get();
@@ -151,7 +151,7 @@ class AnytimeBeastCostPlanner : public ompl::control::RRT {
     }
 
     if(!newsampler) {
-      auto start = clock();
+      auto start = wallNow();
 
       // if(params.stringVal("Sampler").compare("BEAST") == 0) {
       // newsampler = new ompl::base::AnytimeBeastSampler((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(), goal_s, optimizationObjective, params);
@@ -172,7 +172,7 @@ class AnytimeBeastCostPlanner : public ompl::control::RRT {
       newsampler->initialize();
 
       samplerInitializationTime =
-          (double)(clock() - start) / CLOCKS_PER_SEC;
+          secondsSince(start);
     }
 
     if(!sampler_)
@@ -416,7 +416,7 @@ class AnytimeBeastCostPlanner : public ompl::control::RRT {
     xi,
     n0,
     samplerInitializationTime = 0;
-  clock_t start;
+  WallTime start;
 
   const FileMap &params;
   CostPruningModule<MotionWithCost> *costPruningModule = NULL;
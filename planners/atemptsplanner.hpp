@@ -69,7 +69,7 @@ class AnytimeBeastPlannernew : public ompl::control::RRT {
     }
 
     virtual base::PlannerStatus solve(const base::PlannerTerminationCondition &ptc) {
-        start = clock();
+        start = wallNow();
 
         checkValidity();
         base::Goal                   *goal = pdef_->getGoal().get();
@@ -122,7 +122,7 @@ class AnytimeBeastPlannernew : public ompl::control::RRT {
         }
 
         if(!newsampler) {
-            auto start = clock();
+            auto start = wallNow();
 
             // if(params.stringVal("Sampler").compare("BEAST") == 0) {
             // newsampler = new ompl::base::AnytimeBeastSampler((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(), goal_s, optimizationObjective, params);
@@ -134,7 +134,7 @@ class AnytimeBeastPlannernew : public ompl::control::RRT {
             newsampler = new ompl::base::refactored::atempts::AnytimeBeastSampler_atempts((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(), goal_s, optimizationObjective, params);
             newsampler->initialize();
 
-            samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+            samplerInitializationTime = secondsSince(start);
         }
 
         if(!controlSampler_) {
@@ -327,7 +327,7 @@ class AnytimeBeastPlannernew : public ompl::control::RRT {
 	
     base::OptimizationObjectivePtr optimizationObjective;
     double propagationStepSize, selectionRadius, pruningRadius, xi, n0, samplerInitializationTime = 0;
-    clock_t start;
+    WallTime start;
 
     const FileMap &params;
     CostPruningModule<MotionWithCost> *costPruningModule = NULL;
@@ -6,6 +6,8 @@
 #include "ompl/tools/config/SelfConfig.h"
 
 #include "../structs/filemap.hpp"
+#include "../structs/threadpool.hpp"
+#include "../structs/motionarena.hpp"
 
 #include "../samplers/beastsampler_dstar.hpp"
 #include "../samplers/beastsampler_dijkstra.hpp"
@@ -20,9 +22,12 @@ class BeastPlanner : public ompl::control::RRT {
 
     /** \brief Constructor */
     BeastPlanner(const SpaceInformationPtr &si, const FileMap &params) :
-            ompl::control::RRT(si), newsampler_(NULL), params(params) {
+            ompl::control::RRT(si), newsampler_(NULL), params(params), motionArena(siC_) {
 
         whichSearch = params.stringVal("WhichSearch");
+        refinementInterval = params.exists("AbstractionRefinementInterval") ? params.integerVal("AbstractionRefinementInterval") : 0;
+        threads = params.exists("Threads") ? params.integerVal("Threads") : 1;
+        deterministicThreads = !params.exists("DeterministicThreads") || params.boolVal("DeterministicThreads");
 
         std::string plannerName = "BeastPlanner_" + whichSearch;
         setName(plannerName);
@@ -40,7 +45,13 @@ class BeastPlanner : public ompl::control::RRT {
         Planner::declareParam<double>("sampler_initialization_time", this, &BeastPlanner::ignoreSetterDouble, &BeastPlanner::getSamplerInitializationTime);
     }
 
-    virtual ~BeastPlanner() {}
+    virtual ~BeastPlanner() {
+        //the tree lives in motionArena, keep RRT from freeing it node by node
+        if(nn_)
+            nn_->clear();
+        for(auto state : propagationBuffer)
+            si_->freeState(state);
+    }
 
     void ignoreSetterDouble(double) const {}
     void ignoreSetterUnsigedInt(unsigned int) const {}
@@ -77,7 +88,7 @@ class BeastPlanner : public ompl::control::RRT {
         base::GoalSampleableRegion *goal_s = dynamic_cast<base::GoalSampleableRegion *>(goal);
 
         while(const base::State *st = pis_.nextStart()) {
-            Motion *motion = new Motion(siC_);
+            Motion *motion = motionArena.alloc();
             si_->copyState(motion->state, st);
             siC_->nullControl(motion->control);
             nn_->add(motion);
@@ -89,7 +100,7 @@ class BeastPlanner : public ompl::control::RRT {
         }
 
         if(!newsampler_) {
-            auto start = clock();
+            auto start = wallNow();
 
             if(whichSearch.compare("D*") == 0) {
                 newsampler_ = new ompl::base::BeastSampler_dstar((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(),
@@ -104,13 +115,17 @@ class BeastPlanner : public ompl::control::RRT {
 
             newsampler_->initialize();
 
-            samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+            samplerInitializationTime = secondsSince(start);
         }
         if(!controlSampler_)
             controlSampler_ = siC_->allocDirectedControlSampler();
 
         OMPL_INFORM("%s: Starting planning with %u states already in datastructure", getName().c_str(), nn_->size());
 
+        if(threads > 1) {
+            return solveInParallel(ptc, goal);
+        }
+
         Motion *solution  = NULL;
         Motion *approxsol = NULL;
         double  approxdif = std::numeric_limits<double>::infinity();
@@ -121,10 +136,20 @@ class BeastPlanner : public ompl::control::RRT {
         base::State  *xstate = si_->allocState();
 
         Motion *resusableMotion = new Motion(siC_);
+        unsigned int iterations = 0;
+
+        if(addIntermediateStates_) {
+            allocPropagationBuffer(propagationBuffer);
+        }
 
         while(ptc == false) {
             Motion *nmotion = NULL;
 
+            if(refinementInterval > 0 && ++iterations % refinementInterval == 0) {
+                PHASE_SCOPE(AbstractionUpdate);
+                newsampler_->refineAbstraction();
+            }
+
             /* sample random state (with goal biasing) */
             // if(goal_s && rng_.uniform01() < goalBias_ && goal_s->canSample()) {
             // 	goal_s->sampleGoal(rstate);
@@ -133,7 +158,10 @@ class BeastPlanner : public ompl::control::RRT {
             // 	nmotion = nn_->nearest(rmotion);
             // }
             // else {
-            newsampler_->sample(resusableMotion->state, rstate);
+            {
+                PHASE_SCOPE(Sample);
+                newsampler_->sample(resusableMotion->state, rstate);
+            }
 
             // std::cout << "from state ============ " << std::endl;
             // auto s = resusableMotion->state->as<ompl::base::CompoundStateSpace::StateType>()->as<ompl::base::SE3StateSpace::StateType>(0);
@@ -143,7 +171,10 @@ class BeastPlanner : public ompl::control::RRT {
             // std::cout << s->getX() << " " << s->getY() << std::endl;
             
             /* find closest state in the tree */
-            nmotion = nn_->nearest(rmotion);
+            {
+                PHASE_SCOPE(NearestNeighbor);
+                nmotion = nn_->nearest(rmotion);
+            }
             // std::cout << "nearest state ============ " << std::endl;
             // s = nmotion->state->as<ompl::base::CompoundStateSpace::StateType>()->as<ompl::base::SE3StateSpace::StateType>(0);
             // std::cout << s->getX() << " " << s->getY() << std::endl;
@@ -154,30 +185,35 @@ class BeastPlanner : public ompl::control::RRT {
 #endif
 
             /* sample a random control that attempts to go towards the random state, and also sample a control duration */
-            unsigned int cd = controlSampler_->sampleTo(rctrl, nmotion->control, nmotion->state, rmotion->state);
+            unsigned int cd;
+            {
+                PHASE_SCOPE(Steer);
+                cd = controlSampler_->sampleTo(rctrl, nmotion->control, nmotion->state, rmotion->state);
+            }
 
             if(addIntermediateStates_) {
                 // this code is contributed by Jennifer Barry
-                std::vector<base::State *> pstates;
-                cd = siC_->propagateWhileValid(nmotion->state, rctrl, cd, pstates, true);
+                // propagates into the reusable buffer and only the states we keep are copied into the arena
+                {
+                    PHASE_SCOPE(Propagate);
+                    cd = siC_->propagateWhileValid(nmotion->state, rctrl, cd, propagationBuffer, false);
+                }
 
                 if(cd >= siC_->getMinControlDuration()) {
                     Motion *lastmotion = nmotion;
                     bool solved = false;
-                    size_t p = 0;
-                    for(; p < pstates.size(); ++p) {
+                    for(unsigned int p = 0; p < cd; ++p) {
                         /* create a motion */
-                        Motion *motion = new Motion();
-                        motion->state = pstates[p];
+                        Motion *motion = motionArena.alloc();
+                        si_->copyState(motion->state, propagationBuffer[p]);
 
-                        newsampler_->reached(pstates[p]);
+                        newsampler_->reached(motion->state);
 
 #ifdef STREAM_GRAPHICS
-                        streamPoint(pstates[p], 1, 0, 0, 1);
+                        streamPoint(motion->state, 1, 0, 0, 1);
 #endif
 
                         //we need multiple copies of rctrl
-                        motion->control = siC_->allocControl();
                         siC_->copyControl(motion->control, rctrl);
                         motion->steps = 1;
                         motion->parent = lastmotion;
@@ -196,18 +232,13 @@ class BeastPlanner : public ompl::control::RRT {
                         }
                     }
 
-                    //free any states after we hit the goal
-                    while(++p < pstates.size())
-                        si_->freeState(pstates[p]);
                     if(solved)
                         break;
-                } else
-                    for(size_t p = 0 ; p < pstates.size(); ++p)
-                        si_->freeState(pstates[p]);
+                }
             } else {
                 if(cd >= siC_->getMinControlDuration()) {
                     /* create a motion */
-                    Motion *motion = new Motion(siC_);
+                    Motion *motion = motionArena.alloc();
 
                     si_->copyState(motion->state, rmotion->state);
                     siC_->copyControl(motion->control, rctrl);
@@ -237,6 +268,211 @@ class BeastPlanner : public ompl::control::RRT {
             }
         }
 
+        if(rmotion->state)
+            si_->freeState(rmotion->state);
+        if(rmotion->control)
+            siC_->freeControl(rmotion->control);
+        delete rmotion;
+        si_->freeState(xstate);
+
+        return reportSolution(solution, approxsol, approxdif);
+    }
+
+    virtual void setup() {
+        if(!nn_)
+            nn_.reset(allocNearestNeighbors<Motion, Motion, &Motion::state>(this));
+        RRT::setup();
+    }
+
+    virtual void clear() {
+        if(nn_)
+            nn_->clear();
+        motionArena.reset();
+        RRT::clear();
+        // delete newsampler_;
+        // newsampler_ = NULL;
+    }
+
+  protected:
+
+    /* One propagation of a parallel batch: the sampler's (from, to) pair, the tree motion nearest to to and
+       what propagating from it produced. Everything here is written by exactly one worker per batch. */
+    struct BatchItem {
+        base::State *from;
+        Motion *target;
+        Motion *nearest;
+        unsigned int steps;
+        std::vector<base::State *> pstates; //reusable propagation buffer, steps of it are valid
+    };
+
+    /* Everything a worker needs to propagate without touching the planner's space information: its own
+       space information sharing the state and control spaces and the propagator, with its own validity
+       checker (checkers are not thread safe) and directed control sampler (with its own RNG). */
+    struct PropagationSlot {
+        SpaceInformationPtr si;
+        DirectedControlSamplerPtr controlSampler;
+    };
+
+    void allocPropagationSlots(unsigned int count) {
+        auto app = globalParameters.globalAppBaseControl;
+        while(slots.size() < count) {
+            PropagationSlot slot;
+            slot.si = std::make_shared<SpaceInformation>(siC_->getStateSpace(), siC_->getControlSpace());
+            slot.si->setStatePropagator(siC_->getStatePropagator());
+            slot.si->setPropagationStepSize(siC_->getPropagationStepSize());
+            slot.si->setMinMaxControlDuration(siC_->getMinControlDuration(), siC_->getMaxControlDuration());
+            slot.si->setStateValidityCheckingResolution(siC_->getStateValidityCheckingResolution());
+            slot.si->setStateValidityChecker(app->allocThreadLocalStateValidityChecker(slot.si, app->getGeometricStateExtractor(),
+                                                                                        app->isSelfCollisionEnabled()));
+            if(!siC_->getStatePropagator()->canSteer()) {
+                slot.si->setDirectedControlSamplerAllocator(directedControlSamplerAllocator);
+            }
+            slot.si->setup();
+
+            //slots are built here on the planning thread in order, so their samplers are seeded the same way every run
+            slot.controlSampler = slot.si->allocDirectedControlSampler();
+            slots.push_back(slot);
+        }
+    }
+
+    /* The sampler stays on this thread: it picks a batch of (from, to) pairs off the current best edges, the
+       workers propagate them and the results go back through reachedBatch and finishBatch in item order.
+       In deterministic mode item i is always propagated with slot i, so a run only depends on Seed. Otherwise
+       items go to the slot of whichever thread picks them up and batches are larger to keep the threads busy. */
+    base::PlannerStatus solveInParallel(const base::PlannerTerminationCondition &ptc, base::Goal *goal) {
+        if(!pool) {
+            pool.reset(new ThreadPool(threads));
+            allocPropagationSlots(threads);
+        }
+
+        unsigned int batchSize = deterministicThreads ? threads : threads * 4;
+        std::vector<BatchItem> items(batchSize);
+        std::vector<base::State *> from(batchSize), to(batchSize);
+        for(unsigned int i = 0; i < batchSize; ++i) {
+            items[i].from = from[i] = si_->allocState();
+            items[i].target = new Motion(siC_);
+            to[i] = items[i].target->state;
+            if(addIntermediateStates_) {
+                allocPropagationBuffer(items[i].pstates);
+            }
+        }
+
+        Motion *solution  = NULL;
+        Motion *approxsol = NULL;
+        double  approxdif = std::numeric_limits<double>::infinity();
+        unsigned int iterations = 0;
+
+        OMPL_INFORM("%s: Propagating batches of %u on %u threads%s", getName().c_str(), batchSize, threads,
+                    deterministicThreads ? " (deterministic)" : "");
+
+        while(ptc == false && solution == NULL) {
+            if(refinementInterval > 0 && iterations / refinementInterval != (iterations + batchSize) / refinementInterval) {
+                PHASE_SCOPE(AbstractionUpdate);
+                newsampler_->refineAbstraction();
+            }
+            iterations += batchSize;
+
+            {
+                PHASE_SCOPE(Sample);
+                newsampler_->sampleBatch(from, to);
+            }
+            {
+                PHASE_SCOPE(NearestNeighbor);
+                for(auto &item : items) {
+                    item.nearest = nn_->nearest(item.target);
+                }
+            }
+
+            pool->parallelFor(batchSize, [&](unsigned int i, unsigned int thread) {
+                BatchItem &item = items[i];
+                PropagationSlot &slot = slots[deterministicThreads ? i : thread];
+
+                {
+                    PHASE_SCOPE(Steer);
+                    item.steps = slot.controlSampler->sampleTo(item.target->control, item.nearest->control, item.nearest->state, item.target->state);
+                }
+                if(addIntermediateStates_) {
+                    PHASE_SCOPE(Propagate);
+                    item.steps = slot.si->propagateWhileValid(item.nearest->state, item.target->control, item.steps, item.pstates, false);
+                }
+            });
+
+            for(unsigned int i = 0; i < batchSize; ++i) {
+                BatchItem &item = items[i];
+
+                if(solution != NULL || item.steps < siC_->getMinControlDuration()) {
+                    continue;
+                }
+
+                if(addIntermediateStates_) {
+                    Motion *lastmotion = item.nearest;
+                    for(unsigned int p = 0; p < item.steps; ++p) {
+                        Motion *motion = motionArena.alloc();
+                        si_->copyState(motion->state, item.pstates[p]);
+
+                        newsampler_->reachedBatch(i, motion->state);
+
+                        siC_->copyControl(motion->control, item.target->control);
+                        motion->steps = 1;
+                        motion->parent = lastmotion;
+                        lastmotion = motion;
+                        nn_->add(motion);
+                        double dist = 0.0;
+                        if(goal->isSatisfied(motion->state, &dist)) {
+                            approxdif = dist;
+                            solution = motion;
+                            break;
+                        }
+                        if(dist < approxdif) {
+                            approxdif = dist;
+                            approxsol = motion;
+                        }
+                    }
+                } else {
+                    Motion *motion = motionArena.alloc();
+                    si_->copyState(motion->state, item.target->state);
+                    siC_->copyControl(motion->control, item.target->control);
+                    motion->steps = item.steps;
+                    motion->parent = item.nearest;
+
+                    newsampler_->reachedBatch(i, motion->state);
+
+                    nn_->add(motion);
+                    double dist = 0.0;
+                    if(goal->isSatisfied(motion->state, &dist)) {
+                        approxdif = dist;
+                        solution = motion;
+                    } else if(dist < approxdif) {
+                        approxdif = dist;
+                        approxsol = motion;
+                    }
+                }
+            }
+
+            {
+                PHASE_SCOPE(Sample);
+                newsampler_->finishBatch();
+            }
+        }
+
+        for(auto &item : items) {
+            si_->freeState(item.from);
+            si_->freeState(item.target->state);
+            siC_->freeControl(item.target->control);
+            delete item.target;
+            for(auto state : item.pstates)
+                si_->freeState(state);
+        }
+
+        return reportSolution(solution, approxsol, approxdif);
+    }
+
+    void allocPropagationBuffer(std::vector<base::State *> &buffer) {
+        while(buffer.size() < siC_->getMaxControlDuration())
+            buffer.push_back(si_->allocState());
+    }
+
+    base::PlannerStatus reportSolution(Motion *solution, Motion *approxsol, double approxdif) {
         bool solved = false;
         bool approximate = false;
         if(solution == NULL) {
@@ -265,29 +501,24 @@ class BeastPlanner : public ompl::control::RRT {
             pdef_->addSolutionPath(base::PathPtr(path), approximate, approxdif, getName());
         }
 
-        if(rmotion->state)
-            si_->freeState(rmotion->state);
-        if(rmotion->control)
-            siC_->freeControl(rmotion->control);
-        delete rmotion;
-        si_->freeState(xstate);
-
         OMPL_INFORM("%s: Created %u states", getName().c_str(), nn_->size());
 
         return base::PlannerStatus(solved, approximate);
     }
 
-    virtual void clear() {
-        RRT::clear();
-        // delete newsampler_;
-        // newsampler_ = NULL;
-    }
-
-  protected:
-
     ompl::base::BeastSamplerBase *newsampler_;
     const FileMap &params;
     std::string whichSearch;
+    unsigned int refinementInterval;
+    unsigned int threads;
+    bool deterministicThreads;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<PropagationSlot> slots;
+
+    /* tree nodes come out of motionArena; propagationBuffer is where the serial loop propagates before
+       copying the states it keeps into them */
+    MotionArena<Motion, Motion, &Motion::state, &Motion::control> motionArena;
+    std::vector<base::State *> propagationBuffer;
     double samplerInitializationTime = 0;
 };
 
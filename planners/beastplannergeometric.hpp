@@ -89,7 +89,7 @@ class BeastPlanner : public ompl::geometric::RRT {
     }
 
     if(!newsampler_) {
-      auto start = clock();
+      auto start = wallNow();
 
       if(whichSearch.compare("D*") == 0) {
         newsampler_ = new ompl::base::BeastSampler_dstar( &(*si_), pdef_->getStartState(0), pdef_->getGoal(),
@@ -104,7 +104,7 @@ class BeastPlanner : public ompl::geometric::RRT {
 
       newsampler_->initialize();
 
-      samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+      samplerInitializationTime = secondsSince(start);
     }
     // if(!controlSampler_)
     //   controlSampler_ = siC_->allocDirectedControlSampler();
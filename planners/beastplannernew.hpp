@@ -90,7 +90,7 @@ class BeastPlannernew : public ompl::control::RRT {
         }
 
         if(!newsampler_) {
-            auto start = clock();
+            auto start = wallNow();
 
             if(whichSearch.compare("D*") == 0) {
                 newsampler_ = new ompl::base::BeastSampler_dstar((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(),
@@ -110,7 +110,7 @@ class BeastPlannernew : public ompl::control::RRT {
 
             newsampler_->initialize();
 
-            samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+            samplerInitializationTime = secondsSince(start);
         }
         if(!controlSampler_)
             controlSampler_ = siC_->allocDirectedControlSampler();
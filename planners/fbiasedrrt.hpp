@@ -72,12 +72,12 @@ public:
 		}
 
 		if(!fbiasedSampler_) {
-			auto start = clock();
+			auto start = wallNow();
 
 			fbiasedSampler_ = new ompl::base::FBiasedStateSampler((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(), params);
 			fbiasedSampler_->initialize();
 
-			samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			samplerInitializationTime = secondsSince(start);
 		}
 		if(!controlSampler_)
 			controlSampler_ = siC_->allocDirectedControlSampler();
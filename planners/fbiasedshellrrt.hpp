@@ -80,13 +80,13 @@ public:
 		}
 
 		if(!shellsampler_) {
-			auto start = clock();
+			auto start = wallNow();
 
 			shellsampler_ = new ompl::base::FBiasedShellStateSampler((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(),
 			        params);
 			shellsampler_->initialize();
 
-			samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			samplerInitializationTime = secondsSince(start);
 		}
 		if(!controlSampler_)
 			controlSampler_ = siC_->allocDirectedControlSampler();
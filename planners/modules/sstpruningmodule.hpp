@@ -54,7 +54,7 @@ public:
 		const ompl::base::OptimizationObjectivePtr& optimizationObjective, double selectionRadius,
 		double pruningRadius) : SSTPruningModuleBase<MotionWithCost, Motion>(),
 		si(si), optimizationObjective(optimizationObjective), selectionRadius(selectionRadius), pruningRadius(pruningRadius) {
-		witnesses.reset(ompl::tools::SelfConfig::getDefaultNearestNeighbors<MotionWithCost *>(planner));
+		witnesses.reset(allocNearestNeighbors<MotionWithCost, Motion, &Motion::state>(planner));
 		witnesses->setDistanceFunction(boost::bind(&SSTPruningModule::distanceFunction, this, _1, _2));
 	}
 
@@ -96,27 +96,13 @@ public:
 	}
 
 	MotionWithCost* selectNode(MotionWithCost *sample, std::shared_ptr<ompl::NearestNeighbors<Motion*>> &nn) const override {
-		std::vector<Motion*> ret;
-		MotionWithCost *selected = nullptr;
-		ompl::base::Cost bestCost = optimizationObjective->infiniteCost();
-		nn->nearestR(sample, selectionRadius, ret);
-		for(unsigned int i = 0; i < ret.size(); i++) {
-			if(!((MotionWithCost*)ret[i])->inactive && optimizationObjective->isCostBetterThan(((MotionWithCost*)ret[i])->g, bestCost)) {
-				bestCost = ((MotionWithCost*)ret[i])->g;
-				selected = (MotionWithCost*)ret[i];
-			}
-		}
-		if(selected == nullptr) {
-			int k = 1;
-			while(selected == nullptr) {
-				nn->nearestK(sample, k, ret);
-				for(unsigned int i=0; i < ret.size() && selected == nullptr; i++)
-					if(!((MotionWithCost*)ret[i])->inactive)
-						selected = (MotionWithCost*)ret[i];
-				k += 5;
-			}
-		}
-		return selected;
+		return (MotionWithCost*)selectWithin<Motion>(*nn, sample, selectionRadius,
+		[](Motion *m) {
+			return !((MotionWithCost*)m)->inactive;
+		},
+		[this](Motion *a, Motion *b) {
+			return optimizationObjective->isCostBetterThan(((MotionWithCost*)a)->g, ((MotionWithCost*)b)->g);
+		});
 	}
 
 	void cleanupTree(MotionWithCost *oldRep) override {
@@ -178,8 +164,9 @@ protected:
 
 	Witness* findClosestWitness(MotionWithCost *node) {
 		if(witnesses->size() > 0) {
-			Witness *closest = (Witness*)witnesses->nearest(node);
-			if(distanceFunction(closest, node) > pruningRadius) {
+			double distance;
+			Witness *closest = (Witness*)nearestWithDistance(*witnesses, node, distance);
+			if(distance > pruningRadius) {
 				closest = new Witness(si);
 				closest->linkRep(node);
 				si->copyState(closest->state, node->state);
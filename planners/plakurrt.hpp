@@ -73,13 +73,13 @@ public:
 		}
 
 		if(!plakusampler_) {
-			auto start = clock();
+			auto start = wallNow();
 
 			plakusampler_ = new ompl::base::PlakuStateSampler((ompl::base::SpaceInformation *)siC_, pdef_->getStartState(0), pdef_->getGoal(),
 			        params);
 			plakusampler_->initialize();
 
-			samplerInitializationTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			samplerInitializationTime = secondsSince(start);
 		}
 		if(!controlSampler_)
 			controlSampler_ = siC_->allocDirectedControlSampler();
@@ -26,7 +26,7 @@ public:
 
 	/** \brief Continue solving for some amount of time. Return true if solution was found. */
 	virtual base::PlannerStatus solve(const base::PlannerTerminationCondition &ptc) {
-		start = clock();
+		start = wallNow();
 
 		ompl::base::PlannerStatus status(false, true);
 
@@ -259,7 +259,7 @@ protected:
 	double propagationStepSize;
 	ompl::base::State *goalState;
 	ompl::base::OptimizationObjectivePtr optimizationObjective;
-	clock_t start;
+	WallTime start;
 };
 
 }
@@ -3,6 +3,8 @@
 #include "ompl/control/planners/PlannerIncludes.h"
 #include "ompl/datastructures/NearestNeighbors.h"
 
+#include "../structs/motionarena.hpp"
+
 namespace ompl {
 namespace control {
 
@@ -12,6 +14,8 @@ public:
 	/** \brief Constructor */
 	SSTStar(const SpaceInformationPtr &si, const FileMap &params) : base::Planner(si, "SSTStar") {
 		siC_ = si.get();
+		motionArena_.reset(new MotionArena<Motion, Motion, &Motion::state_, &Motion::control_>(siC_));
+		witnessArena_.reset(new MotionArena<Witness, Motion, &Motion::state_, &Motion::control_>(siC_));
 
 		goalBias_ = 0.05; //params.doubleVal("GoalBias");
 		selectionRadius_ = params.doubleVal("SelectionRadius");
@@ -27,11 +31,11 @@ public:
 	virtual void setup() {
 		base::Planner::setup();
 		if(!nn_)
-			nn_.reset(tools::SelfConfig::getDefaultNearestNeighbors<Motion *>(this));
+			nn_.reset(allocNearestNeighbors<Motion, Motion, &Motion::state_>(this));
 		nn_->setDistanceFunction(std::bind(&SSTStar::distanceFunction, this,
 		                                   std::placeholders::_1, std::placeholders::_2));
 		if(!witnesses_)
-			witnesses_.reset(tools::SelfConfig::getDefaultNearestNeighbors<Motion *>(this));
+			witnesses_.reset(allocNearestNeighbors<Motion, Motion, &Motion::state_>(this));
 		witnesses_->setDistanceFunction(std::bind(&SSTStar::distanceFunction, this,
 		                                std::placeholders::_1, std::placeholders::_2));
 
@@ -41,14 +45,14 @@ public:
 
 	/** \brief Continue solving for some amount of time. Return true if solution was found. */
 	virtual base::PlannerStatus solve(const base::PlannerTerminationCondition &ptc) {
-		start = clock();
+		start = wallNow();
 
 		checkValidity();
 		base::Goal *goal = pdef_->getGoal().get();
 		base::GoalSampleableRegion *goal_s = dynamic_cast<base::GoalSampleableRegion *>(goal);
 
 		while(const base::State *st = pis_.nextStart()) {
-			Motion *motion = new Motion(siC_);
+			Motion *motion = motionArena_->alloc();
 			si_->copyState(motion->state_, st);
 			siC_->nullControl(motion->control_);
 			nn_->add(motion);
@@ -104,19 +108,30 @@ public:
 			}
 
 			/* sample random state (with goal biasing) */
-			if(goal_s && rng_.uniform01() < goalBias_ && goal_s->canSample())
-				goal_s->sampleGoal(rstate);
-			else
-				sampler_->sampleUniform(rstate);
+			{
+				PHASE_SCOPE(Sample);
+				if(goal_s && rng_.uniform01() < goalBias_ && goal_s->canSample())
+					goal_s->sampleGoal(rstate);
+				else
+					sampler_->sampleUniform(rstate);
+			}
 
 #ifdef STREAM_GRAPHICS
 			// streamPoint(rstate, 0, 1, 0, 1);
 #endif
 
 			/* find closest state in the tree */
-			Motion *nmotion = selectNode(rmotion);
+			Motion *nmotion;
+			{
+				PHASE_SCOPE(NearestNeighbor);
+				nmotion = selectNode(rmotion);
+			}
 
-			unsigned int cd = controlSampler_->sampleTo(rctrl, nmotion->control_, nmotion->state_, rmotion->state_);
+			unsigned int cd;
+			{
+				PHASE_SCOPE(Steer);
+				cd = controlSampler_->sampleTo(rctrl, nmotion->control_, nmotion->state_, rmotion->state_);
+			}
 
 			if(cd >= siC_->getMinControlDuration()) {
 				base::Cost incCost(cd * siC_->getPropagationStepSize());
@@ -139,7 +154,7 @@ public:
 				if(closestWitness->rep_ == rmotion || opt_->isCostBetterThan(cost,closestWitness->rep_->accCost_)) {
 					Motion *oldRep = closestWitness->rep_;
 					/* create a motion */
-					Motion *motion = new Motion(siC_);
+					Motion *motion = motionArena_->alloc();
 					motion->accCost_ = cost;
 					si_->copyState(motion->state_, rmotion->state_);
 					siC_->copyControl(motion->control_, rctrl);
@@ -158,16 +173,9 @@ public:
 						oldRep->inactive_ = true;
 						nn_->remove(oldRep);
 						while(oldRep->inactive_ && oldRep->numChildren_==0) {
-							if(oldRep->state_)
-								si_->freeState(oldRep->state_);
-							if(oldRep->control_)
-								siC_->freeControl(oldRep->control_);
-
-							oldRep->state_=nullptr;
-							oldRep->control_=nullptr;
 							oldRep->parent_->numChildren_--;
 							Motion *oldRepParent = oldRep->parent_;
-							delete oldRep;
+							motionArena_->free(oldRep);
 							oldRep = oldRepParent;
 						}
 					}
@@ -288,42 +296,31 @@ protected:
 
 	/** \brief Finds the best node in the tree withing the selection radius around a random sample.*/
 	Motion *selectNode(Motion *sample) {
-		std::vector<Motion *> ret;
-		Motion *selected = nullptr;
-		base::Cost bestCost = opt_->infiniteCost();
-		nn_->nearestR(sample, selectionRadius_, ret);
-		for(unsigned int i = 0; i < ret.size(); i++) {
-			if(!ret[i]->inactive_ && opt_->isCostBetterThan(ret[i]->accCost_, bestCost)) {
-				bestCost = ret[i]->accCost_;
-				selected = ret[i];
-			}
-		}
-		if(selected == nullptr) {
-			int k = 1;
-			while(selected == nullptr) {
-				nn_->nearestK(sample, k, ret);
-				for(unsigned int i=0; i < ret.size() && selected == nullptr; i++)
-					if(!ret[i]->inactive_)
-						selected = ret[i];
-				k += 5;
-			}
-		}
-		return selected;
+		//active nodes are filtered inside the index, and the nearest active fallback comes from the same traversal
+		return selectWithin<Motion>(*nn_, sample, selectionRadius_,
+		[](Motion *motion) {
+			return !motion->inactive_;
+		},
+		[this](Motion *a, Motion *b) {
+			return opt_->isCostBetterThan(a->accCost_, b->accCost_);
+		});
 	}
 
 	/** \brief Find the closest witness node to a newly generated potential node.*/
 	Witness *findClosestWitness(Motion *node) {
+		PHASE_SCOPE(NearestNeighbor);
 		if(witnesses_->size() > 0) {
-			Witness *closest = static_cast<Witness *>(witnesses_->nearest(node));
-			if(distanceFunction(closest,node) > pruningRadius_) {
-				closest = new Witness(siC_);
+			double distance;
+			Witness *closest = static_cast<Witness *>(nearestWithDistance(*witnesses_, node, distance));
+			if(distance > pruningRadius_) {
+				closest = witnessArena_->alloc();
 				closest->linkRep(node);
 				si_->copyState(closest->state_, node->state_);
 				witnesses_->add(closest);
 			}
 			return closest;
 		} else {
-			Witness *closest = new Witness(siC_);
+			Witness *closest = witnessArena_->alloc();
 			closest->linkRep(node);
 			si_->copyState(closest->state_, node->state_);
 			witnesses_->add(closest);
@@ -332,26 +329,10 @@ protected:
 	}
 
 
-	/** \brief Free the memory allocated by this planner */
+	/** \brief Free the memory allocated by this planner, every tree node and witness goes back to its arena */
 	void freeMemory() {
-		if(nn_) {
-			std::vector<Motion *> motions;
-			nn_->list(motions);
-			for(unsigned int i = 0 ; i < motions.size() ; ++i) {
-				if(motions[i]->state_)
-					si_->freeState(motions[i]->state_);
-				if(motions[i]->control_)
-					siC_->freeControl(motions[i]->control_);
-				delete motions[i];
-			}
-		}
-		if(witnesses_) {
-			std::vector<Motion *> witnesses;
-			witnesses_->list(witnesses);
-			for(unsigned int i = 0 ; i < witnesses.size() ; ++i) {
-				delete witnesses[i];
-			}
-		}
+		motionArena_->reset();
+		witnessArena_->reset();
 	}
 
 	/** \brief Compute distance between motions (actually distance between contained states) */
@@ -388,6 +369,10 @@ protected:
 	/** \brief A nearest-neighbors datastructure containing the tree of witness motions */
 	std::shared_ptr< NearestNeighbors<Motion *> > witnesses_;
 
+	/** \brief Slab storage for the tree nodes and witnesses, pruned nodes are recycled through it */
+	std::unique_ptr< MotionArena<Motion, Motion, &Motion::state_, &Motion::control_> > motionArena_;
+	std::unique_ptr< MotionArena<Witness, Motion, &Motion::state_, &Motion::control_> > witnessArena_;
+
 	/** \brief The fraction of time the goal is picked as the state to expand towards (if such a state is available) */
 	double                                         goalBias_;
 
@@ -407,7 +392,7 @@ protected:
 
 	double                                         n0_;
 
-	clock_t                                        start;
+	WallTime                                       start;
 
 	unsigned int                                   globalIterations = 0;
 };
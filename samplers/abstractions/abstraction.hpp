@@ -2,17 +2,18 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <algorithm>
 
 #include "../../domains/geometry/detail/FCLContinuousMotionValidator.hpp"
+#include "../../domains/geometry/detail/FCLDistanceFieldCache.hpp"
+#include "edgevalidator.hpp"
 
 class Abstraction {
 public:
 	struct Vertex {
-		Vertex(unsigned int id) : id(id), state(NULL), populatedNeighors(false) {}
+		Vertex(unsigned int id) : id(id), state(NULL) {}
 		unsigned int id;
 		ompl::base::State *state;
-		std::vector<unsigned int> neighbors;
-		bool populatedNeighors;
 	};
 
 	struct Edge {
@@ -21,28 +22,123 @@ public:
 			INVALID = 1,
 			VALID = 2,
 		};
+	};
+
+	/* Walks the edge slots of one vertex. With CSR storage that is a contiguous run of neighborIds, in the
+	   implicit grid mode it is the vertex's block of offset slots, skipping the ones that would leave the grid */
+	class NeighborIterator {
+	public:
+		NeighborIterator(const Abstraction *abstraction, unsigned int vertex, unsigned int slot, unsigned int boundary) :
+			abstraction(abstraction), vertex(vertex), slot(slot), boundary(boundary) {
+			skipBlocked();
+		}
+
+		unsigned int operator*() const {
+			return abstraction->getSlotTarget(vertex, slot);
+		}
+
+		NeighborIterator &operator++() {
+			++slot;
+			skipBlocked();
+			return *this;
+		}
+
+		bool operator==(const NeighborIterator &it) const { return slot == it.slot; }
+		bool operator!=(const NeighborIterator &it) const { return slot != it.slot; }
+
+		unsigned int getSlot() const {
+			return slot;
+		}
+
+	private:
+		void skipBlocked() {
+			unsigned int slotsPerCell = abstraction->implicitSlotsPerCell;
+			if(slotsPerCell == 0) return;
 
-		Edge() : endpoint(std::numeric_limits<unsigned int>::max()), edgeStatus(INVALID) {}
+			unsigned int first = vertex * slotsPerCell;
+			unsigned int last = first + slotsPerCell;
+			while(slot < last && (abstraction->implicitBlockedBy[slot - first] & boundary) != 0) {
+				++slot;
+			}
+		}
+
+		const Abstraction *abstraction;
+		unsigned int vertex, slot, boundary;
+	};
 
-		Edge(unsigned int endpoint) : endpoint(endpoint), edgeStatus(UNKNOWN) {}
+	/* The neighbors of one vertex, it iterates like the old per vertex neighbor vector and converts
+	   into one for the callers that still want their own copy */
+	struct NeighborRange {
+		NeighborRange(const Abstraction *abstraction, unsigned int vertex, unsigned int firstSlot, unsigned int lastSlot, unsigned int boundary) :
+			abstraction(abstraction), vertex(vertex), firstSlot(firstSlot), lastSlot(lastSlot), boundary(boundary) {}
 
-		std::size_t operator()(const Edge &e) const { return e.endpoint; }
+		NeighborIterator begin() const { return NeighborIterator(abstraction, vertex, firstSlot, boundary); }
+		NeighborIterator end() const { return NeighborIterator(abstraction, vertex, lastSlot, boundary); }
+		bool empty() const { return begin() == end(); }
 
-		bool operator==(const Edge &e) const { return e.endpoint == endpoint; }
+		unsigned int size() const {
+			unsigned int count = 0;
+			for(auto it = begin(); it != end(); ++it) {
+				count++;
+			}
+			return count;
+		}
 
-		unsigned int endpoint;
-		CollisionCheckingStatus edgeStatus;
+		operator std::vector<unsigned int>() const {
+			std::vector<unsigned int> neighbors;
+			for(auto n : *this) {
+				neighbors.push_back(n);
+			}
+			return neighbors;
+		}
+
+		const Abstraction *abstraction;
+		unsigned int vertex, firstSlot, lastSlot, boundary;
 	};
 
-	Abstraction(const ompl::base::State *start, const ompl::base::State *goal) :
+	static const unsigned int NoEdge = std::numeric_limits<unsigned int>::max();
+
+	/* What the last grow() did to the graph, so the searches built on top of it can be repaired instead of
+	   started over. Vertex ids below previousSize keep their meaning unless remapped is set, then the whole
+	   graph was rebuilt and parents[i] is the old vertex whose region holds new vertex i. The edge lists are
+	   directed (both directions are listed) and only filled in when the ids were kept. */
+	struct ChangeSet {
+		void reset(unsigned int size, bool remap) {
+			revision++;
+			previousSize = size;
+			remapped = remap;
+			parents.clear();
+			addedEdges.clear();
+			removedEdges.clear();
+			resetEdges.clear();
+		}
+
+		unsigned int revision = 0;
+		unsigned int previousSize = 0;
+		bool remapped = false;
+		std::vector<unsigned int> parents;
+		std::vector<std::pair<unsigned int, unsigned int>> addedEdges, removedEdges, resetEdges;
+	};
+
+	Abstraction(const ompl::base::State *start, const ompl::base::State *goal, const FileMap &params) :
 		motionValidator(globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->getMotionValidator()),
 		start(start), goal(goal) {
+
+		if(params.exists("AbstractionThreads")) {
+			setThreadCount(params.integerVal("AbstractionThreads"));
+		}
+
+		if(params.exists("DistanceFieldVoxelSize")) {
+			setupDistanceField(params.doubleVal("DistanceFieldVoxelSize"),
+			                   params.exists("DistanceFieldCoreRadius") ? params.doubleVal("DistanceFieldCoreRadius") : 0);
+		}
 	}
 
 	virtual ~Abstraction() {
 		for(auto vertex : vertices) {
 			delete vertex;
 		}
+		delete edgeValidator;
 	}
 
 	virtual void initialize(bool forceConnectedness = true) = 0;
@@ -61,86 +157,103 @@ public:
 		return vertices[index]->state;
 	}
 
-	bool edgeExists(unsigned int a, unsigned int b) {
-		auto vertexAndEdges = edges.find(a);
-		if(vertexAndEdges == edges.end()) {
-			return false;
-		}
+	// bumped by every grow(), a consumer that is more than one revision behind has to start over
+	unsigned int getRevision() const {
+		return changes.revision;
+	}
 
-		auto &edges = vertexAndEdges->second;
+	const ChangeSet &getChangeSet() const {
+		return changes;
+	}
 
-		auto edge = edges.find(b);
-		if(edge == edges.end()) {
-			return false;
+	/* edge slots are in [0, getEdgeSlotCount()), with CSR storage that is the number of directed edges and in
+	   the implicit grid mode it is cells * offsets, where slots leading off the grid are simply never used */
+	unsigned int getEdgeSlotCount() const {
+		if(implicitSlotsPerCell > 0) {
+			return vertices.size() * implicitSlotsPerCell;
 		}
-		return true;
+		return neighborIds.size();
 	}
 
-	bool isValidEdge(unsigned int a, unsigned int b) {
-		auto vertexAndEdges = edges.find(a);
-		if(vertexAndEdges == edges.end()) {
-			return false;
+	/* the first edge slot of a vertex, the slots of its neighbors are contiguous */
+	unsigned int getFirstEdgeSlot(unsigned int index) const {
+		if(implicitSlotsPerCell > 0) {
+			return index * implicitSlotsPerCell;
 		}
+		return neighborOffsets[index];
+	}
 
-		auto &edges = vertexAndEdges->second;
-
-		auto edge = edges.find(b);
-		if(edge == edges.end()) {
-			return false;
+	unsigned int getEdgeSlot(unsigned int a, unsigned int b) const {
+		if(implicitSlotsPerCell > 0) {
+			if(a >= vertices.size() || b >= vertices.size()) {
+				return NoEdge;
+			}
+			unsigned int boundary = getImplicitBoundary(a);
+			for(unsigned int k = 0; k < implicitSlotsPerCell; ++k) {
+				if((implicitBlockedBy[k] & boundary) == 0 && a + implicitDeltas[k] == b) {
+					return a * implicitSlotsPerCell + k;
+				}
+			}
+			return NoEdge;
 		}
 
-		if(edge->second.edgeStatus == Edge::UNKNOWN) {
-			// if(motionValidator->checkMotion(vertices[a]->state, vertices[b]->state)) {
-			if(globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->checkMotion(vertices[a]->state, vertices[b]->state)) {
-				edge->second.edgeStatus = Edge::VALID;
-				setEdgeStatusUnchecked(b, a, Edge::VALID);
-			} else {
-				edge->second.edgeStatus = Edge::INVALID;
-				setEdgeStatusUnchecked(b, a, Edge::INVALID);
-			}
+		if(a + 1 >= neighborOffsets.size()) {
+			return NoEdge;
 		}
 
-		return edge->second.edgeStatus == Edge::VALID;
+		auto first = neighborIds.begin() + neighborOffsets[a];
+		auto last = neighborIds.begin() + neighborOffsets[a+1];
+		auto found = std::lower_bound(first, last, b);
+		if(found == last || *found != b) {
+			return NoEdge;
+		}
+		return found - neighborIds.begin();
 	}
 
-	bool isValidEdgeUnchecked(unsigned int a, unsigned int b) {
-		auto &edge = edges[a][b];
+	bool edgeExists(unsigned int a, unsigned int b) const {
+		return getEdgeSlot(a, b) != NoEdge;
+	}
 
-		if(edge.edgeStatus == Edge::UNKNOWN) {
-			// if(motionValidator->checkMotion(vertices[a]->state, vertices[b]->state)) {
-			if(globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->checkMotion(vertices[a]->state, vertices[b]->state)) {
-				edge.edgeStatus = Edge::VALID;
-				setEdgeStatusUnchecked(b, a, Edge::VALID);
-			} else {
-				edge.edgeStatus = Edge::INVALID;
-				setEdgeStatusUnchecked(b, a, Edge::INVALID);
-			}
+	bool isValidEdge(unsigned int a, unsigned int b) {
+		unsigned int slot = getEdgeSlot(a, b);
+		if(slot == NoEdge) {
+			return false;
 		}
+		return isValidEdgeSlot(a, b, slot);
+	}
 
-		return edge.edgeStatus == Edge::VALID;
+	bool isValidEdgeUnchecked(unsigned int a, unsigned int b) {
+		unsigned int slot = getEdgeSlot(a, b);
+		assert(slot != NoEdge);
+		return isValidEdgeSlot(a, b, slot);
 	}
 
-	Edge::CollisionCheckingStatus getCollisionCheckStatusUnchecked(unsigned int a, unsigned int b) {
-		return edges[a][b].edgeStatus;
+	Edge::CollisionCheckingStatus getCollisionCheckStatusUnchecked(unsigned int a, unsigned int b) const {
+		unsigned int slot = getEdgeSlot(a, b);
+		//the old map based storage handed back a default (INVALID) edge for missing pairs
+		return slot == NoEdge ? Edge::INVALID : getSlotStatus(slot);
 	}
 
-	const std::vector<unsigned int>& getNeighboringCells(unsigned int index) {
-		if(vertices[index]->populatedNeighors) {
-			return vertices[index]->neighbors;
-		}
-		vertices[index]->populatedNeighors = true;
+	Edge::CollisionCheckingStatus getCollisionCheckStatusBySlot(unsigned int slot) const {
+		return getSlotStatus(slot);
+	}
 
-		auto vertexAndEdges = edges.find(index);
-		assert(vertexAndEdges != edges.end());
+	NeighborRange getNeighboringCells(unsigned int index) const {
+		if(implicitSlotsPerCell > 0) {
+			assert(index < vertices.size());
+			unsigned int first = index * implicitSlotsPerCell;
+			return NeighborRange(this, index, first, first + implicitSlotsPerCell, getImplicitBoundary(index));
+		}
 
-		const auto &edges = vertexAndEdges->second;
+		assert(index + 1 < neighborOffsets.size());
+		return NeighborRange(this, index, neighborOffsets[index], neighborOffsets[index+1], 0);
+	}
 
-		vertices[index]->neighbors.reserve(edges.size());
-		for(const auto &edge : edges) {
-			vertices[index]->neighbors.emplace_back(edge.second.endpoint);
+	unsigned int getSlotTarget(unsigned int vertex, unsigned int slot) const {
+		if(implicitSlotsPerCell > 0) {
+			return vertex + implicitDeltas[slot - vertex * implicitSlotsPerCell];
 		}
-
-		return vertices[index]->neighbors;
+		return neighborIds[slot];
 	}
 
 	virtual double abstractDistanceFunction(const Vertex *a, const Vertex *b) const {
@@ -151,56 +264,448 @@ public:
 		return globalParameters.globalAbstractAppBaseGeometric->getStateSpace()->distance(vertices[a]->state, vertices[b]->state);
 	}
 
+	/* with more than one thread the abstraction is built in parallel and unknown edges are collision checked
+	   in batches: the connectivity check validates a whole BFS layer at once and isValidEdge drains the
+	   prefetch queue along with the edge asked for */
+	void setThreadCount(unsigned int threads) {
+		delete edgeValidator;
+		edgeValidator = threads > 1 ? new AbstractEdgeValidator(threads) : NULL;
+	}
+
+	void prefetchOutgoingEdges(unsigned int index) {
+		if(edgeValidator == NULL) return;
+
+		auto neighbors = getNeighboringCells(index);
+		for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+			if(getSlotStatus(it.getSlot()) == Edge::UNKNOWN) {
+				prefetchQueue.emplace_back(index, it.getSlot());
+			}
+		}
+	}
+
+	void drainPrefetchQueue() {
+		validateEdgeSlots(prefetchQueue);
+		prefetchQueue.clear();
+	}
+
 	bool checkConnectivity() {
 		Timer("connectivity check");
 		unsigned int startIndex = getStartIndex();
 		unsigned int goalIndex = getGoalIndex();
 
-		unsigned int index = 0;
-		std::vector<unsigned int> open;
-		std::unordered_set<unsigned int> closed;
-
-		open.emplace_back(startIndex);
-		while(index < open.size()) {
-			unsigned int current = open[index];
-			if(current == goalIndex) {
-				return true;
+		std::vector<unsigned int> layer, nextLayer;
+		std::vector<bool> closed(vertices.size(), false);
+		std::vector<std::pair<unsigned int, unsigned int>> batch;
+
+		layer.emplace_back(startIndex);
+		closed[startIndex] = true;
+		while(!layer.empty()) {
+			if(edgeValidator != NULL) {
+				batch.clear();
+				for(auto current : layer) {
+					auto neighbors = getNeighboringCells(current);
+					for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+						if(!closed[*it] && getSlotStatus(it.getSlot()) == Edge::UNKNOWN) {
+							batch.emplace_back(current, it.getSlot());
+						}
+					}
+				}
+				validateEdgeSlots(batch);
 			}
-			auto neighbors = getNeighboringCells(current);
-			for(auto n : neighbors) {
-				if(closed.find(n) != closed.end()) continue;
-				if(!isValidEdgeUnchecked(current, n)) continue;
-				closed.insert(n);
-				open.emplace_back(n);
+
+			nextLayer.clear();
+			for(auto current : layer) {
+				if(current == goalIndex) {
+					return true;
+				}
+				auto neighbors = getNeighboringCells(current);
+				for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+					unsigned int n = *it;
+					if(closed[n]) continue;
+					if(!isValidEdgeSlot(current, n, it.getSlot())) continue;
+					closed[n] = true;
+					nextLayer.emplace_back(n);
+				}
 			}
-			index++;
+			layer.swap(nextLayer);
 		}
 		return false;
 	}
 
 protected:
-	void setEdgeStatus(unsigned int a, unsigned int b, Edge::CollisionCheckingStatus status) {
-		auto vertexAndEdges = edges.find(a);
-		if(vertexAndEdges == edges.end()) {
+	Edge::CollisionCheckingStatus getSlotStatus(unsigned int slot) const {
+		if(implicitSlotsPerCell > 0) {
+			return (Edge::CollisionCheckingStatus)((implicitStatusBits[slot / 32] >> ((slot % 32) * 2)) & 3);
+		}
+		return edgeStatuses[slot];
+	}
+
+	void setSlotStatus(unsigned int slot, Edge::CollisionCheckingStatus status) {
+		if(implicitSlotsPerCell > 0) {
+			unsigned int shift = (slot % 32) * 2;
+			uint64_t &word = implicitStatusBits[slot / 32];
+			word = (word & ~((uint64_t)3 << shift)) | ((uint64_t)status << shift);
+			return;
+		}
+		edgeStatuses[slot] = status;
+	}
+
+	bool isValidEdgeSlot(unsigned int a, unsigned int b, unsigned int slot) {
+		if(getSlotStatus(slot) == Edge::UNKNOWN) {
+			decideByDistanceField(a, b, slot);
+		}
+
+		if(getSlotStatus(slot) == Edge::UNKNOWN && edgeValidator != NULL) {
+			prefetchQueue.emplace_back(a, slot);
+			drainPrefetchQueue();
+		}
+
+		if(getSlotStatus(slot) == Edge::UNKNOWN) {
+			// if(motionValidator->checkMotion(vertices[a]->state, vertices[b]->state)) {
+			if(globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->checkMotion(vertices[a]->state, vertices[b]->state)) {
+				setSlotStatus(slot, Edge::VALID);
+				setEdgeStatusUnchecked(b, a, Edge::VALID);
+			} else {
+				setSlotStatus(slot, Edge::INVALID);
+				setEdgeStatusUnchecked(b, a, Edge::INVALID);
+			}
+		}
+
+		return getSlotStatus(slot) == Edge::VALID;
+	}
+
+	/* check every still unknown (source, slot) pair of the batch on the edge validator's threads, the
+	   results are merged back in batch order so the status table does not depend on thread timing */
+	void validateEdgeSlots(const std::vector<std::pair<unsigned int, unsigned int>> &batch) {
+		if(batch.empty()) return;
+
+		std::vector<std::pair<unsigned int, unsigned int>> pending;
+		std::vector<std::pair<const ompl::base::State*, const ompl::base::State*>> motions;
+		std::unordered_set<unsigned long long> seen;
+
+		for(const auto &edge : batch) {
+			unsigned int a = edge.first;
+			unsigned int b = getSlotTarget(a, edge.second);
+			if(getSlotStatus(edge.second) != Edge::UNKNOWN) continue;
+			if(decideByDistanceField(a, b, edge.second)) continue;
+
+			//only the first of (a,b) and (b,a) is checked, the reverse edge shares the result
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+			if(!seen.insert(key).second) continue;
+
+			pending.push_back(edge);
+			motions.emplace_back(vertices[a]->state, vertices[b]->state);
+		}
+
+		if(pending.empty()) return;
+
+		if(edgeValidator == NULL) {
+			for(const auto &edge : pending) {
+				isValidEdgeSlot(edge.first, getSlotTarget(edge.first, edge.second), edge.second);
+			}
 			return;
 		}
 
-		auto &edges = vertexAndEdges->second;
+		std::vector<char> results;
+		edgeValidator->checkMotions(motions, results);
 
-		auto edge = edges.find(b);
-		if(edge == edges.end()) {
+		for(unsigned int i = 0; i < pending.size(); ++i) {
+			Edge::CollisionCheckingStatus status = results[i] ? Edge::VALID : Edge::INVALID;
+			setSlotStatus(pending[i].second, status);
+			setEdgeStatusUnchecked(getSlotTarget(pending[i].first, pending[i].second), pending[i].first, status);
+		}
+	}
+
+	/* The environment's distance field decides edges before FCL does: valid if a ball around the agent (as far
+	   as its farthest vertex) clears the environment all along the edge, invalid if the environment comes
+	   closer than the core radius to it. Needs the abstract space checked by FCL with a single rigid body,
+	   otherwise every edge is left to FCL. */
+	void setupDistanceField(double voxelSize, double coreRadius) {
+		auto abstract = globalParameters.globalAbstractAppBaseGeometric;
+		const ompl::base::StateValidityChecker *checker = abstract->getSpaceInformation()->getStateValidityChecker().get();
+
+		ompl::app::FCLMethodWrapperPtr wrapper;
+		if(auto planarChecker = dynamic_cast<const ompl::app::FCLStateValidityChecker<ompl::app::Motion_2D> *>(checker)) {
+			wrapper = planarChecker->getFCLWrapper();
+		} else if(auto spatialChecker = dynamic_cast<const ompl::app::FCLStateValidityChecker<ompl::app::Motion_3D> *>(checker)) {
+			wrapper = spatialChecker->getFCLWrapper();
+		}
+		if(!wrapper || wrapper->getRobotPartCount() != 1 || wrapper->checksSelfCollision()) {
+			OMPL_WARN("the distance field needs a single rigid body checked by FCL, abstract edges are left to FCL");
 			return;
 		}
 
-		edge->second.edgeStatus = status;
+		distanceFieldPlanar = abstract->getMotionModel() == ompl::app::Motion_2D;
+		agentRadius = wrapper->getRobotRadius();
+		distanceFieldCoreRadius = coreRadius;
+
+		//the field reaches a voxel past the farthest the agent can get
+		const ompl::base::StateSpacePtr &space = abstract->getGeometricComponentStateSpace();
+		const ompl::base::RealVectorBounds &bounds = distanceFieldPlanar ?
+		        space->as<ompl::base::SE2StateSpace>()->getBounds() : space->as<ompl::base::SE3StateSpace>()->getBounds();
+		double low[3] = {0, 0, 0}, high[3] = {0, 0, 0};
+		for(unsigned int d = 0; d < bounds.low.size() && d < 3; ++d) {
+			low[d] = bounds.low[d];
+			high[d] = bounds.high[d];
+		}
+		for(unsigned int d = 0; d < 3; ++d) {
+			low[d] -= agentRadius + voxelSize;
+			high[d] += agentRadius + voxelSize;
+		}
+
+		Timer timer("distance field");
+		distanceField = ompl::app::FCLDistanceFieldCache::get(*wrapper->getEnvironmentModel(), low, high, voxelSize);
+	}
+
+	// sets both directions of the edge if the distance field decides it
+	bool decideByDistanceField(unsigned int a, unsigned int b, unsigned int slot) {
+		if(!distanceField) return false;
+
+		double from[3], to[3];
+		getPosition(vertices[a]->state, from);
+		getPosition(vertices[b]->state, to);
+		DistanceField::SegmentStatus segment = distanceField->checkSegment(from, to, agentRadius, distanceFieldCoreRadius);
+		if(segment == DistanceField::Unknown) return false;
+
+		Edge::CollisionCheckingStatus status = segment == DistanceField::Free ? Edge::VALID : Edge::INVALID;
+		setSlotStatus(slot, status);
+		setEdgeStatusUnchecked(b, a, status);
+		ompl::app::collisionCheckCounters.local().distanceFieldDecisions++;
+		return true;
+	}
+
+	void getPosition(const ompl::base::State *state, double position[3]) const {
+		if(distanceFieldPlanar) {
+			auto se2 = state->as<ompl::base::SE2StateSpace::StateType>();
+			position[0] = se2->getX();
+			position[1] = se2->getY();
+			position[2] = 0;
+		} else {
+			auto se3 = state->as<ompl::base::SE3StateSpace::StateType>();
+			position[0] = se3->getX();
+			position[1] = se3->getY();
+			position[2] = se3->getZ();
+		}
+	}
+
+	void setEdgeStatus(unsigned int a, unsigned int b, Edge::CollisionCheckingStatus status) {
+		unsigned int slot = getEdgeSlot(a, b);
+		if(slot == NoEdge) {
+			return;
+		}
+		setSlotStatus(slot, status);
 	}
 
 	void setEdgeStatusUnchecked(unsigned int a, unsigned int b, Edge::CollisionCheckingStatus status) {
-		edges[a][b].edgeStatus = status;
+		setEdgeStatus(a, b, status);
+	}
+
+	/* Edge construction: subclasses clear the pending list, add their undirected edges and then
+	   call buildEdges which packs everything into the CSR arrays with every status UNKNOWN, or with
+	   the status of the previous graph for edges that survive if keepKnownStatuses is set */
+	void clearEdges() {
+		pendingEdges.clear();
+	}
+
+	void addUndirectedEdge(unsigned int a, unsigned int b) {
+		if(a == b) return;
+		pendingEdges.emplace_back(a, b);
+		pendingEdges.emplace_back(b, a);
+	}
+
+	void buildEdges(bool keepKnownStatuses = false) {
+		unsigned int vertexCount = vertices.size();
+
+		if(implicitSlotsPerCell > 0) {
+			keepKnownStatuses = false;
+			clearImplicitEdges();
+		}
+
+		//the old rows are needed to carry statuses over and to diff against for the change set
+		bool recordChanges = changes.revision > 0 && !changes.remapped && !neighborOffsets.empty();
+
+		std::vector<unsigned int> oldOffsets, oldIds;
+		std::vector<Edge::CollisionCheckingStatus> oldStatuses;
+		if(keepKnownStatuses || recordChanges) {
+			oldOffsets.swap(neighborOffsets);
+			oldIds.swap(neighborIds);
+			oldStatuses.swap(edgeStatuses);
+		}
+
+		neighborOffsets.assign(vertexCount + 1, 0);
+		for(const auto &edge : pendingEdges) {
+			neighborOffsets[edge.first + 1]++;
+		}
+		for(unsigned int i = 0; i < vertexCount; ++i) {
+			neighborOffsets[i + 1] += neighborOffsets[i];
+		}
+
+		neighborIds.resize(pendingEdges.size());
+		std::vector<unsigned int> fill(neighborOffsets.begin(), neighborOffsets.end() - 1);
+		for(const auto &edge : pendingEdges) {
+			neighborIds[fill[edge.first]++] = edge.second;
+		}
+
+		//sort each row and squeeze out duplicates in place
+		unsigned int write = 0;
+		unsigned int rowStart = 0;
+		for(unsigned int i = 0; i < vertexCount; ++i) {
+			auto first = neighborIds.begin() + rowStart;
+			auto last = neighborIds.begin() + neighborOffsets[i + 1];
+			std::sort(first, last);
+			last = std::unique(first, last);
+
+			rowStart = neighborOffsets[i + 1];
+			neighborOffsets[i] = write;
+			for(auto it = first; it != last; ++it) {
+				neighborIds[write++] = *it;
+			}
+		}
+		neighborOffsets[vertexCount] = write;
+		neighborIds.resize(write);
+		neighborIds.shrink_to_fit();
+
+		edgeStatuses.assign(write, Edge::UNKNOWN);
+		prefetchQueue.clear();
+
+		if(keepKnownStatuses && !oldOffsets.empty()) {
+			unsigned int oldVertexCount = oldOffsets.size() - 1;
+			for(unsigned int a = 0; a < oldVertexCount && a < vertexCount; ++a) {
+				auto oldFirst = oldIds.begin() + oldOffsets[a];
+				auto oldLast = oldIds.begin() + oldOffsets[a+1];
+				for(unsigned int slot = neighborOffsets[a]; slot < neighborOffsets[a+1]; ++slot) {
+					auto found = std::lower_bound(oldFirst, oldLast, neighborIds[slot]);
+					if(found != oldLast && *found == neighborIds[slot]) {
+						edgeStatuses[slot] = oldStatuses[found - oldIds.begin()];
+					}
+				}
+			}
+		}
+
+		if(recordChanges) {
+			recordEdgeChanges(oldOffsets, oldIds, oldStatuses);
+		}
+
+		pendingEdges.clear();
+		pendingEdges.shrink_to_fit();
+	}
+
+	/* Implicit grid edges: nothing is materialized, the neighbors of a cell are cell + delta for every offset
+	   slot that stays inside the grid, and the edge statuses are two bits per (cell, offset slot) pair.
+	   dimensionSizes are the cells along each axis (axis 0 varies fastest) and offsets the per axis steps of
+	   every neighbor slot. Calling this again after the grid changes only resets the status bits. */
+	void buildImplicitEdges(const std::vector<unsigned int> &dimensionSizes, const std::vector< std::vector<int> > &offsets) {
+		setImplicitLayout(dimensionSizes, offsets);
+		implicitSlotsPerCell = offsets.size();
+
+		neighborOffsets.clear();
+		neighborIds.clear();
+		edgeStatuses.clear();
+		neighborIds.shrink_to_fit();
+		edgeStatuses.shrink_to_fit();
+
+		implicitStatusBits.assign(((unsigned long long)vertices.size() * implicitSlotsPerCell + 31) / 32, 0);
+		prefetchQueue.clear();
+	}
+
+	/* The strides, deltas and boundary masks of the implicit grid without the status bits, enough for
+	   getImplicitBoundary and for a grid that materializes its neighbors in CSR to enumerate them. */
+	void setImplicitLayout(const std::vector<unsigned int> &dimensionSizes, const std::vector< std::vector<int> > &offsets) {
+		unsigned int dimensions = dimensionSizes.size();
+		assert(dimensions <= 16);
+
+		implicitSizes = dimensionSizes;
+		implicitStrides.resize(dimensions);
+		unsigned int stride = 1;
+		for(unsigned int d = 0; d < dimensions; ++d) {
+			implicitStrides[d] = stride;
+			stride *= dimensionSizes[d];
+		}
+		assert(stride == vertices.size());
+
+		implicitDeltas.clear();
+		implicitBlockedBy.clear();
+		for(const auto &offset : offsets) {
+			int delta = 0;
+			unsigned int blockedBy = 0;
+			for(unsigned int d = 0; d < dimensions; ++d) {
+				delta += offset[d] * (int)implicitStrides[d];
+				if(offset[d] < 0) blockedBy |= 1u << (2 * d);
+				if(offset[d] > 0) blockedBy |= 1u << (2 * d + 1);
+			}
+			implicitDeltas.push_back(delta);
+			implicitBlockedBy.push_back(blockedBy);
+		}
+	}
+
+	// both rows are sorted, so every vertex is a single merge of its old and new neighbors
+	void recordEdgeChanges(const std::vector<unsigned int> &oldOffsets, const std::vector<unsigned int> &oldIds,
+	                       const std::vector<Edge::CollisionCheckingStatus> &oldStatuses) {
+		unsigned int oldVertexCount = oldOffsets.size() - 1;
+		for(unsigned int a = 0; a < vertices.size(); ++a) {
+			unsigned int oldSlot = a < oldVertexCount ? oldOffsets[a] : 0;
+			unsigned int oldEnd = a < oldVertexCount ? oldOffsets[a+1] : 0;
+			unsigned int slot = neighborOffsets[a];
+			unsigned int end = neighborOffsets[a+1];
+
+			while(oldSlot < oldEnd || slot < end) {
+				if(slot == end || (oldSlot < oldEnd && oldIds[oldSlot] < neighborIds[slot])) {
+					changes.removedEdges.emplace_back(a, oldIds[oldSlot++]);
+				} else if(oldSlot == oldEnd || neighborIds[slot] < oldIds[oldSlot]) {
+					changes.addedEdges.emplace_back(a, neighborIds[slot++]);
+				} else {
+					if(oldStatuses[oldSlot] != Edge::UNKNOWN && edgeStatuses[slot] == Edge::UNKNOWN) {
+						changes.resetEdges.emplace_back(a, neighborIds[slot]);
+					}
+					oldSlot++;
+					slot++;
+				}
+			}
+		}
+	}
+
+	void clearImplicitEdges() {
+		implicitSlotsPerCell = 0;
+		implicitDeltas.clear();
+		implicitBlockedBy.clear();
+		implicitStatusBits.clear();
+		implicitStatusBits.shrink_to_fit();
+	}
+
+	// bit 2d is set when the cell is on the low face of axis d and bit 2d+1 when it is on the high face
+	unsigned int getImplicitBoundary(unsigned int cell) const {
+		unsigned int boundary = 0;
+		for(unsigned int d = 0; d < implicitSizes.size(); ++d) {
+			unsigned int coordinate = (cell / implicitStrides[d]) % implicitSizes[d];
+			if(coordinate == 0) boundary |= 1u << (2 * d);
+			if(coordinate + 1 == implicitSizes[d]) boundary |= 1u << (2 * d + 1);
+		}
+		return boundary;
 	}
 
 	std::vector<Vertex *> vertices;
-	std::unordered_map<unsigned int, std::unordered_map<unsigned int, Edge>> edges;
+
+	/* CSR adjacency, the neighbors of vertex i are neighborIds[neighborOffsets[i] .. neighborOffsets[i+1])
+	   and edgeStatuses is parallel to neighborIds */
+	std::vector<unsigned int> neighborOffsets;
+	std::vector<unsigned int> neighborIds;
+	std::vector<Edge::CollisionCheckingStatus> edgeStatuses;
+	std::vector<std::pair<unsigned int, unsigned int>> pendingEdges;
+
+	unsigned int implicitSlotsPerCell = 0;
+	std::vector<unsigned int> implicitSizes, implicitStrides, implicitBlockedBy;
+	std::vector<int> implicitDeltas;
+	std::vector<uint64_t> implicitStatusBits;
+
+	ChangeSet changes;
+
+	AbstractEdgeValidator *edgeValidator = NULL;
+	std::vector<std::pair<unsigned int, unsigned int>> prefetchQueue;
+
+	ompl::app::FCLDistanceFieldCache::FieldPtr distanceField;
+	double agentRadius = 0, distanceFieldCoreRadius = 0;
+	bool distanceFieldPlanar = false;
+
 	const ompl::base::MotionValidatorPtr &motionValidator;
 	const ompl::base::State *start, *goal;
 };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../../structs/threadpool.hpp"
+
+/* Checks batches of abstract states and edges on a thread pool.
+
+Every worker thread gets its own validity checker (and so its own collision models) built from the
+geometric abstract app, the calling thread reuses the checker owned by the space information. The motion
+check mirrors OMPL's DiscreteMotionValidator so results match the serial si->checkMotion path, unless the
+space information validates motions with FCLContinuousMotionValidator (ContinuousMotionValidation), then
+every thread gets one of those over its own checker.
+
+Valid state samplers check states through their space information, so every checker past the first one also
+gets a space information of its own with the domain's abstract sampler allocator installed on it.
+*/
+
+class AbstractEdgeValidator {
+public:
+	AbstractEdgeValidator(unsigned int threadCount) : pool(threadCount) {
+		auto app = globalParameters.globalAbstractAppBaseGeometric;
+		si = app->getSpaceInformation();
+
+		checkers.push_back(si->getStateValidityChecker());
+		for(unsigned int i = 1; i < pool.getThreadCount(); ++i) {
+			checkers.push_back(app->allocThreadLocalStateValidityChecker(si, app->getGeometricStateExtractor(), app->isSelfCollisionEnabled()));
+		}
+
+		spaceInformations.push_back(si);
+		for(unsigned int i = 1; i < pool.getThreadCount(); ++i) {
+			auto threadSi = std::make_shared<ompl::base::SpaceInformation>(si->getStateSpace());
+			threadSi->setStateValidityChecker(checkers[i]);
+			threadSi->setStateValidityCheckingResolution(si->getStateValidityCheckingResolution());
+			if(globalParameters.abstractValidStateSamplerAllocator) {
+				threadSi->setValidStateSamplerAllocator(globalParameters.abstractValidStateSamplerAllocator);
+			}
+			threadSi->setup();
+			spaceInformations.push_back(threadSi);
+		}
+
+		for(unsigned int i = 0; i < pool.getThreadCount(); ++i) {
+			scratchStates.push_back(si->allocState());
+		}
+
+		if(dynamic_cast<ompl::app::FCLContinuousMotionValidator *>(si->getMotionValidator().get()) != NULL) {
+			validators.push_back(si->getMotionValidator());
+			for(unsigned int i = 1; i < pool.getThreadCount(); ++i) {
+				validators.push_back(std::make_shared<ompl::app::FCLContinuousMotionValidator>(si.get(), checkers[i], app->getMotionModel()));
+			}
+		}
+	}
+
+	~AbstractEdgeValidator() {
+		for(auto state : scratchStates) {
+			si->freeState(state);
+		}
+	}
+
+	unsigned int getThreadCount() const {
+		return pool.getThreadCount();
+	}
+
+	// results[i] is set to 1 if the motion from motions[i].first to motions[i].second is valid and 0 otherwise
+	void checkMotions(const std::vector<std::pair<const ompl::base::State*, const ompl::base::State*>> &motions, std::vector<char> &results) {
+		results.assign(motions.size(), 0);
+		pool.parallelFor(motions.size(), [&](unsigned int i, unsigned int thread) {
+			results[i] = checkMotion(motions[i].first, motions[i].second, thread) ? 1 : 0;
+		});
+	}
+
+	void parallelFor(unsigned int count, const ThreadPool::Work &work) {
+		pool.parallelFor(count, work);
+	}
+
+	void parallelForChunks(unsigned int from, unsigned int to, const ThreadPool::ChunkWork &work) {
+		pool.parallelForChunks(from, to, work);
+	}
+
+	/* the domain's valid state sampler over checker index, for parallelForChunks allocate one per chunk (in chunk
+	   order on the calling thread) and only use it from that chunk, then no checker is ever used by two threads */
+	ompl::base::ValidStateSamplerPtr allocValidStateSampler(unsigned int index) const {
+		return spaceInformations[index]->allocValidStateSampler();
+	}
+
+	// only to be called from inside parallelFor with the thread index it handed out
+	bool isValid(const ompl::base::State *state, unsigned int thread) const {
+		return checkers[thread]->isValid(state);
+	}
+
+protected:
+	bool checkMotion(const ompl::base::State *s1, const ompl::base::State *s2, unsigned int thread) const {
+		if(!validators.empty()) {
+			return validators[thread]->checkMotion(s1, s2);
+		}
+
+		const ompl::base::StateValidityCheckerPtr &checker = checkers[thread];
+		if(!checker->isValid(s2)) {
+			return false;
+		}
+
+		const ompl::base::StateSpacePtr &space = si->getStateSpace();
+		ompl::base::State *test = scratchStates[thread];
+
+		unsigned int segments = space->validSegmentCount(s1, s2);
+		for(unsigned int j = 1; j < segments; ++j) {
+			space->interpolate(s1, s2, (double)j / (double)segments, test);
+			if(!checker->isValid(test)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	ThreadPool pool;
+	ompl::base::SpaceInformationPtr si;
+	std::vector<ompl::base::SpaceInformationPtr> spaceInformations;
+	std::vector<ompl::base::StateValidityCheckerPtr> checkers;
+	std::vector<ompl::base::MotionValidatorPtr> validators;
+	std::vector<ompl::base::State*> scratchStates;
+};
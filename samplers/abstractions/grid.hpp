@@ -13,10 +13,11 @@ class Grid : public Abstraction {
 	};
 
 public:
-	Grid(const ompl::base::State *start, const ompl::base::State *goal, const FileMap &params) : Abstraction(start, goal) {
+	Grid(const ompl::base::State *start, const ompl::base::State *goal, const FileMap &params) : Abstraction(start, goal, params) {
 		hintSize = params.doubleVal("GridHintSize");
 		useDiagonalNeighbors = params.exists("GridConnectivity") && params.stringVal("GridConnectivity").compare("Diagonals") == 0;
 		resizeFactor = params.exists("GridResizeFactor") ? params.doubleVal("GridResizeFactor") : 0.5;
+		useImplicitEdges = params.exists("GridImplicitEdges") && params.boolVal("GridImplicitEdges");
 	}
 
 	virtual void initialize(bool forceConnectedness = true) {
@@ -86,9 +87,26 @@ public:
 	}
 
 	virtual void grow() {
+		//every cell is renumbered when an axis is refined, so the change set only says where each new cell came from
+		changes.reset(vertices.size(), true);
+		std::vector<unsigned int> oldDimensionSizes = discreteDimensionSizes;
+		std::vector<double> oldDiscretizationSizes = discretizationSizes;
+
 		sizes[nextResize] *= resizeFactor;
 		if(++nextResize >= sizes.size()) nextResize = 0;
 		reinitialize();
+
+		changes.parents.resize(vertices.size());
+		for(unsigned int i = 0; i < vertices.size(); ++i) {
+			auto point = getGridCenter(i);
+			unsigned int parent = 0, stride = 1;
+			for(unsigned int d = 0; d < point.size(); ++d) {
+				unsigned int which = floor((point[d] - globalParameters.abstractBounds.low[d]) / oldDiscretizationSizes[d]);
+				parent += std::min(which, oldDimensionSizes[d] - 1) * stride;
+				stride *= oldDimensionSizes[d];
+			}
+			changes.parents[i] = parent;
+		}
 	}
 
 protected:
@@ -100,12 +118,9 @@ protected:
 		vertices.reserve(cellCount);
 
 		for(unsigned int i = 0; i < oldCount; ++i) {
-			vertices[i]->populatedNeighors = false;
-			vertices[i]->neighbors.clear();
 			((Grid::Vertex*)vertices[i])->hasGridCenter = false;
 			((Grid::Vertex*)vertices[i])->hasGridCoordinate = false;
 
-			auto gridPoint = getGridCoordinates(i);
 			auto point = getGridCenter(i);
 
 			globalParameters.copyVectorToAbstractState(vertices[i]->state, point);
@@ -115,7 +130,6 @@ protected:
 			vertices.emplace_back(new Vertex(i));
 			vertices.back()->state = abstractSpace->allocState();
 
-			auto gridPoint = getGridCoordinates(i);
 			auto point = getGridCenter(i);
 
 			globalParameters.copyVectorToAbstractState(vertices.back()->state, point);
@@ -123,24 +137,27 @@ protected:
 	}
 
 	virtual void generateEdges() {
-		edges.clear();
-
-		for(unsigned int i = 0; i < vertices.size(); ++i) {
-			Vertex *vertex = (Grid::Vertex*)vertices[i];
-			edges[vertex->id];
-
-			auto discreteCoordinate = getGridCoordinates(i);
+		//neighbors always come from the strides of the grid, in the implicit mode that is all there is to it
+		if(useImplicitEdges) {
+			buildImplicitEdges(discreteDimensionSizes, gridNeighbors);
+			return;
+		}
 
-			std::vector<unsigned int> neighbors = getNeighbors(discreteCoordinate);
+		//the CSR rows only need the layout, not the implicit mode's status bits
+		setImplicitLayout(discreteDimensionSizes, gridNeighbors);
+		clearEdges();
+		pendingEdges.reserve(vertices.size() * gridNeighbors.size() * 2);
 
-			for(auto n : neighbors) {
-				Vertex *neighbor = (Grid::Vertex*)vertices[n];
-				if(vertex->id == neighbor->id) continue;
-				
-				edges[vertex->id][neighbor->id] = Edge(neighbor->id);
-				edges[neighbor->id][vertex->id] = Edge(vertex->id);
+		for(unsigned int i = 0; i < vertices.size(); ++i) {
+			unsigned int boundary = getImplicitBoundary(i);
+			for(unsigned int k = 0; k < implicitDeltas.size(); ++k) {
+				if((implicitBlockedBy[k] & boundary) == 0) {
+					addUndirectedEdge(i, i + implicitDeltas[k]);
+				}
 			}
 		}
+
+		buildEdges();
 	}
 
 	void reinitialize() {
@@ -177,25 +194,6 @@ protected:
 		}	
 	}
 
-	std::vector<unsigned int> getNeighbors(const std::vector<unsigned int> &discreteCoordinate) const {
-		std::vector<unsigned int> neighbors;
-
-		for(auto neighbor : gridNeighbors) {
-			std::vector<unsigned int> coord(discreteCoordinate);
-			bool valid = true;
-			for(unsigned int i = 0; i < neighbor.size(); ++i) {
-				if((coord[i] == 0 && neighbor[i] < 0) ||
-					(coord[i] + neighbor[i] >= discreteDimensionSizes[i])) { valid = false; break; }
-				coord[i] += neighbor[i];
-			}
-			if(valid) {
-				neighbors.push_back(getIndex(coord));
-			}
-		}
-
-		return neighbors;
-	}
-
 	void populateNeighborsGrid() {
 		gridNeighbors.clear();
 
@@ -236,13 +234,11 @@ protected:
 
 		std::vector<double> point;
 
-		point.push_back(globalParameters.abstractBounds.low[0] + (double)(n % discreteDimensionSizes[0]) * discretizationSizes[0] + discretizationSizes[0]  * 0.5);
-		if(discreteDimensionSizes.size() > 1) {
-			unsigned int previousDimSizes = 1;
-			for(unsigned int i = 1; i < discreteDimensionSizes.size(); i++) {
-				previousDimSizes *= discreteDimensionSizes[i];
-				point.push_back(globalParameters.abstractBounds.low[i] + (double)(n / previousDimSizes % discreteDimensionSizes[i]) * discretizationSizes[i] + discretizationSizes[1]  * 0.5);
-			}
+		//axis 0 varies fastest, the same layout getIndex uses
+		unsigned int previousDimSizes = 1;
+		for(unsigned int i = 0; i < discreteDimensionSizes.size(); i++) {
+			point.push_back(globalParameters.abstractBounds.low[i] + (double)(n / previousDimSizes % discreteDimensionSizes[i]) * discretizationSizes[i] + discretizationSizes[i]  * 0.5);
+			previousDimSizes *= discreteDimensionSizes[i];
 		}
 
 		((Grid::Vertex*)vertices[n])->hasGridCenter = true;
@@ -258,13 +254,10 @@ protected:
 
 		std::vector<unsigned int> coordinate;
 
-		coordinate.push_back(n % discreteDimensionSizes[0]);
-		if(discreteDimensionSizes.size() > 1) {
-			unsigned int previousDimSizes = 1;
-			for(unsigned int i = 1; i < discreteDimensionSizes.size(); i++) {
-				previousDimSizes *= discreteDimensionSizes[i];
-				coordinate.push_back(n / previousDimSizes % discreteDimensionSizes[i]);
-			}
+		unsigned int previousDimSizes = 1;
+		for(unsigned int i = 0; i < discreteDimensionSizes.size(); i++) {
+			coordinate.push_back(n / previousDimSizes % discreteDimensionSizes[i]);
+			previousDimSizes *= discreteDimensionSizes[i];
 		}
 
 		((Grid::Vertex*)vertices[n])->hasGridCoordinate = true;
@@ -314,6 +307,6 @@ protected:
 	std::vector<unsigned int> discreteDimensionSizes;
 	std::vector<double> discretizationSizes, dimensionRanges;
 
-	bool useDiagonalNeighbors;
+	bool useDiagonalNeighbors, useImplicitEdges;
 	ompl::RNG randomNumbers;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "abstraction.hpp"
+#include "snapshot.hpp"
 
 #include <ompl/base/SpaceInformation.h>
 
@@ -12,52 +13,102 @@
 class PRMLite : public Abstraction {
 public:
 	PRMLite(const ompl::base::SpaceInformation *si, const ompl::base::State *start, const ompl::base::State *goal, const FileMap &params) :
-		Abstraction(start, goal), prmSize(params.integerVal("PRMSize")), numEdges(params.integerVal("NumEdges")),
+		Abstraction(start, goal, params), prmSize(params.integerVal("PRMSize")), numEdges(params.integerVal("NumEdges")),
 		stateRadius(params.doubleVal("StateRadius")) {
 
 		resizeFactor = params.exists("PRMResizeFactor") ? params.doubleVal("PRMResizeFactor") : 2;
 
 		//Stolen from tools::SelfConfig::getDefaultNearestNeighbors
 		if(si->getStateSpace()->isMetricSpace()) {
-			// if (specs.multithreaded)
-			//  nn.reset(new NearestNeighborsGNAT<Vertex*>());
-			//else
-			nn.reset(new ompl::NearestNeighborsGNATNoThreadSafety<Vertex *>());
+			//the k-NN pass is run from several threads at once when we have workers, which the NoThreadSafety GNAT can't take
+			if(edgeValidator != NULL)
+				nn.reset(new ompl::NearestNeighborsGNAT<Vertex *>());
+			else
+				nn.reset(new ompl::NearestNeighborsGNATNoThreadSafety<Vertex *>());
 		} else {
 			nn.reset(new ompl::NearestNeighborsSqrtApprox<Vertex *>());
 		}
 
 		nn->setDistanceFunction(boost::bind(&Abstraction::abstractDistanceFunction, this, _1, _2));
+
+		if(params.exists("AbstractionSnapshots")) {
+			snapshotDirectory = params.stringVal("AbstractionSnapshots");
+			snapshotInputs = hashSnapshotInputs(params);
+		}
 	}
 
 	virtual void initialize(bool forceConnectedness = true) {
+		std::string snapshotPath;
+		uint64_t snapshotKey = 0;
+		if(!snapshotDirectory.empty()) {
+			AbstractionSnapshot::Hasher hasher = snapshotInputs;
+			hasher.add(&forceConnectedness, sizeof(forceConnectedness));
+			snapshotKey = hasher.get();
+			snapshotPath = AbstractionSnapshot::getPath(snapshotDirectory, snapshotKey);
+			if(loadSnapshot(snapshotPath, snapshotKey)) {
+				return;
+			}
+		}
+
 		generateVertices();
 		generateEdges();
 
 		while(forceConnectedness && !checkConnectivity()) {
 			grow();
 		}
-	}
 
-	virtual void grow() {
-		for(unsigned int i = 0; i < prmSize; ++i) {
-			vertices[i]->populatedNeighors = false;
-			vertices[i]->neighbors.clear();
+		if(!snapshotPath.empty()) {
+			saveSnapshot(snapshotPath, snapshotKey);
 		}
+	}
 
+	virtual void grow() {
 		unsigned int oldPRMSize = prmSize;
 		prmSize *= resizeFactor;
-		vertices.resize(prmSize);
-		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
-		ompl::base::ValidStateSamplerPtr abstractSampler = globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->allocValidStateSampler();
-		for(unsigned int i = oldPRMSize; i < prmSize; ++i) {
-			vertices[i] = new Vertex(i);
-			vertices[i]->state = abstractSpace->allocState();
-			abstractSampler->sample(vertices[i]->state);
-			nn->add(vertices[i]);
+
+		//ids are stable here, buildEdges fills in which edges came and went
+		changes.reset(oldPRMSize, false);
+
+		std::vector<Vertex *> added;
+		{
+			Timer timer("Vertex Generation");
+			sampleVertices(oldPRMSize, prmSize);
+			added.assign(vertices.begin() + oldPRMSize, vertices.end());
+			nn->add(added);
 		}
 
-		generateEdges();
+		Timer timer("Edge Generation");
+
+		//only the old vertices that now have one of the new ones among their k nearest need a new k-NN query
+		double searchRadius = 0;
+		for(unsigned int i = 0; i < oldPRMSize; ++i) {
+			searchRadius = std::max(searchRadius, kthNeighborDistance[i]);
+		}
+
+		std::vector<bool> affected(prmSize, false);
+		std::vector<Vertex *> candidates;
+		for(Vertex *vertex : added) {
+			affected[vertex->id] = true;
+			nn->nearestR(vertex, searchRadius, candidates);
+			for(Vertex *candidate : candidates) {
+				if(candidate->id < oldPRMSize && !affected[candidate->id] &&
+				   abstractDistanceFunction(candidate, vertex) < kthNeighborDistance[candidate->id]) {
+					affected[candidate->id] = true;
+				}
+			}
+		}
+
+		std::vector<unsigned int> requery;
+		for(unsigned int i = 0; i < prmSize; ++i) {
+			if(affected[i]) requery.push_back(i);
+		}
+
+		nearestNeighbors.resize(prmSize);
+		kthNeighborDistance.resize(prmSize);
+		computeNearestNeighbors(requery);
+
+		stageEdges();
+		buildEdges(true);
 	}
 
 	virtual unsigned int getStartIndex() const {
@@ -88,49 +139,264 @@ protected:
 	void generateVertices() {
 		Timer timer("Vertex Generation");
 		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
-		ompl::base::ValidStateSamplerPtr abstractSampler = globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->allocValidStateSampler();
 
-		vertices.resize(prmSize);
+		vertices.resize(2);
 
 		vertices[0] = new Vertex(0);
 		vertices[0]->state = abstractSpace->allocState();
 		abstractSpace->copyState(vertices[0]->state, start);
-		nn->add(vertices[0]);
 
 		vertices[1] = new Vertex(1);
 		vertices[1]->state = abstractSpace->allocState();
 		abstractSpace->copyState(vertices[1]->state, goal);
-		nn->add(vertices[1]);
 
-		for(unsigned int i = 2; i < prmSize; ++i) {
+		sampleVertices(2, prmSize);
+
+		//one bulk add lets the GNAT build its tree in a single pass
+		nn->add(vertices);
+	}
+
+	/* fill vertices [from, to) with valid abstract states. With workers the range is cut into one fixed chunk per
+	   thread, and every chunk has its own valid state sampler (allocated here, in order, so their seeds come from Seed)
+	   which keeps the roadmap the same from run to run no matter how the threads get scheduled. Like the serial path
+	   every vertex gets one sample call, so the sampler's own attempt limit applies and a failed sample is kept */
+	void sampleVertices(unsigned int from, unsigned int to) {
+		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
+
+		vertices.resize(to);
+		for(unsigned int i = from; i < to; ++i) {
 			vertices[i] = new Vertex(i);
 			vertices[i]->state = abstractSpace->allocState();
-			abstractSampler->sample(vertices[i]->state);
-			nn->add(vertices[i]);
 		}
+
+		if(edgeValidator == NULL) {
+			ompl::base::ValidStateSamplerPtr abstractSampler = globalParameters.globalAbstractAppBaseGeometric->getSpaceInformation()->allocValidStateSampler();
+			for(unsigned int i = from; i < to; ++i) {
+				abstractSampler->sample(vertices[i]->state);
+			}
+			return;
+		}
+
+		std::vector<ompl::base::ValidStateSamplerPtr> samplers;
+		for(unsigned int i = 0; i < edgeValidator->getThreadCount(); ++i) {
+			samplers.push_back(edgeValidator->allocValidStateSampler(i));
+		}
+
+		edgeValidator->parallelForChunks(from, to, [&](unsigned int chunk, unsigned int first, unsigned int last, unsigned int thread) {
+			for(unsigned int i = first; i < last; ++i) {
+				samplers[chunk]->sample(vertices[i]->state);
+			}
+		});
 	}
 
 	void generateEdges() {
 		Timer timer("Edge Generation");
-		edges.clear();
 
-		auto distanceFunc = nn->getDistanceFunction();
+		nearestNeighbors.assign(vertices.size(), std::vector<unsigned int>());
+		kthNeighborDistance.assign(vertices.size(), 0);
+
+		std::vector<unsigned int> all(vertices.size());
+		for(unsigned int i = 0; i < all.size(); ++i) {
+			all[i] = i;
+		}
+		computeNearestNeighbors(all);
 
-		for(Vertex *vertex : vertices) {
-			edges[vertex->id];
+		stageEdges();
+		buildEdges();
+	}
 
-			std::vector<Vertex *> neighbors;
-			nn->nearestK(vertex, numEdges+1, neighbors);
+	void computeNearestNeighbors(const std::vector<unsigned int> &which) {
+		auto query = [&](unsigned int i, std::vector<Vertex *> &neighbors) {
+			unsigned int id = which[i];
+			nn->nearestK(vertices[id], numEdges+1, neighbors);
 
+			nearestNeighbors[id].clear();
+			kthNeighborDistance[id] = 0;
 			for(Vertex *neighbor : neighbors) {
-				if(vertex->id == neighbor->id) continue;
-				edges[vertex->id][neighbor->id] = Edge(neighbor->id);
-				edges[neighbor->id][vertex->id] = Edge(vertex->id);
+				if(neighbor->id == id) continue;
+				nearestNeighbors[id].push_back(neighbor->id);
+				kthNeighborDistance[id] = std::max(kthNeighborDistance[id], abstractDistanceFunction(vertices[id], neighbor));
+			}
+
+			//a vertex without a full set of neighbors picks up any vertex that gets added
+			if(nearestNeighbors[id].size() < numEdges) {
+				kthNeighborDistance[id] = std::numeric_limits<double>::infinity();
+			}
+		};
+
+		if(edgeValidator == NULL) {
+			std::vector<Vertex *> neighbors;
+			for(unsigned int i = 0; i < which.size(); ++i) {
+				query(i, neighbors);
+			}
+			return;
+		}
+
+		std::vector<std::vector<Vertex *>> neighborBuffers(edgeValidator->getThreadCount());
+		edgeValidator->parallelFor(which.size(), [&](unsigned int i, unsigned int thread) {
+			query(i, neighborBuffers[thread]);
+		});
+	}
+
+	void stageEdges() {
+		clearEdges();
+		pendingEdges.reserve(vertices.size() * numEdges * 2);
+
+		for(unsigned int i = 0; i < nearestNeighbors.size(); ++i) {
+			for(unsigned int n : nearestNeighbors[i]) {
+				addUndirectedEdge(i, n);
 			}
 		}
 	}
 
+	/* everything the roadmap and its checked edges depend on. The meshes are hashed as the abstract app loaded
+	   them, so the key doesn't depend on where a domain reads its models from */
+	AbstractionSnapshot::Hasher hashSnapshotInputs(const FileMap &params) const {
+		AbstractionSnapshot::Hasher hasher;
+		uint32_t version = AbstractionSnapshot::Version;
+		hasher.add(&version, sizeof(version));
+
+		hasher.add(params, { "Domain", "AgentMesh", "EnvironmentMesh", "Seed", "AbstractionThreads" });
+
+		auto app = globalParameters.globalAbstractAppBaseGeometric;
+		const ompl::app::GeometrySpecification &geometry = app->getGeometrySpecification();
+		hashScenes(hasher, geometry.robot);
+		hashScenes(hasher, geometry.obstacles);
+		for(const aiVector3D &shift : geometry.robotShift) {
+			hasher.add(&shift, sizeof(shift));
+		}
+
+		AbstractionSnapshot::Validity validity;
+		validity.checkingResolution = app->getSpaceInformation()->getStateValidityCheckingResolution();
+		validity.cacheResolution = validityCacheSettings.resolution;
+		validity.cacheRotationResolution = validityCacheSettings.rotationResolution;
+		validity.cacheConservative = validityCacheSettings.conservative;
+		validity.cacheInvalidCells = validityCacheSettings.invalidCells;
+		validity.continuousMotionValidation =
+			dynamic_cast<ompl::app::FCLContinuousMotionValidator *>(app->getSpaceInformation()->getMotionValidator().get()) != NULL;
+		if(distanceField) {
+			validity.distanceFieldVoxelSize = distanceField->getVoxelSize();
+			validity.distanceFieldCoreRadius = distanceFieldCoreRadius;
+		}
+		hasher.add(validity);
+
+		hasher.add(&prmSize, sizeof(prmSize));
+		hasher.add(&numEdges, sizeof(numEdges));
+		hasher.add(resizeFactor);
+
+		const ompl::base::RealVectorBounds &bounds = globalParameters.abstractBounds;
+		for(unsigned int i = 0; i < bounds.low.size(); ++i) {
+			hasher.add(bounds.low[i]);
+			hasher.add(bounds.high[i]);
+		}
+
+		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
+		unsigned int dimension = abstractSpace->getValueLocations().size();
+		hasher.add(&dimension, sizeof(dimension));
+		for(unsigned int i = 0; i < dimension; ++i) {
+			hasher.add(*abstractSpace->getValueAddressAtIndex(start, i));
+			hasher.add(*abstractSpace->getValueAddressAtIndex(goal, i));
+		}
+		return hasher;
+	}
+
+	// the triangles of every scene after its node transforms
+	static void hashScenes(AbstractionSnapshot::Hasher &hasher, const std::vector<const aiScene *> &scenes) {
+		uint64_t count = scenes.size();
+		hasher.add(&count, sizeof(count));
+		std::vector<aiVector3D> triangles;
+		for(const aiScene *scene : scenes) {
+			ompl::app::scene::extractTriangles(scene, triangles);
+			count = triangles.size();
+			hasher.add(&count, sizeof(count));
+			hasher.add(triangles.data(), triangles.size() * sizeof(aiVector3D));
+		}
+	}
+
+	bool loadSnapshot(const std::string &path, uint64_t key) {
+		Timer timer("Abstraction Snapshot Load");
+		AbstractionSnapshot snapshot;
+		if(!snapshot.map(path, key)) {
+			return false;
+		}
+
+		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
+		const AbstractionSnapshot::Header &header = snapshot.getHeader();
+		unsigned int dimension = header.dimension;
+		if(dimension != abstractSpace->getValueLocations().size()) {
+			return false;
+		}
+
+		unsigned int vertexCount = header.vertexCount;
+		const double *states = snapshot.getSection<double>(AbstractionSnapshot::States);
+		vertices.resize(vertexCount);
+		for(unsigned int i = 0; i < vertexCount; ++i) {
+			vertices[i] = new Vertex(i);
+			vertices[i]->state = abstractSpace->allocState();
+			for(unsigned int j = 0; j < dimension; ++j) {
+				*abstractSpace->getValueAddressAtIndex(vertices[i]->state, j) = states[i * dimension + j];
+			}
+		}
+		prmSize = header.prmSize;
+		nn->add(vertices);
+
+		const uint32_t *edgeOffsets = snapshot.getSection<uint32_t>(AbstractionSnapshot::EdgeOffsets);
+		const uint32_t *edgeTargets = snapshot.getSection<uint32_t>(AbstractionSnapshot::EdgeTargets);
+		const uint8_t *edgeStatusBytes = snapshot.getSection<uint8_t>(AbstractionSnapshot::EdgeStatuses);
+		neighborOffsets.assign(edgeOffsets, edgeOffsets + vertexCount + 1);
+		neighborIds.assign(edgeTargets, edgeTargets + header.edgeCount);
+		edgeStatuses.resize(header.edgeCount);
+		for(unsigned int i = 0; i < header.edgeCount; ++i) {
+			edgeStatuses[i] = (Edge::CollisionCheckingStatus)edgeStatusBytes[i];
+		}
+
+		const uint32_t *knnOffsets = snapshot.getSection<uint32_t>(AbstractionSnapshot::NeighborOffsets);
+		const uint32_t *knnTargets = snapshot.getSection<uint32_t>(AbstractionSnapshot::NeighborTargets);
+		const double *kth = snapshot.getSection<double>(AbstractionSnapshot::KthNeighborDistance);
+		nearestNeighbors.resize(vertexCount);
+		for(unsigned int i = 0; i < vertexCount; ++i) {
+			nearestNeighbors[i].assign(knnTargets + knnOffsets[i], knnTargets + knnOffsets[i+1]);
+		}
+		kthNeighborDistance.assign(kth, kth + vertexCount);
+		return true;
+	}
+
+	void saveSnapshot(const std::string &path, uint64_t key) const {
+		Timer timer("Abstraction Snapshot Save");
+		ompl::base::StateSpacePtr abstractSpace = globalParameters.globalAbstractAppBaseGeometric->getStateSpace();
+
+		AbstractionSnapshot::Contents contents;
+		contents.dimension = abstractSpace->getValueLocations().size();
+		contents.prmSize = prmSize;
+		for(const Vertex *vertex : vertices) {
+			for(unsigned int j = 0; j < contents.dimension; ++j) {
+				contents.states.push_back(*abstractSpace->getValueAddressAtIndex(vertex->state, j));
+			}
+		}
+
+		contents.edgeOffsets.assign(neighborOffsets.begin(), neighborOffsets.end());
+		contents.edgeTargets.assign(neighborIds.begin(), neighborIds.end());
+		contents.edgeStatuses.assign(edgeStatuses.begin(), edgeStatuses.end());
+
+		contents.neighborOffsets.push_back(0);
+		for(const auto &neighbors : nearestNeighbors) {
+			contents.neighborTargets.insert(contents.neighborTargets.end(), neighbors.begin(), neighbors.end());
+			contents.neighborOffsets.push_back(contents.neighborTargets.size());
+		}
+		contents.kthNeighborDistance = kthNeighborDistance;
+
+		if(!AbstractionSnapshot::write(path, key, contents)) {
+			OMPL_WARN("could not write abstraction snapshot %s", path.c_str());
+		}
+	}
+
 	boost::shared_ptr< ompl::NearestNeighbors<Vertex *> > nn;
 	unsigned int prmSize, numEdges;
 	double stateRadius, resizeFactor;
-};
\ No newline at end of file
+
+	std::vector<std::vector<unsigned int>> nearestNeighbors;
+	std::vector<double> kthNeighborDistance;
+
+	std::string snapshotDirectory;
+	AbstractionSnapshot::Hasher snapshotInputs;
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+/* Versioned binary snapshot of a built abstraction, so benchmark sweeps over the same environment don't
+regenerate the roadmap and recheck its edges on every run.
+
+A snapshot is named after a 64 bit FNV-1a hash of everything that decides the roadmap (the meshes as
+loaded, bounds, start and goal, the PRM parameters, the seed, every setting that changes which states and
+motions are valid, ...) and holds, after a fixed header:
+
+	states               double[vertexCount * dimension]   abstract state values of every vertex
+	edgeOffsets          uint32[vertexCount + 1]           CSR rows of the edge slots
+	edgeTargets          uint32[edgeCount]
+	edgeStatuses         uint8[edgeCount]                  Abstraction::Edge::CollisionCheckingStatus
+	neighborOffsets      uint32[vertexCount + 1]           CSR rows of the k nearest neighbors (for grow)
+	neighborTargets      uint32[neighborCount]
+	kthNeighborDistance  double[vertexCount]
+
+every section starting on an 8 byte boundary. Reading maps the file and hands out pointers into it, the
+caller copies what it needs. Files are written to a temporary name and renamed into place, so processes
+running the same instance side by side never see half a snapshot. Anything that doesn't match (magic,
+version, key, size) is treated as a miss and the abstraction is just built again.
+*/
+
+#include "../../structs/filemap.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class AbstractionSnapshot {
+public:
+	static const uint32_t Version = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t dimension;
+		uint64_t key;
+		uint32_t vertexCount;
+		uint32_t edgeCount;
+		uint32_t neighborCount;
+		uint32_t prmSize;
+	};
+
+	enum Section { States, EdgeOffsets, EdgeTargets, EdgeStatuses, NeighborOffsets, NeighborTargets, KthNeighborDistance, SectionCount };
+
+	/* what gets written, the reader hands back the same arrays as pointers into the mapping */
+	struct Contents {
+		uint32_t dimension = 0;
+		uint32_t prmSize = 0;
+		std::vector<double> states;
+		std::vector<uint32_t> edgeOffsets, edgeTargets;
+		std::vector<uint8_t> edgeStatuses;
+		std::vector<uint32_t> neighborOffsets, neighborTargets;
+		std::vector<double> kthNeighborDistance;
+	};
+
+	/* the settings that decide which states and motions are valid, edges checked under one of them can't be
+	   reused under another */
+	struct Validity {
+		double checkingResolution = 0;
+		double cacheResolution = 0;
+		double cacheRotationResolution = 0;
+		bool cacheConservative = true;
+		bool cacheInvalidCells = false;
+		bool continuousMotionValidation = false;
+		double distanceFieldVoxelSize = 0; //0 without a distance field
+		double distanceFieldCoreRadius = 0;
+	};
+
+	class Hasher {
+	public:
+		void add(const void *data, size_t size) {
+			const unsigned char *bytes = (const unsigned char *)data;
+			for(size_t i = 0; i < size; ++i) {
+				hash = (hash ^ bytes[i]) * 1099511628211ULL;
+			}
+		}
+
+		void add(const std::string &value) {
+			uint64_t size = value.size();
+			add(&size, sizeof(size));
+			add(value.data(), value.size());
+		}
+
+		void add(double value) {
+			add(&value, sizeof(value));
+		}
+
+		// every key with its value, or as missing when the instance doesn't set it
+		void add(const FileMap &params, const std::vector<std::string> &keys) {
+			for(const std::string &key : keys) {
+				add(key);
+				bool present = params.exists(key);
+				add(&present, sizeof(present));
+				if(present) add(params.stringVal(key));
+			}
+		}
+
+		void add(const Validity &validity) {
+			add(validity.checkingResolution);
+			add(validity.cacheResolution);
+			add(validity.cacheRotationResolution);
+			add(&validity.cacheConservative, sizeof(validity.cacheConservative));
+			add(&validity.cacheInvalidCells, sizeof(validity.cacheInvalidCells));
+			add(&validity.continuousMotionValidation, sizeof(validity.continuousMotionValidation));
+			add(validity.distanceFieldVoxelSize);
+			add(validity.distanceFieldCoreRadius);
+		}
+
+		uint64_t get() const {
+			return hash;
+		}
+
+	private:
+		uint64_t hash = 14695981039346656037ULL;
+	};
+
+	static std::string getPath(const std::string &directory, uint64_t key) {
+		char name[32];
+		snprintf(name, sizeof(name), "prm-%016llx.abs", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+
+	AbstractionSnapshot() {}
+
+	AbstractionSnapshot(const AbstractionSnapshot &) = delete;
+	AbstractionSnapshot &operator=(const AbstractionSnapshot &) = delete;
+
+	~AbstractionSnapshot() {
+		unmap();
+	}
+
+	/* false if there is no usable snapshot for key at path */
+	bool map(const std::string &path, uint64_t key) {
+		unmap();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0) return false;
+
+		struct stat info;
+		if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+			close(fd);
+			return false;
+		}
+
+		size = info.st_size;
+		data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(data == MAP_FAILED) {
+			data = NULL;
+			return false;
+		}
+
+		const Header &header = getHeader();
+		if(memcmp(header.magic, getMagic(), sizeof(header.magic)) != 0 || header.version != Version || header.key != key ||
+		   layout(header, offsets) != size) {
+			unmap();
+			return false;
+		}
+		return true;
+	}
+
+	const Header &getHeader() const {
+		return *(const Header *)data;
+	}
+
+	template <class T>
+	const T *getSection(Section section) const {
+		return (const T *)((const char *)data + offsets[section]);
+	}
+
+	static bool write(const std::string &path, uint64_t key, const Contents &contents) {
+		Header header;
+		memcpy(header.magic, getMagic(), sizeof(header.magic));
+		header.version = Version;
+		header.dimension = contents.dimension;
+		header.key = key;
+		header.vertexCount = contents.edgeOffsets.size() - 1;
+		header.edgeCount = contents.edgeTargets.size();
+		header.neighborCount = contents.neighborTargets.size();
+		header.prmSize = contents.prmSize;
+
+		size_t sectionOffsets[SectionCount];
+		size_t total = layout(header, sectionOffsets);
+		std::vector<char> buffer(total, 0);
+		memcpy(buffer.data(), &header, sizeof(header));
+
+		auto put = [&](Section section, const void *values, size_t bytes) {
+			if(bytes > 0) memcpy(buffer.data() + sectionOffsets[section], values, bytes);
+		};
+		put(States, contents.states.data(), contents.states.size() * sizeof(double));
+		put(EdgeOffsets, contents.edgeOffsets.data(), contents.edgeOffsets.size() * sizeof(uint32_t));
+		put(EdgeTargets, contents.edgeTargets.data(), contents.edgeTargets.size() * sizeof(uint32_t));
+		put(EdgeStatuses, contents.edgeStatuses.data(), contents.edgeStatuses.size());
+		put(NeighborOffsets, contents.neighborOffsets.data(), contents.neighborOffsets.size() * sizeof(uint32_t));
+		put(NeighborTargets, contents.neighborTargets.data(), contents.neighborTargets.size() * sizeof(uint32_t));
+		put(KthNeighborDistance, contents.kthNeighborDistance.data(), contents.kthNeighborDistance.size() * sizeof(double));
+
+		std::string temporary = path + ".tmp" + std::to_string(getpid());
+		FILE *file = fopen(temporary.c_str(), "wb");
+		if(file == NULL) return false;
+		bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+		written = fclose(file) == 0 && written;
+		if(!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	static const char *getMagic() {
+		return "BEASTABS";
+	}
+
+	static size_t align(size_t offset) {
+		return (offset + 7) & ~(size_t)7;
+	}
+
+	// fills in where every section starts and returns the file size the header implies
+	static size_t layout(const Header &header, size_t *sectionOffsets) {
+		size_t sizes[SectionCount] = {
+			(size_t)header.vertexCount * header.dimension * sizeof(double),
+			((size_t)header.vertexCount + 1) * sizeof(uint32_t),
+			(size_t)header.edgeCount * sizeof(uint32_t),
+			(size_t)header.edgeCount,
+			((size_t)header.vertexCount + 1) * sizeof(uint32_t),
+			(size_t)header.neighborCount * sizeof(uint32_t),
+			(size_t)header.vertexCount * sizeof(double),
+		};
+		size_t offset = align(sizeof(Header));
+		for(unsigned int i = 0; i < SectionCount; ++i) {
+			sectionOffsets[i] = offset;
+			offset = align(offset + sizes[i]);
+		}
+		return offset;
+	}
+
+	void unmap() {
+		if(data != NULL) {
+			munmap(data, size);
+			data = NULL;
+		}
+	}
+
+	void *data = NULL;
+	size_t size = 0;
+	size_t offsets[SectionCount];
+};
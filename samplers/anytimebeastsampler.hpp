@@ -15,6 +15,11 @@ public:
 					BeastSampler_dstar(base, start, goal, gsr, params), optimizationObjective(optimizationObjective), goalPtr(goal) {
 
 		probabilityThreshold = params.exists("ProbabilityThreshold") ? params.doubleVal("ProbabilityThreshold") : 0;
+
+		//the per region g cost distributions can not follow states into new regions
+		if(params.exists("AbstractionRefinementInterval") && params.integerVal("AbstractionRefinementInterval") > 0) {
+			throw ompl::Exception("AnytimeBeastSampler", "AbstractionRefinementInterval must be 0, the anytime sampler can not refine its abstraction");
+		}
 	}
 
 	~AnytimeBeastSampler() {}
@@ -23,21 +28,13 @@ public:
 		BeastSamplerBase::initialize();
 
 		unsigned int abstractionSize = abstraction->getAbstractionSize();
-		vertices.reserve(abstractionSize);
 
 		gCostDistributions.resize(abstractionSize);
 
 		ompl::base::ScopedState<> startStateSS(globalParameters.globalAppBaseControl->getGeometricComponentStateSpace());
 		ompl::base::ScopedState<> endStateSS(globalParameters.globalAppBaseControl->getGeometricComponentStateSpace());
 
-		for(unsigned int i = 0; i < abstractionSize; ++i) {
-			vertices.emplace_back(i);
-			auto neighbors = abstraction->getNeighboringCells(i);
-			for(auto n : neighbors) {
-				getEdge(i, n);
-				getEdge(n, i);
-			}
-		}
+		allocateSearchStorage();
 
 		vertices[goalID].rhs = 0;
 		vertices[goalID].key = calculateKey(goalID);
@@ -46,17 +43,13 @@ public:
 		{
 			Timer t("Shortest Path Computation");
 			computeShortestPath();
-			dijkstra(startID, [](const Vertex* v){ return v->initG; }, [](Vertex* v, double val){ v->initG = val; });
-			dijkstra(goalID,  [](const Vertex* v){ return v->initH; }, [](Vertex* v, double val){ v->initH = val; });
+			dijkstra(startID, [this](const Vertex* v){ return regions[v->id].initG; }, [this](Vertex* v, double val){ regions[v->id].initG = val; });
+			dijkstra(goalID,  [this](const Vertex* v){ return regions[v->id].initH; }, [this](Vertex* v, double val){ regions[v->id].initH = val; });
 		}
 
-		for(auto eset : edges) {
-			for(auto e : eset.second) {
-				e.second->initialEffort = e.second->effort;
-			}
-		}
+		recordInitialEfforts();
 
-		vertices[startID].addUnsortedState(startState);
+		regions[startID].addUnsortedState(startState);
 
 
 		addOutgoingEdgesToOpen(startID);
@@ -67,7 +60,7 @@ public:
 
 			if(targetSuccess) {
 				if(!addedGoalEdge && targetEdge->endID == goalID) {
-					Edge *goalEdge = new Edge(goalID, goalID);
+					Edge *goalEdge = getGoalEdge();
 					goalEdge->updateEdgeStatusKnowledge(Abstraction::Edge::VALID);
 					goalEdge->effort = 1;
 					focal.insert(goalEdge);
@@ -129,7 +122,7 @@ public:
 
 				//according to the docs, we shouldn't need to, but for the safety of the iterator, reset it :-(
 				shouldReset = true;
-			} else if(vertices[targetEdge->startID].states.size() > 0) {
+			} else if(regions[targetEdge->startID].states.size() > 0) {
 				auto expand = shouldExpand(targetEdge);
 				bool withinProbabilityBound = expand.second >= probabilityThreshold;
 				allOutsideProbabilityBound |= !withinProbabilityBound;
@@ -167,21 +160,22 @@ public:
 		ompl::base::ScopedState<> incomingState(si_->getStateSpace());
 		incomingState = state;
 		unsigned int cellId = abstraction->mapToAbstractRegion(incomingState);
-		vertices[cellId].removeUnsortedState(state);
+		regions[cellId].removeUnsortedState(state);
 
 		if(firstTargetSuccessState == state) {
 			targetSuccess = false;
 		}
 
-		if(vertices[cellId].states.size() == 0) {
-			for(auto e : reverseEdges[cellId]) {
-				e.second->interior = false;
+		if(regions[cellId].states.size() == 0) {
+			auto neighbors = abstraction->getNeighboringCells(cellId);
+			for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+				getReverseEdgeBySlot(it.getSlot())->interior = false;
 			}
 		}
 
 		gCostDistributions[cellId].removeDataPoint(g);
 		if(cellId != startID) {
-			errorDistribution.removeDataPoint(getError(vertices[cellId].initG, g));
+			errorDistribution.removeDataPoint(getError(regions[cellId].initG, g));
 		}
 	}
 
@@ -205,10 +199,10 @@ public:
 		gCostDistributions[endCellId].addDataPoint(endG);
 		
 		if(endCellId != startID) {
-			errorDistribution.addDataPoint(getError(vertices[endCellId].initG, endG));
+			errorDistribution.addDataPoint(getError(regions[endCellId].initG, endG));
 		}
 
-		vertices[endCellId].addUnsortedState(end);
+		regions[endCellId].addUnsortedState(end);
 
 		//if the planner chose the goal region first be careful not to dereference a null pointer
 		if(targetEdge != NULL && endCellId == targetEdge->endID) {
@@ -236,23 +230,24 @@ protected:
 		focal.clear();
 
 		for(unsigned int i = 0; i < abstraction->getAbstractionSize(); ++i) {
-			vertices[i].clearStates();
-			auto neighbors = abstraction->getNeighboringCells(i);
-			for(auto n : neighbors) {
-				getEdge(i, n)->interior = false;
-				getEdge(n, i)->interior = false;;
-			}
+			regions[i].clearStates();
+		}
+		for(auto &e : edgeSlab) {
+			e.interior = false;
 		}
 
-		vertices[startID].addUnsortedState(startState);
+		regions[startID].addUnsortedState(startState);
 
 		addOutgoingEdgesToOpen(startID);
 	}
 
 	virtual void addOutgoingEdgesToOpen(unsigned int source) {
+		abstraction->prefetchOutgoingEdges(source);
+
 		auto neighbors = abstraction->getNeighboringCells(source);
-		for(auto n : neighbors) {
-			Edge *e = getEdge(source, n);
+		for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+			unsigned int n = *it;
+			Edge *e = getEdgeBySlot(it.getSlot());
 			if(std::isinf(vertices[n].g)) {
 				vertexHasInfiniteValue(n);
 			}
@@ -282,7 +277,7 @@ protected:
 			double r = randomNumbers.uniform01();
 // TODO:
 // Should this be gCostDistributions[e->startID] + ?e->cost? + (errorDistribution * vertices[e->endID].initH);
-			GaussianDistribution f = gCostDistributions[e->endID] + (errorDistribution * vertices[e->endID].initH);
+			GaussianDistribution f = gCostDistributions[e->endID] + (errorDistribution * regions[e->endID].initH);
 
 			double val = f.getCDF(incumbentCost);
 			return std::make_pair(r <= val, val);
@@ -405,7 +400,7 @@ protected:
 			for(unsigned int kidIndex : kids) {
 				if(closed.find(kidIndex) != closed.end()) continue;
 
-				double newValue = current->v->initG + abstraction->abstractDistanceFunctionByIndex(current->getId(), kidIndex);
+				double newValue = regions[current->getId()].initG + abstraction->abstractDistanceFunctionByIndex(current->getId(), kidIndex);
 				VertexWrapper *kid = &wrappers[kidIndex];
 
 				//this will update the value of the vertex if needed
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "beastsamplerbase.hpp"
+#include "../structs/monotoneradixheap.hpp"
 
 namespace ompl {
 
@@ -8,7 +9,7 @@ namespace base {
 
 class BeastSampler_dijkstra : public ompl::base::BeastSamplerBase {
 	struct VertexWrapper {
-		VertexWrapper(Vertex *vertex) : vertex(vertex), currentParent(NULL) {}
+		VertexWrapper(Vertex *vertex) : vertex(vertex), heapIndex(std::numeric_limits<unsigned int>::max()), currentParent(NULL) {}
 
 		virtual ~VertexWrapper() {
 			for(auto p : parents) {
@@ -29,6 +30,13 @@ class BeastSampler_dijkstra : public ompl::base::BeastSamplerBase {
 		static bool pred(const VertexWrapper *a, const VertexWrapper *b) {
 			return a->vertex->g < b->vertex->g;
 		}
+		static double getHeapKey(const VertexWrapper *r) {
+			return r->vertex->g;
+		}
+		static void traceKey(const VertexWrapper *r, double key[3]) {
+			key[0] = r->vertex->g;
+			key[1] = key[2] = 0;
+		}
 		static unsigned int getHeapIndex(const VertexWrapper *r) {
 			return r->heapIndex;
 		}
@@ -105,62 +113,81 @@ public:
 	virtual void initialize() {
 		BeastSamplerBase::initialize();
 
-		unsigned int abstractionSize = abstraction->getAbstractionSize();
-		vertices.reserve(abstractionSize);
-
-		for(unsigned int i = 0; i < abstractionSize; ++i) {
-			vertices.emplace_back(i);
-		}
+		allocateSearchStorage();
 
 		{
 			Timer t("dijkstra");
 			dijkstra(goalID);
 		}
 
-		for(auto eset : edges) {
-			for(auto e : eset.second) {
-				e.second->initialEffort = e.second->effort;
-			}
-		}
+		recordInitialEfforts();
 
-		vertices[startID].addState(startState);
+		regions[startID].addState(startState);
 		addOutgoingEdgesToOpen(startID);
 	}
 
 	virtual bool sample(ompl::base::State *from, ompl::base::State *to) {
 		if(targetEdge != NULL) { //only will fail the first time through
+			applyTargetOutcome();
+		}
 
-			if(targetSuccess) {
-				static bool addedGoalEdge = false;
-				if(!addedGoalEdge && targetEdge->endID == goalID) {
-					Edge *goalEdge = new Edge(goalID, goalID);
-					goalEdge->updateEdgeStatusKnowledge(Abstraction::Edge::VALID);
-					goalEdge->effort = 1;
-					open.push(goalEdge);
-					addedGoalEdge = true;
-				}
+		selectTarget(from, to);
+		return true;
+	}
 
-				if(targetEdge->interior) {
-					updateSuccesfulInteriorEdgePropagation(targetEdge);
-					updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
-				} else {
-					//edge has become interior
-					targetEdge->interior = true;
-					targetEdge->succesfulPropagation();
-					updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
-				}
+	virtual bool sample(ompl::base::State *) {
+		throw ompl::Exception("NewSampler::sample", "not implemented");
+		return false;
+	}
+
+	virtual bool sampleNear(ompl::base::State *, const ompl::base::State *, const double) {
+		throw ompl::Exception("NewSampler::sampleNear", "not implemented");
+		return false;
+	}
+
+	void reached(ompl::base::State *state) {
+		//if the planner chose the goal region first be careful not to dereference a null pointer
+		if(addReachedState(state, targetEdge)) {
+			//this region will be added to open when sample is called again
+			targetSuccess = true;
+		}
+	}
+
+
+protected:
+	void applyTargetOutcome() {
+		if(targetSuccess) {
+			static bool addedGoalEdge = false;
+			if(!addedGoalEdge && targetEdge->endID == goalID) {
+				Edge *goalEdge = getGoalEdge();
+				goalEdge->updateEdgeStatusKnowledge(Abstraction::Edge::VALID);
+				goalEdge->effort = 1;
+				open.push(goalEdge);
+				addedGoalEdge = true;
+			}
+
+			if(targetEdge->interior) {
+				updateSuccesfulInteriorEdgePropagation(targetEdge);
+				updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
 			} else {
-				targetEdge->failurePropagation();
-				updateEdgeEffort(targetEdge, targetEdge->getEstimatedRequiredSamples() + vertices[targetEdge->endID].g);
+				//edge has become interior
+				targetEdge->interior = true;
+				targetEdge->succesfulPropagation();
+				updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
 			}
+		} else {
+			targetEdge->failurePropagation();
+			updateEdgeEffort(targetEdge, targetEdge->getEstimatedRequiredSamples() + vertices[targetEdge->endID].g);
+		}
 
-			dijkstra(goalID);
+		dijkstra(goalID);
 
-			if(targetSuccess) {
-				addOutgoingEdgesToOpen(targetEdge->endID);
-			}
+		if(targetSuccess) {
+			addOutgoingEdgesToOpen(targetEdge->endID);
 		}
+	}
 
+	void selectTarget(ompl::base::State *from, ompl::base::State *to) {
 		bool getNextEdge = true;
 		while(getNextEdge) {
 			assert(!open.isEmpty());
@@ -184,47 +211,18 @@ public:
 		targetSuccess = false;
 
 		if(targetEdge->startID == targetEdge->endID && targetEdge->startID == goalID) {
-			si_->copyState(from, vertices[targetEdge->startID].sampleState());
+			si_->copyState(from, regions[targetEdge->startID].sampleState());
 			goalSampler->sampleGoal(to);
 		} else {
-			si_->copyState(from, vertices[targetEdge->startID].sampleState());
+			si_->copyState(from, regions[targetEdge->startID].sampleState());
 			ompl::base::ScopedState<> vertexState(globalParameters.globalAppBaseControl->getGeometricComponentStateSpace());
 			vertexState = abstraction->getState(targetEdge->endID);
 
 			ompl::base::ScopedState<> fullState = globalParameters.globalAppBaseControl->getFullStateFromGeometricComponent(vertexState);
 			fullStateSampler->sampleUniformNear(to, fullState.get(), stateRadius);
 		}
-		return true;
-	}
-
-	virtual bool sample(ompl::base::State *) {
-		throw ompl::Exception("NewSampler::sample", "not implemented");
-		return false;
-	}
-
-	virtual bool sampleNear(ompl::base::State *, const ompl::base::State *, const double) {
-		throw ompl::Exception("NewSampler::sampleNear", "not implemented");
-		return false;
-	}
-
-	void reached(ompl::base::State *state) {
-		ompl::base::ScopedState<> incomingState(si_->getStateSpace());
-		incomingState = state;
-		unsigned int newCellId = abstraction->mapToAbstractRegion(incomingState);
-
-		vertices[newCellId].addState(state);
-
-		//if the planner chose the goal region first be careful not to dereference a null pointer
-		if(targetEdge != NULL && newCellId == targetEdge->endID) {
-			//this region will be added to open when sample is called again
-			targetSuccess = true;
-		} else  {
-			addOutgoingEdgesToOpen(newCellId);
-		}
 	}
 
-
-protected:
 	void vertexMayBeInconsistent(unsigned int id) {
 		dijkstra(goalID);
 	}
@@ -233,7 +231,12 @@ protected:
 		dijkstra(goalID);
 	}
 
+	void repairShortestPaths(const std::vector<unsigned int> &touched) {
+		dijkstra(goalID);
+	}
+
 	void dijkstra(unsigned int startID) {
+		PHASE_SCOPE(SearchRepair);
 		std::vector<VertexWrapper *> wrappers;
 		wrappers.reserve(vertices.size());
 		for(unsigned int i = 0; i < vertices.size(); ++i) {
@@ -244,7 +247,18 @@ protected:
 	}
 
 	void dijkstra(VertexWrapper *start, const std::vector<VertexWrapper *> &wrappers) {
-		InPlaceBinaryHeap<VertexWrapper, VertexWrapper> open;
+		//g only grows along the search (relaxed kids get more than the popped value and so does a vertex
+		//falling back to a worse parent), so the DIJKSTRA_RADIX_HEAP option can swap in the radix heap
+#ifdef DIJKSTRA_RADIX_HEAP
+		typedef MonotoneRadixHeap<VertexWrapper, VertexWrapper> Heap;
+#else
+		typedef InPlaceBinaryHeap<VertexWrapper, VertexWrapper> Heap;
+#endif
+#ifdef HEAP_TRACE
+		TracedHeap<Heap, VertexWrapper, VertexWrapper> open;
+#else
+		Heap open;
+#endif
 		std::unordered_set<unsigned int> closed;
 		start->setVal(0);
 		open.push(start);
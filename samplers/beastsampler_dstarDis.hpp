@@ -16,17 +16,7 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
     virtual void initialize() {
         BeastSamplerBase::initialize();
 
-        unsigned int abstractionSize = abstraction->getAbstractionSize();
-        vertices.reserve(abstractionSize);
-
-        for(unsigned int i = 0; i < abstractionSize; ++i) {
-            vertices.emplace_back(i);
-            auto neighbors = abstraction->getNeighboringCells(i);
-            for(auto n : neighbors) {
-                getEdge(i, n);
-                getEdge(n, i);
-            }
-        }
+        allocateSearchStorage();
 
         vertices[goalID].rhs = 0;
         vertices[goalID].key = calculateKey(goalID);
@@ -37,13 +27,9 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
             computeShortestPath();
         }
 
-        for(auto eset : edges) {
-            for(auto e : eset.second) {
-                e.second->initialEffort = e.second->effort;
-            }
-        }
+        recordInitialEfforts();
 
-        vertices[startID].addState(startState);
+        regions[startID].addState(startState);
         addOutgoingEdgesToOpen(startID);
     }
 
@@ -60,38 +46,66 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
 #endif
 
         if(targetEdge != NULL) { //only will fail the first time through
+            applyTargetOutcome();
+        }
 
-            if(targetSuccess) {
-                if(!addedGoalEdge && targetEdge->endID == goalID) {
-                    Edge *goalEdge = new Edge(goalID, goalID);
-                    goalEdge->updateEdgeStatusKnowledge(Abstraction::Edge::VALID);
-                    goalEdge->effort = 1;
-                    open.push(goalEdge);
-                    addedGoalEdge = true;
-                }
+        selectTarget(from, to);
+        return true;
+    }
 
-                if(targetEdge->interior) {
-                    updateSuccesfulInteriorEdgePropagation(targetEdge);
-                    updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
-                } else {
-                    //edge has become interior
-                    targetEdge->interior = true;
-                    targetEdge->succesfulPropagation();
-                    updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
-                }
+    virtual bool sample(ompl::base::State *) {
+        throw ompl::Exception("NewSampler::sample", "not implemented");
+        return false;
+    }
+
+    virtual bool sampleNear(ompl::base::State *, const ompl::base::State *, const double) {
+        throw ompl::Exception("NewSampler::sampleNear", "not implemented");
+        return false;
+    }
+
+    void reached(ompl::base::State *state) {
+        //if the planner chose the goal region first be careful not to dereference a null pointer
+        if(addReachedState(state, targetEdge)) {
+            //this region will be added to open when sample is called again
+            targetSuccess = true;
+        }
+    }
+
+
+  protected:
+    void applyTargetOutcome() {
+        if(targetSuccess) {
+            if(!addedGoalEdge && targetEdge->endID == goalID) {
+                Edge *goalEdge = getGoalEdge();
+                goalEdge->updateEdgeStatusKnowledge(Abstraction::Edge::VALID);
+                goalEdge->effort = 1;
+                open.push(goalEdge);
+                addedGoalEdge = true;
+            }
+
+            if(targetEdge->interior) {
+                updateSuccesfulInteriorEdgePropagation(targetEdge);
+                updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
             } else {
-                targetEdge->failurePropagation();
-                updateEdgeEffort(targetEdge, targetEdge->getEstimatedRequiredSamples() + vertices[targetEdge->endID].g);
+                //edge has become interior
+                targetEdge->interior = true;
+                targetEdge->succesfulPropagation();
+                updateEdgeEffort(targetEdge, getInteriorEdgeEffort(targetEdge));
             }
+        } else {
+            targetEdge->failurePropagation();
+            updateEdgeEffort(targetEdge, targetEdge->getEstimatedRequiredSamples() + vertices[targetEdge->endID].g);
+        }
 
-            updateVertex(targetEdge->startID);
-            computeShortestPath();
+        updateVertex(targetEdge->startID);
+        computeShortestPath();
 
-            if(targetSuccess) {
-                addOutgoingEdgesToOpen(targetEdge->endID);
-            }
+        if(targetSuccess) {
+            addOutgoingEdgesToOpen(targetEdge->endID);
         }
+    }
 
+    void selectTarget(ompl::base::State *from, ompl::base::State *to) {
         bool getNextEdge = true;
         while(getNextEdge) {
             assert(!open.isEmpty());
@@ -117,7 +131,7 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
 
         if(targetEdge->startID == targetEdge->endID && targetEdge->startID == goalID) {
             goalSampler->sampleGoal(to);
-            si_->copyState(from, vertices[targetEdge->startID].sampleStateByDis(si_, to));
+            si_->copyState(from, regions[targetEdge->startID].sampleStateByDis(si_, to));
 			
         } else {
             ompl::base::ScopedState<> vertexState(globalParameters.globalAppBaseControl->getGeometricComponentStateSpace());
@@ -130,39 +144,10 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
                 fullStateSampler->sampleUniformNear(to, fullState.get(), stateRadius);
                 // guty: add a sampler for linkage here
             }
-            si_->copyState(from, vertices[targetEdge->startID].sampleStateByDis(si_, to));
+            si_->copyState(from, regions[targetEdge->startID].sampleStateByDis(si_, to));
         }
-        return true;
-    }
-
-    virtual bool sample(ompl::base::State *) {
-        throw ompl::Exception("NewSampler::sample", "not implemented");
-        return false;
-    }
-
-    virtual bool sampleNear(ompl::base::State *, const ompl::base::State *, const double) {
-        throw ompl::Exception("NewSampler::sampleNear", "not implemented");
-        return false;
     }
 
-    void reached(ompl::base::State *state) {
-        ompl::base::ScopedState<> incomingState(si_->getStateSpace());
-        incomingState = state;
-        unsigned int newCellId = abstraction->mapToAbstractRegion(incomingState);
-
-        vertices[newCellId].addState(state);
-
-        //if the planner chose the goal region first be careful not to dereference a null pointer
-        if(targetEdge != NULL && newCellId == targetEdge->endID) {
-            //this region will be added to open when sample is called again
-            targetSuccess = true;
-        } else  {
-            addOutgoingEdgesToOpen(newCellId);
-        }
-    }
-
-
-  protected:
     void vertexMayBeInconsistent(unsigned int id) {
         updateVertex(id);
     }
@@ -171,6 +156,13 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
         computeShortestPath();
     }
 
+    void repairShortestPaths(const std::vector<unsigned int> &touched) {
+        for(auto id : touched) {
+            updateVertex(id);
+        }
+        computeShortestPath();
+    }
+
 
     Key calculateKey(unsigned int id) {
         Vertex &s = vertices[id];
@@ -185,9 +177,9 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
         if(s.id != goalID) {
             double minValue = std::numeric_limits<double>::infinity();
             auto neighbors = abstraction->getNeighboringCells(id);
-            for(auto n : neighbors) {
-                Edge *e = getEdge(id, n);
-                double value = vertices[n].g + e->getEstimatedRequiredSamples();
+            for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+                Edge *e = getEdgeBySlot(it.getSlot());
+                double value = vertices[*it].g + e->getEstimatedRequiredSamples();
                 if(value < minValue) {
                     minValue = value;
                 }
@@ -206,6 +198,7 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
     }
 
     void computeShortestPath() {
+        PHASE_SCOPE(SearchRepair);
         while(!U.isEmpty()) {
             Vertex &u = vertices[U.pop()->id];
             Key k_old = u.key;
@@ -217,28 +210,32 @@ class BeastSampler_dstarDis : public ompl::base::BeastSamplerBase {
             }
             else if(u.g > u.rhs) {
                 u.g = u.rhs;
-                for(auto e : reverseEdges[u.id]) {
-                    if(e.second->interior) {
-                        updateEdgeEffort(e.second, getInteriorEdgeEffort(e.second), false);
+                auto incoming = abstraction->getNeighboringCells(u.id);
+                for(auto it = incoming.begin(); it != incoming.end(); ++it) {
+                    Edge *e = getReverseEdgeBySlot(it.getSlot());
+                    if(e->interior) {
+                        updateEdgeEffort(e, getInteriorEdgeEffort(e), false);
                     }
                     else {
-                        updateEdgeEffort(e.second, u.g + e.second->getEstimatedRequiredSamples(), false);
+                        updateEdgeEffort(e, u.g + e->getEstimatedRequiredSamples(), false);
                     }
                 }
 
-                auto neighbors = getNeighboringCells(u.id);
+                auto neighbors = abstraction->getNeighboringCells(u.id);
                 for(auto n : neighbors) {
                     updateVertex(n);
                 }
             } else {
                 u.g = std::numeric_limits<double>::infinity();
 
-                for(auto e : reverseEdges[u.id]) {
-                    if(e.second->interior) {
-                        updateEdgeEffort(e.second, getInteriorEdgeEffort(e.second), false);
+                auto incoming = abstraction->getNeighboringCells(u.id);
+                for(auto it = incoming.begin(); it != incoming.end(); ++it) {
+                    Edge *e = getReverseEdgeBySlot(it.getSlot());
+                    if(e->interior) {
+                        updateEdgeEffort(e, getInteriorEdgeEffort(e), false);
                     }
                     else {
-                        updateEdgeEffort(e.second, u.g, false);
+                        updateEdgeEffort(e, u.g, false);
                     }
                 }
 
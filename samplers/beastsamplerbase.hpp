@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../structs/inplacebinaryheap.hpp"
+#include "../structs/inplacedaryheap.hpp"
+#include "../structs/heaptrace.hpp"
+#include "../structs/leastselectedset.hpp"
 #include "abstractionbasedsampler.hpp"
 
 namespace ompl {
@@ -10,6 +13,19 @@ namespace base {
 class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
 	
   protected:
+    /* The heap behind U and open. Vertex and Edge are Ops for InPlaceBinaryHeap, InPlaceDaryHeap and
+       TracedHeap; the binary heap is the default, the BEAST_DARY_HEAP option picks the 4-ary one. */
+#ifdef BEAST_DARY_HEAP
+    template <class T> using SearchHeap = InPlaceDaryHeap<T, T, 4>;
+#else
+    template <class T> using SearchHeap = InPlaceBinaryHeap<T, T>;
+#endif
+#ifdef HEAP_TRACE
+    template <class T> using SearchQueue = TracedHeap<SearchHeap<T>, T, T>;
+#else
+    template <class T> using SearchQueue = SearchHeap<T>;
+#endif
+
     struct Key {
         double first, second;
         bool operator<(const Key& k) const {
@@ -19,12 +35,23 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
         }
     };
 
+    /* The search values of one abstract region. These are what the D* loop reads over and over, so they sit
+       densely in vertices and everything else about a region lives in regions. */
     struct Vertex {
         Vertex(unsigned int id) : id(id) {}
 
         static bool pred(const Vertex *a, const Vertex *b) {
             return a->key < b->key;
         }
+        typedef Key HeapKey;
+        static const Key &getHeapKey(const Vertex *r) {
+            return r->key;
+        }
+        static void traceKey(const Vertex *r, double key[3]) {
+            key[0] = r->key.first;
+            key[1] = r->key.second;
+            key[2] = 0;
+        }
         static unsigned int getHeapIndex(const Vertex *r) {
             return r->heapIndex;
         }
@@ -32,52 +59,34 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
             r->heapIndex = i;
         }
 
-        struct StateWrapper {
-            StateWrapper(ompl::base::State *state) : state(state) {}
-            bool operator<(const StateWrapper &w) const { return selected < w.selected; }
+        Key key;
+        double g = std::numeric_limits<double>::infinity();
+        double rhs = std::numeric_limits<double>::infinity();
+        unsigned int heapIndex = std::numeric_limits<unsigned int>::max();
+        unsigned int id;
+    };
 
-            ompl::base::State *state;
-            unsigned int selected = 0;
-        };
+    /* The tree states in one abstract region (LeastSelectedSet). Like the max heap they used to be kept in,
+       the most selected state is handed out first; BeastLeastSelectedStates hands out the least selected
+       one instead, and sampleStateByDis then only looks at the least selected states. */
+    struct Region {
+        static bool leastSelectedFirst;
 
         void addState(ompl::base::State *state) {
-            states.emplace_back(state);
-            std::push_heap(states.begin(), states.end());
+            states.add(state);
         }
 
         void removeState(const ompl::base::State *state) {
-            bool found = false;
-            for(unsigned int i = 0; i < states.size(); i++) {
-                if(states[i].state == state) {
-                    states[i] = states.back();
-                    found = true;
-                    break;
-                }
-            }
-
-            if(found) {
-                states.pop_back();
-                std::make_heap(states.begin(), states.end());
-            }
+            states.remove(state);
         }
 
+        // the anytime samplers don't look at selection counts, their states go in the same set
         void addUnsortedState(ompl::base::State *state) {
-            states.emplace_back(state);
+            states.add(state);
         }
 
         void removeUnsortedState(const ompl::base::State *state) {
-            bool found = false;
-            for(unsigned int i = 0; i < states.size(); i++) {
-                if(states[i].state == state) {
-                    states[i] = states.back();
-                    found = true;
-                    break;
-                }
-            }
-
-            if(found) {
-                states.pop_back();
-            }
+            states.remove(state);
         }
 
         void clearStates() {
@@ -85,52 +94,42 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
         }
 
         ompl::base::State* sampleState() {
-            auto state = states.front();
-            std::pop_heap(states.begin(), states.end());
-            states.pop_back();
-			
-            state.selected++;
-
-            states.emplace_back(state);
-            std::push_heap(states.begin(), states.end());
-			
-            return state.state;
+            return leastSelectedFirst ? states.selectLeast() : states.selectMost();
         }
 
         // add by tianyi, Aug / 8 / 2017
+        // the state closest to targetState, among the least selected ones with leastSelectedFirst
         ompl::base::State* sampleStateByDis(const ompl::base::SpaceInformation *si_,
                                        ompl::base::State* targetState) {
             double bestDis = std::numeric_limits<double>::infinity();
-            ompl::base::State* ret;
-            StateWrapper * bestState;
-            int leastSelectedNum = states.front().selected;
-            for(auto s: states){
-                // make sure we select the least selected state,
-                // and only use the distance to break the tie.  
-                if(s.selected > leastSelectedNum) continue;
-                double curDis = si_->distance(s.state, targetState);
-                if(bestDis > curDis){
-                    bestDis = curDis;
-                    ret = s.state;
-                    bestState = &s;
+            if(leastSelectedFirst) {
+                const auto &least = states.leastSelected();
+                auto best = least.front();
+                for(auto handle : least) {
+                    double curDis = si_->distance(states.get(handle), targetState);
+                    if(bestDis > curDis) {
+                        bestDis = curDis;
+                        best = handle;
+                    }
                 }
+                return states.select(best);
             }
-            bestState->selected++;
-            return ret;
+
+            ompl::base::State *best = NULL;
+            states.forEach([&](ompl::base::State *state, unsigned int) {
+                double curDis = si_->distance(state, targetState);
+                if(bestDis > curDis) {
+                    bestDis = curDis;
+                    best = state;
+                }
+            });
+            return states.select(states.getHandle(best));
         }
 
-        std::vector<StateWrapper> states;
-	
-
-        unsigned int id;
-        Key key;
+        LeastSelectedSet<ompl::base::State> states;
 
         double initG = std::numeric_limits<double>::infinity();
         double initH = std::numeric_limits<double>::infinity();
-
-        unsigned int heapIndex = std::numeric_limits<unsigned int>::max();
-        double g = std::numeric_limits<double>::infinity();
-        double rhs = std::numeric_limits<double>::infinity();
     };
 
     struct Edge {
@@ -151,6 +150,30 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
             }
             return false;
         }
+        // pred's order as a value the heap can keep next to the pointer
+        struct HeapKey {
+            double effort;
+            unsigned int endID, startID;
+
+            bool operator<(const HeapKey &k) const {
+                if(effort != k.effort) {
+                    return effort < k.effort;
+                }
+                if(endID != k.endID) {
+                    return endID < k.endID;
+                }
+                return startID < k.startID;
+            }
+        };
+        static HeapKey getHeapKey(const Edge *r) {
+            HeapKey key = {r->effort, r->endID, r->startID};
+            return key;
+        }
+        static void traceKey(const Edge *r, double key[3]) {
+            key[0] = r->effort;
+            key[1] = r->endID;
+            key[2] = r->startID;
+        }
         static unsigned int getHeapIndex(const Edge *r) {
             return r->heapIndex;
         }
@@ -233,6 +256,8 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
 
         Edge::invalidEdgeDistributionAlpha = params.doubleVal("InvalidEdgeDistributionAlpha");
         Edge::invalidEdgeDistributionBeta = params.doubleVal("InvalidEdgeDistributionBeta");
+
+        Region::leastSelectedFirst = params.exists("BeastLeastSelectedStates") && params.boolVal("BeastLeastSelectedStates");
     }
 
     virtual ~BeastSamplerBase() {}
@@ -286,29 +311,31 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
         double min = std::numeric_limits<double>::infinity();
         double max = -std::numeric_limits<double>::infinity();
 
-        for(auto eset : edges) {
-            for(auto e : eset.second) {
-                double val = whichValue == 0 ? e.second->effort : e.second->getEstimatedRequiredSamples();
+        for(unsigned int slot = 0; slot < reverseSlots.size(); ++slot) {
+            const Edge &e = edgeSlab[slot];
+            if(e.startID == Abstraction::NoEdge) continue;
 
-                if(std::isinf(val)) continue;
-                if(val < min) min = val;
-                if(val > max) max = val;
-            }
+            double val = whichValue == 0 ? e.effort : e.getEstimatedRequiredSamples();
+
+            if(std::isinf(val)) continue;
+            if(val < min) min = val;
+            if(val > max) max = val;
         }
 
-        for(auto eset : edges) {
-            for(auto e : eset.second) {
-                double val = whichValue == 0 ? e.second->effort : e.second->getEstimatedRequiredSamples();
+        for(unsigned int slot = 0; slot < reverseSlots.size(); ++slot) {
+            const Edge &e = edgeSlab[slot];
+            if(e.startID == Abstraction::NoEdge) continue;
 
-                if(std::isinf(val)) continue;
+            double val = whichValue == 0 ? e.effort : e.getEstimatedRequiredSamples();
 
-                auto a = abstraction->getState(e.second->startID)->as<ompl::base::SE3StateSpace::StateType>();
-                auto b = abstraction->getState(e.second->endID)->as<ompl::base::SE3StateSpace::StateType>();
+            if(std::isinf(val)) continue;
 
-                auto color = getColor(min, max, val);
+            auto a = abstraction->getState(e.startID)->as<ompl::base::SE3StateSpace::StateType>();
+            auto b = abstraction->getState(e.endID)->as<ompl::base::SE3StateSpace::StateType>();
 
-                fprintf(f, "%g %g %g %g %g %g %g %g %g\n", a->getX(), a->getY(), a->getZ(), b->getX(), b->getY(), b->getZ(), color[0], color[1], color[2]);
-            }
+            auto color = getColor(min, max, val);
+
+            fprintf(f, "%g %g %g %g %g %g %g %g %g\n", a->getX(), a->getY(), a->getZ(), b->getX(), b->getY(), b->getZ(), color[0], color[1], color[2]);
         }
 
         fclose(f);
@@ -322,30 +349,32 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
         double min = std::numeric_limits<double>::infinity();
         double max = -std::numeric_limits<double>::infinity();
 
-        for(auto eset : edges) {
-            for(auto e : eset.second) {
-                double val = e.second->initialEffort - e.second->effort;
+        for(unsigned int slot = 0; slot < reverseSlots.size(); ++slot) {
+            const Edge &e = edgeSlab[slot];
+            if(e.startID == Abstraction::NoEdge) continue;
+
+            double val = e.initialEffort - e.effort;
 				
-                if(std::isinf(val) || val == 0) continue;
+            if(std::isinf(val) || val == 0) continue;
 
-                if(val < min) min = val;
-                if(val > max) max = val;
-            }
+            if(val < min) min = val;
+            if(val > max) max = val;
         }
 
-        for(auto eset : edges) {
-            for(auto e : eset.second) {
-                double val = e.second->initialEffort - e.second->effort;
+        for(unsigned int slot = 0; slot < reverseSlots.size(); ++slot) {
+            const Edge &e = edgeSlab[slot];
+            if(e.startID == Abstraction::NoEdge) continue;
 
-                if(std::isinf(val) || val == 0) continue;
+            double val = e.initialEffort - e.effort;
 
-                auto a = abstraction->getState(e.second->startID)->as<ompl::base::SE3StateSpace::StateType>();
-                auto b = abstraction->getState(e.second->endID)->as<ompl::base::SE3StateSpace::StateType>();
+            if(std::isinf(val) || val == 0) continue;
 
-                auto color = getColor(min, max, val);
+            auto a = abstraction->getState(e.startID)->as<ompl::base::SE3StateSpace::StateType>();
+            auto b = abstraction->getState(e.endID)->as<ompl::base::SE3StateSpace::StateType>();
 
-                fprintf(f, "%g %g %g %g %g %g %g %g %g\n", a->getX(), a->getY(), a->getZ(), b->getX(), b->getY(), b->getZ(), color[0], color[1], color[2]);
-            }
+            auto color = getColor(min, max, val);
+
+            fprintf(f, "%g %g %g %g %g %g %g %g %g\n", a->getX(), a->getY(), a->getZ(), b->getX(), b->getY(), b->getZ(), color[0], color[1], color[2]);
         }
 
         fclose(f);
@@ -388,15 +417,290 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
     virtual bool sampleNear(ompl::base::State *, const ompl::base::State *, const double) = 0;
     virtual void reached(ompl::base::State *) = 0;
 
+    /* Batched sampling for the parallel planner. All count pairs are picked before any of their propagations
+       come back, reachedBatch records what each item got to and finishBatch applies the outcomes in item
+       order, so the result only depends on the order of the items. Each item's edge is taken off open until
+       the batch is picked, so the items go to the best count edges instead of all to the top one; with
+       fewer edges on open than items the picking starts over from the top. */
+    void sampleBatch(const std::vector<ompl::base::State *> &from, const std::vector<ompl::base::State *> &to) {
+        if(targetEdge != NULL) {
+            applyTargetOutcome();
+        }
+
+        batchTargets.clear();
+        batchSuccess.assign(from.size(), false);
+        std::vector<Edge *> picked;
+        for(unsigned int i = 0; i < from.size(); ++i) {
+            if(open.isEmpty()) {
+                for(Edge *e : picked) open.push(e);
+                picked.clear();
+            }
+            selectTarget(from[i], to[i]);
+            batchTargets.push_back(targetEdge);
+            if(open.inHeap(targetEdge)) {
+                open.remove(targetEdge);
+                picked.push_back(targetEdge);
+            }
+        }
+        for(Edge *e : picked) open.push(e);
+        targetEdge = NULL;
+    }
+
+    void reachedBatch(unsigned int item, ompl::base::State *state) {
+        if(addReachedState(state, batchTargets[item])) {
+            batchSuccess[item] = true;
+        }
+    }
+
+    void finishBatch() {
+        for(unsigned int i = 0; i < batchTargets.size(); ++i) {
+            targetEdge = batchTargets[i];
+            targetSuccess = batchSuccess[i];
+            applyTargetOutcome();
+        }
+        batchTargets.clear();
+        targetEdge = NULL;
+        targetSuccess = false;
+    }
+
+    /* Grow the abstraction in the middle of the search and repair what we built on top of it from the
+       abstraction's change set, so the g/rhs values of everything the change did not touch are kept.
+       If the ids were remapped (grid refinement) the search is rebuilt around the states we already have. */
+    virtual void refineAbstraction() {
+        Timer t("Abstraction refinement");
+        unsigned int revision = abstraction->getRevision();
+        abstraction->grow();
+
+        const Abstraction::ChangeSet &changes = abstraction->getChangeSet();
+        applyAbstractionChanges(changes, changes.remapped || changes.revision != revision + 1);
+    }
+
   protected:
 
     virtual void vertexMayBeInconsistent(unsigned int) = 0;
     virtual void vertexHasInfiniteValue(unsigned int) = 0;
+    virtual void repairShortestPaths(const std::vector<unsigned int> &touched) = 0;
+
+    // sample() split in two: fold the outcome of targetEdge back into the search, then pick the next one
+    virtual void applyTargetOutcome() = 0;
+    virtual void selectTarget(ompl::base::State *from, ompl::base::State *to) = 0;
+
+    // returns true if the state landed in target's end region, otherwise its region's edges go on open
+    bool addReachedState(ompl::base::State *state, const Edge *target) {
+        ompl::base::ScopedState<> incomingState(si_->getStateSpace());
+        incomingState = state;
+        unsigned int newCellId = abstraction->mapToAbstractRegion(incomingState);
+
+        regions[newCellId].addState(state);
+
+        if(target != NULL && newCellId == target->endID) {
+            return true;
+        }
+        addOutgoingEdgesToOpen(newCellId);
+        return false;
+    }
+
+    /* One Vertex and one Region per abstract region and one Edge per abstraction edge slot, plus the goal
+       self edge at the very end of the slab. Edge pointers stay good until the slab is rebuilt. */
+    void allocateSearchStorage() {
+        unsigned int size = abstraction->getAbstractionSize();
+
+        vertices.clear();
+        vertices.reserve(size);
+        for(unsigned int i = 0; i < size; ++i) {
+            vertices.emplace_back(i);
+        }
+        regions.assign(size, Region());
+
+        buildEdgeSlab();
+    }
+
+    void buildEdgeSlab() {
+        unsigned int size = abstraction->getAbstractionSize();
+        unsigned int slots = abstraction->getEdgeSlotCount();
+
+        //slots that are never used (implicit grid edges leaving the grid) keep NoEdge as their endpoints
+        edgeSlab.assign(slots + 1, Edge(Abstraction::NoEdge, Abstraction::NoEdge));
+        reverseSlots.assign(slots, Abstraction::NoEdge);
+
+        for(unsigned int a = 0; a < size; ++a) {
+            auto neighbors = abstraction->getNeighboringCells(a);
+            for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+                unsigned int slot = it.getSlot();
+                Edge &e = edgeSlab[slot];
+                e.startID = a;
+                e.endID = *it;
+                if(abstraction->getCollisionCheckStatusBySlot(slot) == Abstraction::Edge::INVALID) {
+                    e.updateEdgeStatusKnowledge(Abstraction::Edge::INVALID);
+                }
+                reverseSlots[slot] = abstraction->getEdgeSlot(*it, a);
+            }
+        }
+
+        edgeSlab.back().startID = goalID;
+        edgeSlab.back().endID = goalID;
+    }
+
+    void recordInitialEfforts() {
+        for(auto &e : edgeSlab) {
+            e.initialEffort = e.effort;
+        }
+    }
+
+    void applyAbstractionChanges(const Abstraction::ChangeSet &changes, bool rebuild) {
+        unsigned int size = abstraction->getAbstractionSize();
+
+        //U points into vertices and open into the edge slab, so take both apart before either can move
+        std::vector<unsigned int> queued;
+        while(!U.isEmpty()) {
+            queued.push_back(U.pop()->id);
+        }
+
+        std::vector<std::pair<unsigned int, unsigned int>> opened;
+        bool goalEdgeOpen = false;
+        while(!open.isEmpty()) {
+            Edge *e = open.pop();
+            if(e == getGoalEdge()) {
+                goalEdgeOpen = true;
+            } else {
+                opened.emplace_back(e->startID, e->endID);
+            }
+        }
+
+        std::pair<unsigned int, unsigned int> target(Abstraction::NoEdge, Abstraction::NoEdge);
+        if(targetEdge != NULL && targetEdge != getGoalEdge()) {
+            target = std::make_pair(targetEdge->startID, targetEdge->endID);
+        }
+        bool targetWasGoalEdge = targetEdge != NULL && targetEdge == getGoalEdge();
+
+        std::vector<Edge> oldSlab;
+        oldSlab.swap(edgeSlab);
+        unsigned int oldSlots = reverseSlots.size();
+
+        //states may now belong to a different (new) region
+        std::vector<std::pair<unsigned int, ompl::base::State *>> states; //selection count and state
+        std::vector<bool> hadStates(regions.size(), false);
+        if(rebuild || size != regions.size()) {
+            for(unsigned int i = 0; i < regions.size(); ++i) {
+                hadStates[i] = !regions[i].states.empty();
+                regions[i].states.forEach([&states](ompl::base::State *state, unsigned int selected) {
+                    states.emplace_back(selected, state);
+                });
+                regions[i].clearStates();
+            }
+        }
+
+        std::vector<unsigned int> touched;
+        if(rebuild) {
+            targetEdge = NULL;
+            targetSuccess = false;
+            queued.clear();
+            opened.clear();
+
+            startID = abstraction->getStartIndex();
+            goalID = abstraction->getGoalIndex();
+
+            allocateSearchStorage();
+            vertices[goalID].rhs = 0;
+            for(unsigned int i = 0; i < size; ++i) {
+                touched.push_back(i);
+            }
+        } else {
+            for(unsigned int i = vertices.size(); i < size; ++i) {
+                vertices.emplace_back(i);
+                touched.push_back(i);
+            }
+            regions.resize(size);
+            buildEdgeSlab();
+
+            //everything we learned about the edges that survived moves to their new slots
+            for(unsigned int slot = 0; slot < oldSlots; ++slot) {
+                const Edge &e = oldSlab[slot];
+                if(e.startID == Abstraction::NoEdge) continue;
+                unsigned int newSlot = abstraction->getEdgeSlot(e.startID, e.endID);
+                if(newSlot == Abstraction::NoEdge) continue;
+                edgeSlab[newSlot] = e;
+                edgeSlab[newSlot].heapIndex = std::numeric_limits<unsigned int>::max();
+            }
+
+            for(const auto &edge : changes.removedEdges) {
+                touched.push_back(edge.first);
+            }
+            for(const auto &edge : changes.addedEdges) {
+                touched.push_back(edge.first);
+            }
+            for(const auto &edge : changes.resetEdges) {
+                getEdge(edge.first, edge.second)->updateEdgeStatusKnowledge(Abstraction::Edge::UNKNOWN);
+                touched.push_back(edge.first);
+            }
+
+            targetEdge = NULL;
+            if(targetWasGoalEdge) {
+                targetEdge = getGoalEdge();
+            } else if(target.first != Abstraction::NoEdge && abstraction->edgeExists(target.first, target.second)) {
+                targetEdge = getEdge(target.first, target.second);
+            }
+        }
+
+        Edge &goalEdge = edgeSlab.back();
+        goalEdge = oldSlab.back();
+        goalEdge.startID = goalEdge.endID = goalID;
+        goalEdge.heapIndex = std::numeric_limits<unsigned int>::max();
+
+        //keys of the queued vertices and efforts of the open edges are untouched, they only need their pointers back
+        for(auto id : queued) {
+            U.push(&vertices[id]);
+        }
+        for(const auto &edge : opened) {
+            if(abstraction->edgeExists(edge.first, edge.second)) {
+                open.push(getEdge(edge.first, edge.second));
+            }
+        }
+        if(goalEdgeOpen) {
+            open.push(getGoalEdge());
+        }
+
+        if(!states.empty()) {
+            //fewest selections first keeps every add at the end of its region's bucket list
+            std::stable_sort(states.begin(), states.end(),
+                             [](const std::pair<unsigned int, ompl::base::State *> &a, const std::pair<unsigned int, ompl::base::State *> &b) {
+                                 return a.first < b.first;
+                             });
+            ompl::base::ScopedState<> incomingState(si_->getStateSpace());
+            for(const auto &state : states) {
+                incomingState = state.second;
+                regions[abstraction->mapToAbstractRegion(incomingState)].states.add(state.second, state.first);
+            }
+        }
+
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        repairShortestPaths(touched);
+
+        for(unsigned int i = 0; i < size; ++i) {
+            if(!regions[i].states.empty()) {
+                if(rebuild || !states.empty() || std::binary_search(touched.begin(), touched.end(), i)) {
+                    addOutgoingEdgesToOpen(i);
+                }
+            } else if(i < hadStates.size() && hadStates[i] && !rebuild) {
+                //lost all of its states to a new region, nothing left to propagate from
+                auto neighbors = abstraction->getNeighboringCells(i);
+                for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+                    Edge *e = getEdgeBySlot(it.getSlot());
+                    if(open.inHeap(e)) open.remove(e);
+                }
+            }
+        }
+    }
 
     virtual void addOutgoingEdgesToOpen(unsigned int source) {
+        //the unknown edges out of here will be checked as a batch the next time open peeks at one of them
+        abstraction->prefetchOutgoingEdges(source);
+
         auto neighbors = abstraction->getNeighboringCells(source);
-        for(auto n : neighbors) {
-            Edge *e = getEdge(source, n);
+        for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+            unsigned int n = *it;
+            Edge *e = getEdgeBySlot(it.getSlot());
             if(std::isinf(vertices[n].g)) {
                 vertexHasInfiniteValue(n);
             }
@@ -405,16 +709,23 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
     }
 
     Edge* getEdge(unsigned int a, unsigned int b) {
-        Edge *e = edges[a][b];
-        if(e == NULL) {
-            e = new Edge(a, b);
-            if(abstraction->getCollisionCheckStatusUnchecked(a, b) == Abstraction::Edge::INVALID) {
-                e->updateEdgeStatusKnowledge(Abstraction::Edge::INVALID);
-            }
-            edges[a][b] = e;
-            reverseEdges[b][a] = e;
-        }
-        return e;
+        unsigned int slot = abstraction->getEdgeSlot(a, b);
+        assert(slot != Abstraction::NoEdge);
+        return &edgeSlab[slot];
+    }
+
+    // the edge leaving through one of the abstraction's edge slots, this skips the lookup getEdge has to do
+    Edge* getEdgeBySlot(unsigned int slot) {
+        return &edgeSlab[slot];
+    }
+
+    // the edge coming back the other way, the one a change of g at the slot's target has to update
+    Edge* getReverseEdgeBySlot(unsigned int slot) {
+        return &edgeSlab[reverseSlots[slot]];
+    }
+
+    Edge* getGoalEdge() {
+        return &edgeSlab.back();
     }
 
     virtual void updateEdgeEffort(Edge *e, double effort, bool addToOpen = true) {
@@ -430,14 +741,15 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
 
     double getInteriorEdgeEffort(Edge *edge) {
         double mySamples = edge->getEstimatedRequiredSamples();
-        double numberOfStates = vertices[edge->endID].states.size();
+        double numberOfStates = regions[edge->endID].states.size();
 
         double bestValue = std::numeric_limits<double>::infinity();
         auto neighbors = abstraction->getNeighboringCells(edge->endID);
-        for(auto n : neighbors) {
+        for(auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+            unsigned int n = *it;
             if(n == edge->startID) continue;
 
-            Edge *e = getEdge(edge->endID, n);
+            Edge *e = getEdgeBySlot(it.getSlot());
 
             double value = mySamples + e->getHypotheticalRequiredSamplesAfterPositivePropagation(numberOfStates) +
                     vertices[n].g;
@@ -452,22 +764,28 @@ class BeastSamplerBase : public ompl::base::AbstractionBasedSampler {
     }
 
     void updateSuccesfulInteriorEdgePropagation(Edge *edge) {
-        double numberOfStates = vertices[edge->endID].states.size();
+        double numberOfStates = regions[edge->endID].states.size();
         Edge *e = getEdge(edge->endID, edge->interiorToNextEdgeID);
         e->rewardHypotheticalSamplesAfterPositivePropagation(numberOfStates);
         vertexMayBeInconsistent(targetEdge->startID);
     }
 
     std::vector<Vertex> vertices;
-    std::unordered_map<unsigned int, std::unordered_map<unsigned int, Edge*>> edges;
-    std::unordered_map<unsigned int, std::unordered_map<unsigned int, Edge*>> reverseEdges;
+    std::vector<Region> regions;
+
+    /* edgeSlab[slot] is the edge through abstraction edge slot slot and reverseSlots[slot] the slot of the
+       same edge going the other way */
+    std::vector<Edge> edgeSlab;
+    std::vector<unsigned int> reverseSlots;
 
     unsigned int startID, goalID;
-    InPlaceBinaryHeap<Vertex, Vertex> U;
-    InPlaceBinaryHeap<Edge, Edge> open;
+    SearchQueue<Vertex> U;
+    SearchQueue<Edge> open;
 
     bool targetSuccess = false;
     Edge *targetEdge = NULL;
+    std::vector<Edge *> batchTargets;
+    std::vector<bool> batchSuccess;
     ompl::base::State *startState = NULL;
     ompl::base::State *goalState = NULL;
 
@@ -481,6 +799,8 @@ double BeastSamplerBase::Edge::validEdgeDistributionBeta = 0;
 double BeastSamplerBase::Edge::invalidEdgeDistributionAlpha = 0;
 double BeastSamplerBase::Edge::invalidEdgeDistributionBeta = 0;
 
+bool BeastSamplerBase::Region::leastSelectedFirst = false;
+
 }
 
 }
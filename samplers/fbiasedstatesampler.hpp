@@ -188,6 +188,7 @@ public:
 
 		generateRegionScores();
 
+		pdf.reserve(vertices.size());
 		for(unsigned int i = 0; i < vertices.size(); ++i) {
 			pdf.add(&vertices[i], vertices[i].vals[SCORE]);
 		}
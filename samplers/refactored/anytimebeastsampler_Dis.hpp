@@ -247,6 +247,8 @@ protected:
 	}
 
 	void addOutgoingEdgesToOpen(unsigned int id) {
+		abstraction->prefetchOutgoingEdges(id);
+
 		auto neighbors = abstraction->getNeighboringCells(id);
 		for(auto n : neighbors) {
 			Edge *e = getEdge(id, n);
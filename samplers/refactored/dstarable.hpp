@@ -86,6 +86,57 @@ public:
 		}
 	}
 
+	/* Repair after the abstraction grew, call computeShortestPath afterwards. Only the vertices whose outgoing
+	   edges changed are updated, everything else keeps its g and rhs. A remapped abstraction starts over. */
+	void applyChanges(const Abstraction::ChangeSet &changes, unsigned int newGoalID) {
+		unsigned int size = abstraction->getAbstractionSize();
+
+		//U points into vertices, so take it apart before vertices can move
+		std::vector<unsigned int> queued;
+		while(!U.isEmpty()) {
+			queued.push_back(U.pop()->id);
+		}
+
+		if(changes.remapped) {
+			goalID = newGoalID;
+			vertices.clear();
+			vertices.reserve(size);
+			for(unsigned int i = 0; i < size; i++) {
+				vertices.emplace_back(i);
+			}
+
+			vertices[goalID].rhs = 0;
+			vertices[goalID].key = calculateKey(goalID);
+			U.push(&vertices[goalID]);
+			return;
+		}
+
+		std::vector<unsigned int> touched;
+		for(unsigned int i = vertices.size(); i < size; i++) {
+			vertices.emplace_back(i);
+			touched.push_back(i);
+		}
+		for(const auto &edge : changes.removedEdges) {
+			touched.push_back(edge.first);
+		}
+		for(const auto &edge : changes.addedEdges) {
+			touched.push_back(edge.first);
+		}
+		for(const auto &edge : changes.resetEdges) {
+			touched.push_back(edge.first);
+		}
+
+		for(auto id : queued) {
+			U.push(&vertices[id]);
+		}
+
+		std::sort(touched.begin(), touched.end());
+		touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+		for(auto id : touched) {
+			updateVertex(id);
+		}
+	}
+
 	double getG(unsigned int i) const {
 		return vertices[i].g;
 	}
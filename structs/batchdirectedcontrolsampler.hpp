@@ -0,0 +1,176 @@
+#pragma once
+
+/* Directed control sampler that tries all of its candidate controls together.
+
+Does what SimpleDirectedControlSampler does, sample NumControls controls and step counts, propagate each
+while valid and keep the one that ends closest to the target, but the candidates are advanced in lockstep:
+every propagation step hands all the still running candidates to the propagator at once. With a
+BatchStatePropagator (the ODE models) that's one vectorized integration per step instead of one per
+candidate. Candidates drop out when they hit an invalid state or run out of steps. All the states and
+controls are allocated once in the constructor.
+
+Every call's counts are kept (getLastCall) and added to the global steeringCounters, which are per thread
+like the phase counters, so read them only while no planning threads are running.
+*/
+
+#include <ompl/control/DirectedControlSampler.h>
+#include <ompl/control/SpaceInformation.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "../domains/detail/odePropagator.hpp"
+#include "threadcounters.hpp"
+
+struct SteeringCounts {
+	uint64_t calls = 0;
+	uint64_t candidates = 0;
+	uint64_t propagationSteps = 0;
+	uint64_t earlyOuts = 0; //candidates stopped by an invalid state before using up their steps
+
+	SteeringCounts &operator+=(const SteeringCounts &other) {
+		calls += other.calls;
+		candidates += other.candidates;
+		propagationSteps += other.propagationSteps;
+		earlyOuts += other.earlyOuts;
+		return *this;
+	}
+};
+
+ThreadCounters<SteeringCounts> steeringCounters;
+
+class BatchDirectedControlSampler : public ompl::control::DirectedControlSampler {
+public:
+	BatchDirectedControlSampler(const ompl::control::SpaceInformation *si, unsigned int numControlSamples) :
+		ompl::control::DirectedControlSampler(si), controlSampler(si->allocControlSampler()),
+		batchPropagator(dynamic_cast<const ompl::app::BatchStatePropagator *>(si->getStatePropagator().get())),
+		candidates(std::max(numControlSamples, 1u)) {
+
+		for(auto &candidate : candidates) {
+			candidate.control = si->allocControl();
+			candidate.state = si->allocState();
+			candidate.next = si->allocState();
+		}
+		from.resize(candidates.size());
+		controls.resize(candidates.size());
+		to.resize(candidates.size());
+		running.resize(candidates.size());
+		distances.resize(candidates.size());
+	}
+
+	~BatchDirectedControlSampler() {
+		for(auto &candidate : candidates) {
+			si_->freeControl(candidate.control);
+			si_->freeState(candidate.state);
+			si_->freeState(candidate.next);
+		}
+	}
+
+	unsigned int sampleTo(ompl::control::Control *control, const ompl::base::State *source, ompl::base::State *dest) {
+		return sampleBest(control, NULL, source, dest);
+	}
+
+	unsigned int sampleTo(ompl::control::Control *control, const ompl::control::Control *previous, const ompl::base::State *source,
+	                      ompl::base::State *dest) {
+		return sampleBest(control, previous, source, dest);
+	}
+
+	const SteeringCounts &getLastCall() const {
+		return lastCall;
+	}
+
+private:
+	struct Candidate {
+		ompl::control::Control *control;
+		ompl::base::State *state, *next;
+		unsigned int steps, maxSteps;
+	};
+
+	unsigned int sampleBest(ompl::control::Control *control, const ompl::control::Control *previous, const ompl::base::State *source,
+	                        ompl::base::State *dest) {
+		lastCall = SteeringCounts();
+		lastCall.calls = 1;
+		lastCall.candidates = candidates.size();
+
+		unsigned int minDuration = si_->getMinControlDuration(), maxDuration = si_->getMaxControlDuration();
+		running.clear();
+		for(unsigned int i = 0; i < candidates.size(); ++i) {
+			Candidate &candidate = candidates[i];
+			if(previous != NULL) {
+				controlSampler->sampleNext(candidate.control, previous, source);
+			} else {
+				controlSampler->sample(candidate.control, source);
+			}
+			candidate.maxSteps = controlSampler->sampleStepCount(minDuration, maxDuration);
+			candidate.steps = 0;
+			si_->copyState(candidate.state, source);
+			if(candidate.maxSteps > 0) {
+				running.push_back(i);
+			}
+		}
+
+		propagateWhileValid();
+
+		//distances into a dense array first, then one pass for the closest; ties go to the earliest candidate like OMPL's
+		for(unsigned int i = 0; i < candidates.size(); ++i) {
+			distances[i] = si_->distance(candidates[i].state, dest);
+		}
+		unsigned int best = 0;
+		for(unsigned int i = 1; i < distances.size(); ++i) {
+			if(distances[i] < distances[best]) best = i;
+		}
+
+		si_->copyControl(control, candidates[best].control);
+		si_->copyState(dest, candidates[best].state);
+
+		steeringCounters.local() += lastCall;
+		return candidates[best].steps;
+	}
+
+	// SpaceInformation::propagateWhileValid for all the running candidates at once
+	void propagateWhileValid() {
+		const double stepSize = si_->getPropagationStepSize();
+		while(!running.empty()) {
+			unsigned int count = running.size();
+			for(unsigned int j = 0; j < count; ++j) {
+				Candidate &candidate = candidates[running[j]];
+				from[j] = candidate.state;
+				controls[j] = candidate.control;
+				to[j] = candidate.next;
+			}
+
+			if(batchPropagator != NULL) {
+				batchPropagator->propagateBatch(from.data(), controls.data(), count, stepSize, to.data());
+			} else {
+				const ompl::control::StatePropagatorPtr &propagator = si_->getStatePropagator();
+				for(unsigned int j = 0; j < count; ++j) {
+					propagator->propagate(from[j], controls[j], stepSize, to[j]);
+				}
+			}
+			lastCall.propagationSteps += count;
+
+			unsigned int kept = 0;
+			for(unsigned int j = 0; j < count; ++j) {
+				Candidate &candidate = candidates[running[j]];
+				if(!si_->isValid(candidate.next)) {
+					lastCall.earlyOuts++;
+					continue;
+				}
+				std::swap(candidate.state, candidate.next);
+				if(++candidate.steps < candidate.maxSteps) {
+					running[kept++] = running[j];
+				}
+			}
+			running.resize(kept);
+		}
+	}
+
+	ompl::control::ControlSamplerPtr controlSampler;
+	const ompl::app::BatchStatePropagator *batchPropagator;
+	std::vector<Candidate> candidates;
+	std::vector<const ompl::base::State *> from;
+	std::vector<const ompl::control::Control *> controls;
+	std::vector<ompl::base::State *> to;
+	std::vector<unsigned int> running;
+	std::vector<double> distances;
+	SteeringCounts lastCall;
+};
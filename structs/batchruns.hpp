@@ -0,0 +1,105 @@
+#pragma once
+
+/* The runs of batch mode (main.cpp runBatch): every instance in BatchInstances (or the batch file itself)
+once per seed of BatchSeeds, an inclusive range given as exactly two values "first last".
+
+Every run writes its own complete OMPL log, <Output>.<instance>.<seed> with Output taken from the batch
+file and instance the index into BatchInstances (0 without it), so the logs of one batch can go to the
+statistics scripts together as they would for separate invocations. Without BatchSeeds the seed is each
+instance's own Seed.
+
+runForked runs them jobs at a time, each in a forked child, so the domain, abstraction and sampler globals
+are never shared between runs. A run fails if it returns false or its child dies.
+*/
+
+#include "filemap.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+std::vector<FileMap> getBatchRuns(const FileMap &batch) {
+	std::vector<std::string> instances;
+	if(batch.exists("BatchInstances")) {
+		instances = batch.stringList("BatchInstances");
+	}
+
+	std::vector<int> seeds;
+	if(batch.exists("BatchSeeds")) {
+		auto range = batch.intList("BatchSeeds");
+		if(range.size() != 2 || range[0] > range[1]) {
+			fprintf(stderr, "BatchSeeds takes an inclusive range as two values \"first last\" with first <= last\n");
+			exit(1);
+		}
+		for(int seed = range[0]; seed <= range[1]; ++seed) {
+			seeds.push_back(seed);
+		}
+	}
+
+	std::vector<FileMap> runs;
+	unsigned int instanceCount = instances.empty() ? 1 : instances.size();
+	unsigned int seedCount = seeds.empty() ? 1 : seeds.size();
+	for(unsigned int i = 0; i < instanceCount; ++i) {
+		for(unsigned int j = 0; j < seedCount; ++j) {
+			FileMap params = instances.empty() ? batch : FileMap(instances[i]);
+			if(!seeds.empty()) {
+				params.set("Seed", std::to_string(seeds[j]));
+			}
+			params.set("Output", batch.stringVal("Output") + "." + std::to_string(i) + "." + params.stringVal("Seed"));
+			runs.push_back(params);
+		}
+	}
+	return runs;
+}
+
+// returns how many of the runs failed
+unsigned int runForked(const std::vector<FileMap> &runs, unsigned int jobs, bool (*run)(const FileMap &)) {
+	std::vector<bool> failed(runs.size(), false);
+	std::unordered_map<pid_t, unsigned int> running;
+	unsigned int next = 0;
+	while(next < runs.size() || !running.empty()) {
+		if(next < runs.size() && running.size() < jobs) {
+			// or the child would write out the parent's buffered output again
+			fflush(stdout);
+			fflush(stderr);
+			pid_t pid = fork();
+			if(pid == 0) {
+				bool ok = run(runs[next]);
+				// _exit skips the stdio flush that exit does
+				fflush(stdout);
+				fflush(stderr);
+				_exit(ok ? 0 : 1);
+			} else if(pid < 0) {
+				perror("fork");
+				failed[next] = true;
+			} else {
+				running[pid] = next;
+			}
+			next++;
+			continue;
+		}
+
+		int status = 0;
+		pid_t pid = wait(&status);
+		if(pid < 0) {
+			perror("wait");
+			break;
+		}
+		auto child = running.find(pid);
+		if(child == running.end()) continue;
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "benchmark run %s failed\n", runs[child->second].stringVal("Output").c_str());
+			failed[child->second] = true;
+		}
+		running.erase(child);
+	}
+
+	unsigned int failures = 0;
+	for(bool f : failed) failures += f;
+	return failures;
+}
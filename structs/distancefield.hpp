@@ -0,0 +1,311 @@
+#pragma once
+
+/* Voxel distance field of a triangle mesh with guaranteed bounds, for deciding motions by clearance lookups.
+
+The seeds are the voxels whose center is within h (half a voxel diagonal) of some triangle, so every point
+of the mesh is in a seed voxel and every seed has a point of the mesh within h. Every voxel stores its
+squared distance (in voxels, an exact integer) to the nearest seed center, and the distance D from its
+center to the mesh is then within h of that. From any point p in the voxel the mesh is between
+D - h - |p - center| and D + h + |p - center| away. It is the distance to the triangles, unsigned: like
+FCL's mesh checks it doesn't know inside from outside.
+
+The seeds come from every triangle's box and the distance transform is the exact squared Euclidean one of
+Felzenszwalb and Huttenlocher, one pass along each axis, so a build is linear in the voxels plus the
+triangle boxes. Triangles reaching past the grid are only seeded inside it, so when there are any the lower
+bounds also stop at the grid's boundary.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+class DistanceField {
+public:
+	enum SegmentStatus { Free, Blocked, Unknown };
+
+	static const uint32_t Unreachable = std::numeric_limits<uint32_t>::max();
+
+	DistanceField() {}
+
+	/* vertices are xyz triples, triangles vertex index triples, the grid covers [low, high] with cubic voxels
+	   of voxelSize (rounded up to whole voxels) */
+	DistanceField(const std::vector<double> &vertices, const std::vector<unsigned int> &triangles,
+	              const double low[3], const double high[3], double voxelSize) : voxelSize(voxelSize) {
+		unsigned long long count = 1;
+		for(unsigned int d = 0; d < 3; ++d) {
+			this->low[d] = low[d];
+			dims[d] = std::max(1u, (unsigned int)ceil((high[d] - low[d]) / voxelSize));
+			count *= dims[d];
+		}
+		halfDiagonal = getHalfDiagonal(voxelSize);
+
+		std::vector<double> grid(count, noSeed());
+		seed(vertices, triangles, grid);
+		transform(grid);
+
+		squaredDistances.resize(count);
+		for(unsigned long long i = 0; i < count; ++i) {
+			squaredDistances[i] = grid[i] >= noSeed() / 2 ? Unreachable : (uint32_t)grid[i];
+		}
+	}
+
+	bool isEmpty() const {
+		return squaredDistances.empty();
+	}
+
+	double getVoxelSize() const {
+		return voxelSize;
+	}
+
+	unsigned int getCellCount(unsigned int axis) const {
+		return dims[axis];
+	}
+
+	// from the center of voxel (x, y, z) to the nearest seed center in voxels squared, Unreachable without seeds
+	uint32_t getSquaredVoxelDistance(unsigned int x, unsigned int y, unsigned int z) const {
+		return squaredDistances[((unsigned long long)z * dims[1] + y) * dims[0] + x];
+	}
+
+	// false outside the grid, otherwise the mesh is between lower and upper away from p
+	bool distanceBounds(const double p[3], double &lower, double &upper) const {
+		unsigned int cell[3];
+		double offset = 0;
+		for(unsigned int d = 0; d < 3; ++d) {
+			double x = (p[d] - low[d]) / voxelSize;
+			if(!(x >= 0 && x < dims[d])) return false;
+			cell[d] = (unsigned int)x;
+			double fromCenter = (x - cell[d] - 0.5) * voxelSize;
+			offset += fromCenter * fromCenter;
+		}
+		offset = sqrt(offset);
+
+		uint32_t squared = squaredDistances[((unsigned long long)cell[2] * dims[1] + cell[1]) * dims[0] + cell[0]];
+		if(squared == Unreachable) {
+			lower = upper = std::numeric_limits<double>::infinity();
+		} else {
+			double distance = sqrt((double)squared) * voxelSize;
+			lower = std::max(0., distance - halfDiagonal - offset);
+			upper = distance + halfDiagonal + offset;
+		}
+
+		if(clipped) {
+			for(unsigned int d = 0; d < 3; ++d) {
+				lower = std::min(lower, std::min(p[d] - low[d], low[d] + dims[d] * voxelSize - p[d]));
+			}
+		}
+		return true;
+	}
+
+	/* Free if a ball of radius around every point of the segment from a to b misses the mesh, Blocked if the
+	   mesh comes closer than coreRadius to some point of it (0 never blocks) and Unknown if the bounds can't
+	   tell. Walks the segment by conservative advancement on the lower bounds, where they are too tight to
+	   get on it only goes on looking for a block a quarter voxel at a time. */
+	SegmentStatus checkSegment(const double a[3], const double b[3], double radius, double coreRadius) const {
+		double length = sqrt((b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]));
+		double minimumStep = voxelSize / 4;
+		bool certain = true;
+
+		for(double t = 0;; t = std::min(length, t)) {
+			double p[3], lower, upper;
+			double f = length > 0 ? t / length : 0;
+			for(unsigned int d = 0; d < 3; ++d) {
+				p[d] = a[d] + (b[d] - a[d]) * f;
+			}
+			if(!distanceBounds(p, lower, upper)) return Unknown;
+			if(upper < coreRadius) return Blocked;
+
+			double step = lower - radius;
+			if(step < minimumStep) {
+				if(coreRadius <= 0) return Unknown;
+				certain = false;
+				step = minimumStep;
+			}
+			if(t >= length) return certain ? Free : Unknown;
+			t += step;
+		}
+	}
+
+	bool write(FILE *file) const {
+		uint32_t header[4] = {dims[0], dims[1], dims[2], clipped ? 1u : 0u};
+		return fwrite(header, sizeof(header), 1, file) == 1 &&
+		       fwrite(low, sizeof(low), 1, file) == 1 &&
+		       fwrite(&voxelSize, sizeof(voxelSize), 1, file) == 1 &&
+		       fwrite(squaredDistances.data(), sizeof(uint32_t), squaredDistances.size(), file) == squaredDistances.size();
+	}
+
+	bool read(FILE *file) {
+		uint32_t header[4];
+		if(fread(header, sizeof(header), 1, file) != 1 ||
+		   fread(low, sizeof(low), 1, file) != 1 ||
+		   fread(&voxelSize, sizeof(voxelSize), 1, file) != 1) {
+			return false;
+		}
+		for(unsigned int d = 0; d < 3; ++d) {
+			dims[d] = header[d];
+		}
+		clipped = header[3] != 0;
+		halfDiagonal = getHalfDiagonal(voxelSize);
+		squaredDistances.resize((unsigned long long)dims[0] * dims[1] * dims[2]);
+		return fread(squaredDistances.data(), sizeof(uint32_t), squaredDistances.size(), file) == squaredDistances.size();
+	}
+
+private:
+	// the transform's infinity, not a real one so that differences of them stay finite
+	static double noSeed() {
+		return 1e20;
+	}
+
+	// with a little slack for the rounding of the seed test
+	static double getHalfDiagonal(double voxelSize) {
+		return voxelSize * (sqrt(3.) / 2 + 1e-9);
+	}
+
+	static double squaredDistanceToTriangle(const double p[3], const double *a, const double *b, const double *c) {
+		// closest point on the triangle by its Voronoi regions (Ericson, Real-Time Collision Detection 5.1.5)
+		double ab[3], ac[3], ap[3], bp[3], cp[3];
+		for(unsigned int d = 0; d < 3; ++d) {
+			ab[d] = b[d] - a[d];
+			ac[d] = c[d] - a[d];
+			ap[d] = p[d] - a[d];
+			bp[d] = p[d] - b[d];
+			cp[d] = p[d] - c[d];
+		}
+		auto dot = [](const double *u, const double *v) {
+			return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+		};
+		double closest[3];
+		auto at = [&](const double *origin, double s, const double *u, double r, const double *v) {
+			for(unsigned int d = 0; d < 3; ++d) closest[d] = origin[d] + s * u[d] + r * v[d];
+		};
+
+		double d1 = dot(ab, ap), d2 = dot(ac, ap);
+		double d3 = dot(ab, bp), d4 = dot(ac, bp);
+		double d5 = dot(ab, cp), d6 = dot(ac, cp);
+		double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+		if(d1 <= 0 && d2 <= 0) {
+			at(a, 0, ab, 0, ac);
+		} else if(d3 >= 0 && d4 <= d3) {
+			at(b, 0, ab, 0, ac);
+		} else if(d6 >= 0 && d5 <= d6) {
+			at(c, 0, ab, 0, ac);
+		} else if(vc <= 0 && d1 >= 0 && d3 <= 0) {
+			at(a, d1 / (d1 - d3), ab, 0, ac);
+		} else if(vb <= 0 && d2 >= 0 && d6 <= 0) {
+			at(a, 0, ab, d2 / (d2 - d6), ac);
+		} else if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+			double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			double bc[3] = {c[0] - b[0], c[1] - b[1], c[2] - b[2]};
+			at(b, w, bc, 0, ac);
+		} else {
+			double denominator = 1 / (va + vb + vc);
+			at(a, vb * denominator, ab, vc * denominator, ac);
+		}
+
+		double squared = 0;
+		for(unsigned int d = 0; d < 3; ++d) {
+			squared += (p[d] - closest[d]) * (p[d] - closest[d]);
+		}
+		return squared;
+	}
+
+	void seed(const std::vector<double> &vertices, const std::vector<unsigned int> &triangles, std::vector<double> &grid) {
+		double halfDiagonalSquared = halfDiagonal * halfDiagonal;
+		for(unsigned int t = 0; t + 2 < triangles.size(); t += 3) {
+			const double *corner[3] = {&vertices[3 * triangles[t]], &vertices[3 * triangles[t + 1]], &vertices[3 * triangles[t + 2]]};
+
+			// the voxels whose centers are within h of the triangle's box
+			int first[3], last[3];
+			bool empty = false;
+			for(unsigned int d = 0; d < 3; ++d) {
+				double minimum = std::min(corner[0][d], std::min(corner[1][d], corner[2][d]));
+				double maximum = std::max(corner[0][d], std::max(corner[1][d], corner[2][d]));
+				if(minimum < low[d] || maximum > low[d] + dims[d] * voxelSize) clipped = true;
+
+				double from = ceil((minimum - halfDiagonal - low[d]) / voxelSize - 0.5);
+				double to = floor((maximum + halfDiagonal - low[d]) / voxelSize - 0.5);
+				from = std::max(from, 0.);
+				to = std::min(to, dims[d] - 1.);
+				if(from > to) empty = true;
+				first[d] = (int)from;
+				last[d] = (int)to;
+			}
+			if(empty) continue;
+
+			double center[3];
+			for(int z = first[2]; z <= last[2]; ++z) {
+				center[2] = low[2] + (z + 0.5) * voxelSize;
+				for(int y = first[1]; y <= last[1]; ++y) {
+					center[1] = low[1] + (y + 0.5) * voxelSize;
+					unsigned long long row = ((unsigned long long)z * dims[1] + y) * dims[0];
+					for(int x = first[0]; x <= last[0]; ++x) {
+						if(grid[row + x] == 0) continue;
+						center[0] = low[0] + (x + 0.5) * voxelSize;
+						if(squaredDistanceToTriangle(center, corner[0], corner[1], corner[2]) <= halfDiagonalSquared) {
+							grid[row + x] = 0;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// the squared distance transform of every line along every axis in turn
+	void transform(std::vector<double> &grid) const {
+		unsigned long long strides[3] = {1, dims[0], (unsigned long long)dims[0] * dims[1]};
+		unsigned int longest = std::max(dims[0], std::max(dims[1], dims[2]));
+		std::vector<double> f(longest), out(longest), z(longest + 1);
+		std::vector<int> v(longest);
+
+		for(unsigned int axis = 0; axis < 3; ++axis) {
+			unsigned int n = dims[axis], other1 = (axis + 1) % 3, other2 = (axis + 2) % 3;
+			unsigned long long stride = strides[axis];
+			for(unsigned int j = 0; j < dims[other2]; ++j) {
+				for(unsigned int i = 0; i < dims[other1]; ++i) {
+					unsigned long long base = i * strides[other1] + j * strides[other2];
+					for(unsigned int q = 0; q < n; ++q) f[q] = grid[base + q * stride];
+					transformLine(f.data(), n, out.data(), v.data(), z.data());
+					for(unsigned int q = 0; q < n; ++q) grid[base + q * stride] = out[q];
+				}
+			}
+		}
+	}
+
+	// lower envelope of the parabolas (q - p)^2 + f[p]
+	static void transformLine(const double *f, unsigned int n, double *out, int *v, double *z) {
+		const double infinity = std::numeric_limits<double>::infinity();
+		int k = 0;
+		v[0] = 0;
+		z[0] = -infinity;
+		z[1] = infinity;
+		auto intersection = [f](int q, int p) {
+			return ((f[q] + (double)q * q) - (f[p] + (double)p * p)) / (2. * q - 2. * p);
+		};
+		for(int q = 1; q < (int)n; ++q) {
+			double s = intersection(q, v[k]);
+			while(s <= z[k]) {
+				k--;
+				s = intersection(q, v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = infinity;
+		}
+
+		k = 0;
+		for(int q = 0; q < (int)n; ++q) {
+			while(z[k + 1] < q) k++;
+			out[q] = (double)(q - v[k]) * (q - v[k]) + f[v[k]];
+		}
+	}
+
+	unsigned int dims[3] = {0, 0, 0};
+	double low[3] = {0, 0, 0};
+	double voxelSize = 1, halfDiagonal = 0;
+	bool clipped = false;
+	std::vector<uint32_t> squaredDistances;
+};
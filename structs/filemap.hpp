@@ -54,6 +54,10 @@ public:
 		}
 	}
 
+	void set(const std::string &key, const std::string &value) {
+		map[key] = value;
+	}
+
 	bool exists(const std::string &key) const {
 		return map.find(key) != map.end();
 	}
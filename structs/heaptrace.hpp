@@ -0,0 +1,78 @@
+#pragma once
+
+/* Heap wrapper that writes every operation to a trace file for benchmarks/heapbenchmark.cpp to replay.
+
+With HEAP_TRACE defined (the HEAP_TRACE cmake option) the BEAST queues are wrapped in TracedHeap. Every
+traced heap writes heap-<n>.trace in the working directory, n counting the traced heaps of the process in
+construction order, so for one BEAST sampler U is heap-0 and open heap-1. Class Ops defines, on top of
+what the wrapped heap needs:
+
+void traceKey(const T*, double key[3])
+
+the item's key as three numbers ordered lexicographically the way pred orders the items. A line is
+
+<op> <item> <key0> <key1> <key2>
+
+op one of push, pop, sift, remove, clear, item a dense id given on first sight. pop and clear write the
+popped item and zeros, the others the key the item has when it is handed to the heap.
+*/
+
+#include <cstdio>
+#include <unordered_map>
+
+template <class Heap, class T, class Ops>
+class TracedHeap : public Heap {
+public:
+	TracedHeap(int size=100) : Heap(size) {
+		static unsigned int heapCount = 0;
+		char name[32];
+		snprintf(name, sizeof(name), "heap-%u.trace", heapCount++);
+		trace = fopen(name, "w");
+	}
+
+	~TracedHeap() {
+		if(trace != NULL) fclose(trace);
+	}
+
+	void clear() {
+		write("clear", NULL);
+		Heap::clear();
+	}
+
+	void push(T *data) {
+		write("push", data);
+		Heap::push(data);
+	}
+
+	T *pop() {
+		T *ret_T = Heap::pop();
+		write("pop", ret_T, false);
+		return ret_T;
+	}
+
+	void siftFromItem(const T *data) {
+		if(Heap::inHeap(data)) write("sift", data);
+		Heap::siftFromItem(data);
+	}
+
+	void remove(const T *data) {
+		write("remove", data);
+		Heap::remove(data);
+	}
+
+private:
+	void write(const char *op, const T *data, bool withKey = true) {
+		if(trace == NULL) return;
+		double key[3] = {0, 0, 0};
+		unsigned int item = 0;
+		if(data != NULL) {
+			auto id = ids.emplace(data, ids.size());
+			item = id.first->second;
+			if(withKey) Ops::traceKey(data, key);
+		}
+		fprintf(trace, "%s %u %.17g %.17g %.17g\n", op, item, key[0], key[1], key[2]);
+	}
+
+	FILE *trace = NULL;
+	std::unordered_map<const T *, unsigned int> ids;
+};
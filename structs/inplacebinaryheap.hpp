@@ -10,6 +10,7 @@ bool pred(const T*, const T*)
 
 #include <limits>
 #include <cassert>
+#include <cstdio>
 #include <vector>
 
 template <class T, class Ops>
@@ -21,9 +22,9 @@ public:
 
 	// initalize the heap from a vector, overwriting existing heap
 	void createFromVector(const std::vector<T *> &vec) {
-		if(heap.size() < vec.size()) {
+		if(heap.size() <= vec.size()) {
 			unsigned int size = heap.size() * 2;
-			while(size < vec.size()) {
+			while(size <= vec.size()) {
 				size *= 2;
 			}
 			heap.resize(size);
@@ -31,9 +32,10 @@ public:
 		fill = 0;
 		for(auto item = vec.begin(); item != vec.end(); ++item) {
 			heap[1 + fill++] = *item;
+			Ops::setHeapIndex(*item, fill);
 		}
 		for(int i = fill / 2; i > 0; i--) {
-			siftUp(i);
+			siftDown(i);
 		}
 	}
 
@@ -102,8 +104,10 @@ public:
 	// remove an item from the heap
 	void remove(const T *data) {
 		unsigned int index = Ops::getHeapIndex(data);
+		T *removed = heap[index];
 		swap(index,fill);
 		fill--;
+		Ops::setHeapIndex(removed, std::numeric_limits<unsigned int>::max());
 		if(index <= fill) {
 			int parent_index = parent(index);
 			if(index > 1 && Ops::pred(heap[index], heap[parent_index])) {
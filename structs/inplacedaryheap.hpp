@@ -0,0 +1,175 @@
+#pragma once
+
+/* Drop in for InPlaceBinaryHeap with D children per node and every item's key cached next to its pointer,
+so sifting compares keys in the heap array instead of dereferencing the items. Class Ops defines the same
+as for InPlaceBinaryHeap plus:
+
+typedef ... HeapKey (with operator<, ordering items the way pred does)
+HeapKey getHeapKey(const T*)
+
+A key is read when its item is pushed or sifted, so an item's key may only change while it is in the heap
+if siftFromItem (or remove) follows, which is what InPlaceBinaryHeap needs anyway. Heap indices handed to
+Ops are 1 based like InPlaceBinaryHeap's, so inHeap works the same way.
+*/
+
+#include <limits>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+template <class T, class Ops, unsigned int D = 4>
+class InPlaceDaryHeap {
+public:
+	typedef typename Ops::HeapKey Key;
+
+	InPlaceDaryHeap(int size=100) {
+		heap.reserve(size);
+	}
+
+	// initalize the heap from a vector, overwriting existing heap
+	void createFromVector(const std::vector<T *> &vec) {
+		heap.clear();
+		for(T *item : vec) {
+			heap.push_back(Entry(Ops::getHeapKey(item), item));
+			Ops::setHeapIndex(item, heap.size());
+		}
+		for(int i = (int)heap.size() - 1; i >= 0; i--) {
+			siftDown(i);
+		}
+	}
+
+	void clear() {
+		heap.clear();
+	}
+
+	void push(T *data) {
+		heap.push_back(Entry(Ops::getHeapKey(data), data));
+		Ops::setHeapIndex(data, heap.size());
+		siftUp(heap.size() - 1);
+	}
+
+	T *peek() {
+		assert(!heap.empty());
+		return heap[0].item;
+	}
+
+	T *pop() {
+		assert(!heap.empty());
+		T *ret_T = heap[0].item;
+		move(0, heap.back());
+		heap.pop_back();
+		if(!heap.empty()) {
+			siftDown(0);
+		}
+		Ops::setHeapIndex(ret_T, std::numeric_limits<unsigned int>::max());
+		return ret_T;
+	}
+
+	bool isEmpty() const {
+		return heap.empty();
+	}
+
+	int getFill() const {
+		return heap.size();
+	}
+
+	bool inHeap(const T *data) const {
+		unsigned int index = Ops::getHeapIndex(data);
+		return index >= 1 && index <= heap.size();
+	}
+
+	// the data item may have been updated while in the heap and requires fixing
+	void siftFromItem(const T *data) {
+		unsigned int index = Ops::getHeapIndex(data);
+		if(index > 0 && index <= heap.size()) {
+			heap[index - 1].key = Ops::getHeapKey(data);
+			resift(index - 1);
+		}
+	}
+
+	void remove(const T *data) {
+		unsigned int index = Ops::getHeapIndex(data) - 1;
+		T *removed = heap[index].item;
+		move(index, heap.back());
+		heap.pop_back();
+		if(index < heap.size()) {
+			resift(index);
+		}
+		Ops::setHeapIndex(removed, std::numeric_limits<unsigned int>::max());
+	}
+
+	bool checkInvariant() const {
+		for(unsigned int i = 1; i < heap.size(); i++) {
+			if(heap[i].key < heap[parent(i)].key) return false;
+		}
+		return true;
+	}
+
+protected:
+	bool checkIndices() const {
+		for(unsigned int i = 0; i < heap.size(); ++i) {
+			if(Ops::getHeapIndex(heap[i].item) != i + 1) {
+				fprintf(stderr, "%u ?= %u\n", i + 1, Ops::getHeapIndex(heap[i].item));
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	struct Entry {
+		Entry(const Key &key, T *item) : key(key), item(item) {}
+
+		Key key;
+		T *item;
+	};
+
+	static unsigned int parent(unsigned int i) {
+		return (i - 1) / D;
+	}
+
+	void move(unsigned int i, const Entry &entry) {
+		heap[i] = entry;
+		Ops::setHeapIndex(heap[i].item, i + 1);
+	}
+
+	void resift(unsigned int index) {
+		if(index > 0 && heap[index].key < heap[parent(index)].key) {
+			siftUp(index);
+		} else {
+			siftDown(index);
+		}
+	}
+
+	// holes instead of swaps: the moving entry is written once, where it ends up
+	void siftUp(unsigned int index) {
+		Entry entry = heap[index];
+		while(index > 0) {
+			unsigned int parent_index = parent(index);
+			if(!(entry.key < heap[parent_index].key)) break;
+			move(index, heap[parent_index]);
+			index = parent_index;
+		}
+		move(index, entry);
+	}
+
+	void siftDown(unsigned int index) {
+		Entry entry = heap[index];
+		const unsigned int fill = heap.size();
+		while(true) {
+			unsigned int first = index * D + 1;
+			if(first >= fill) break;
+			unsigned int last = first + D < fill ? first + D : fill;
+			unsigned int best = first;
+			for(unsigned int child = first + 1; child < last; ++child) {
+				if(heap[child].key < heap[best].key) best = child;
+			}
+			if(!(heap[best].key < entry.key)) break;
+			move(index, heap[best]);
+			index = best;
+		}
+		move(index, entry);
+	}
+
+	std::vector<Entry> heap;
+};
@@ -0,0 +1,561 @@
+#pragma once
+
+/* KD-tree nearest neighbors for the rigid body domains.
+
+The car and hovercraft states are an SE2 pose, optionally followed by real vector velocities; the blimp and
+quadrotor are the same with SE3. Instead of going through si->distance for every pair the tree keeps each
+state packed as plain doubles and computes the same weighted distance OMPL would (the weights are read from
+the state space) inline, a leaf at a time over coordinates stored one dimension after another so the scans
+vectorize.
+
+Only the translation and velocity axes are split on, the rotation (an angle that wraps, or a quaternion)
+doesn't bound the distance along a single axis. Points are inserted and removed one at a time without
+rebalancing, the planners' samples are uniform enough that the tree stays in shape.
+
+The motion's state has to stay put while it's in the tree, it is packed again to find it on remove().
+
+Picked per instance with NearestNeighbors ? KDTreeSE2 / KDTreeSE3, Default keeps OMPL's choice.
+*/
+
+#include <ompl/datastructures/NearestNeighbors.h>
+#include <ompl/tools/config/SelfConfig.h>
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SE3StateSpace.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <ompl/util/Exception.h>
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* The rigid body part of the state, the first Dimension values. distances() fills out[k] with the unweighted
+   translation and rotation distance of the query to lane k of coordinates laid out a dimension at a time. */
+
+struct SE2Rigid {
+	static const unsigned int Dimension = 3, TranslationDimension = 2;
+	static const int Type = ompl::base::STATE_SPACE_SE2;
+
+	static void distances(const double *coords, unsigned int stride, unsigned int count, const double *q,
+	                      double translationWeight, double rotationWeight, double *out) {
+		const double pi = boost::math::constants::pi<double>();
+		const double *x = coords, *y = coords + stride, *theta = coords + 2 * stride;
+		for(unsigned int k = 0; k < count; ++k) {
+			double dx = x[k] - q[0], dy = y[k] - q[1];
+			double d = std::fabs(theta[k] - q[2]);
+			d = d > pi ? 2.0 * pi - d : d;
+			out[k] = translationWeight * std::sqrt(dx * dx + dy * dy) + rotationWeight * d;
+		}
+	}
+};
+
+struct SE3Rigid {
+	static const unsigned int Dimension = 7, TranslationDimension = 3;
+	static const int Type = ompl::base::STATE_SPACE_SE3;
+
+	static void distances(const double *coords, unsigned int stride, unsigned int count, const double *q,
+	                      double translationWeight, double rotationWeight, double *out) {
+		const double *x = coords, *y = coords + stride, *z = coords + 2 * stride;
+		const double *qx = coords + 3 * stride, *qy = coords + 4 * stride, *qz = coords + 5 * stride, *qw = coords + 6 * stride;
+		for(unsigned int k = 0; k < count; ++k) {
+			double dx = x[k] - q[0], dy = y[k] - q[1], dz = z[k] - q[2];
+			// SO3StateSpace's arc length, including its tolerance for nearly identical rotations
+			double dq = std::fabs(qx[k] * q[3] + qy[k] * q[4] + qz[k] * q[5] + qw[k] * q[6]);
+			double d = dq > 1.0 - 1e-9 ? 0.0 : std::acos(dq);
+			out[k] = translationWeight * std::sqrt(dx * dx + dy * dy + dz * dz) + rotationWeight * d;
+		}
+	}
+};
+
+/* The two lookups SST makes every iteration, each answered in one traversal. Use them through the
+   selectWithin and nearestWithDistance functions below, which fall back on plain queries for other indexes. */
+template <class Motion>
+class SSTNearestNeighbors {
+public:
+	virtual ~SSTNearestNeighbors() {}
+
+	virtual Motion *nearest(Motion *const &data, double &distance) const = 0;
+
+	/* the best node by better() among the ones within radius that accept() takes, or if there are none the
+	   closest one it takes; NULL if it takes none at all */
+	virtual Motion *selectWithin(Motion *const &data, double radius, const std::function<bool(Motion *)> &accept,
+	                             const std::function<bool(Motion *, Motion *)> &better) const = 0;
+};
+
+/* The state is Owner::*StateMember, Owner being Motion or the base class that declares it. */
+template <class Motion, class Owner, ompl::base::State *Owner::*StateMember, class Rigid>
+class KDTreeNearestNeighbors : public ompl::NearestNeighbors<Motion *>, public SSTNearestNeighbors<Motion> {
+public:
+	static const unsigned int MaxDimension = Rigid::Dimension + 9;
+	static const unsigned int LeafSize = 16;
+
+	KDTreeNearestNeighbors(const ompl::base::StateSpacePtr &space) : space(space.get()), count(0) {
+		const ompl::base::StateSpace *rigid = space.get();
+		double rigidWeight = 1;
+		dimension = Rigid::Dimension;
+		if(space->getType() != Rigid::Type) {
+			const ompl::base::CompoundStateSpace *compound = space->isCompound() ? space->as<ompl::base::CompoundStateSpace>() : NULL;
+			if(compound == NULL || compound->getSubspace(0)->getType() != Rigid::Type) {
+				throw ompl::Exception("KDTreeNearestNeighbors", "state space does not start with the expected rigid body space");
+			}
+			rigid = compound->getSubspace(0).get();
+			rigidWeight = compound->getSubspaceWeight(0);
+			for(unsigned int i = 1; i < compound->getSubspaceCount(); ++i) {
+				const ompl::base::StateSpacePtr &subspace = compound->getSubspace(i);
+				if(subspace->getType() != ompl::base::STATE_SPACE_REAL_VECTOR) {
+					throw ompl::Exception("KDTreeNearestNeighbors", "only real vector spaces can follow the rigid body space");
+				}
+				groups.push_back(Group(dimension, subspace->getDimension(), compound->getSubspaceWeight(i)));
+				dimension += subspace->getDimension();
+			}
+		}
+		if(dimension > MaxDimension) {
+			throw ompl::Exception("KDTreeNearestNeighbors", "state space has too many dimensions");
+		}
+
+		const ompl::base::CompoundStateSpace *rigidCompound = rigid->as<ompl::base::CompoundStateSpace>();
+		rigidScale = rigidWeight;
+		translationWeight = rigidCompound->getSubspaceWeight(0);
+		rotationWeight = rigidCompound->getSubspaceWeight(1);
+
+		std::fill(axisWeight, axisWeight + MaxDimension, 0.);
+		for(unsigned int i = 0; i < Rigid::TranslationDimension; ++i) {
+			axisWeight[i] = rigidWeight * translationWeight;
+		}
+		for(const Group &group : groups) {
+			std::fill(axisWeight + group.offset, axisWeight + group.offset + group.size, group.weight);
+		}
+
+		clear();
+	}
+
+	virtual ~KDTreeNearestNeighbors() {}
+
+	virtual bool reportsSortedResults() const {
+		return true;
+	}
+
+	virtual void clear() {
+		nodes.clear();
+		leaves.clear();
+		nodes.push_back(Node(0));
+		leaves.emplace_back(new Leaf(dimension));
+		count = 0;
+	}
+
+	virtual std::size_t size() const {
+		return count;
+	}
+
+	virtual void add(Motion *const &data) {
+		double q[MaxDimension];
+		pack(data, q);
+
+		unsigned int node = descend(q);
+		Leaf *leaf = leaves[nodes[node].leaf].get();
+		if(leaf->count == leaf->capacity && split(node)) {
+			node = descend(q);
+			leaf = leaves[nodes[node].leaf].get();
+		}
+		leaf->push(q, data);
+		count++;
+	}
+
+	virtual void add(const std::vector<Motion *> &data) {
+		for(Motion *motion : data) add(motion);
+	}
+
+	virtual bool remove(Motion *const &data) {
+		double q[MaxDimension];
+		pack(data, q);
+
+		Leaf &leaf = *leaves[nodes[descend(q)].leaf];
+		for(unsigned int k = 0; k < leaf.count; ++k) {
+			if(leaf.data[k] == data) {
+				leaf.erase(k);
+				count--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	virtual Motion *nearest(Motion *const &data) const {
+		if(count == 0) {
+			throw ompl::Exception("No elements found in nearest neighbors data structure");
+		}
+		double q[MaxDimension];
+		pack(data, q);
+
+		NearestCollector collector;
+		search(0, q, collector);
+		return collector.best;
+	}
+
+	virtual Motion *nearest(Motion *const &data, double &distance) const {
+		if(count == 0) {
+			throw ompl::Exception("No elements found in nearest neighbors data structure");
+		}
+		double q[MaxDimension];
+		pack(data, q);
+
+		NearestCollector collector;
+		search(0, q, collector);
+		distance = collector.distance;
+		return collector.best;
+	}
+
+	virtual Motion *selectWithin(Motion *const &data, double radius, const std::function<bool(Motion *)> &accept,
+	                             const std::function<bool(Motion *, Motion *)> &better) const {
+		if(count == 0) return NULL;
+		double q[MaxDimension];
+		pack(data, q);
+
+		SelectCollector collector(radius, accept, better);
+		search(0, q, collector);
+		return collector.best != NULL ? collector.best : collector.closest;
+	}
+
+	virtual void nearestK(Motion *const &data, std::size_t k, std::vector<Motion *> &nbh) const {
+		nbh.clear();
+		if(k == 0 || count == 0) return;
+		double q[MaxDimension];
+		pack(data, q);
+
+		KCollector collector(k);
+		search(0, q, collector);
+		collector.sorted(nbh);
+	}
+
+	virtual void nearestR(Motion *const &data, double radius, std::vector<Motion *> &nbh) const {
+		nbh.clear();
+		if(count == 0) return;
+		double q[MaxDimension];
+		pack(data, q);
+
+		RCollector collector(radius);
+		search(0, q, collector);
+		collector.sorted(nbh);
+	}
+
+	virtual void list(std::vector<Motion *> &data) const {
+		data.clear();
+		data.reserve(count);
+		for(const auto &leaf : leaves) {
+			data.insert(data.end(), leaf->data.begin(), leaf->data.begin() + leaf->count);
+		}
+	}
+
+protected:
+	typedef std::pair<double, Motion *> Neighbor;
+
+	// a real vector subspace after the rigid body, its values start at offset
+	struct Group {
+		Group(unsigned int offset, unsigned int size, double weight) : offset(offset), size(size), weight(weight) {}
+		unsigned int offset, size;
+		double weight;
+	};
+
+	// internal nodes split on axis, points with a coordinate below split go to children[0]; leaves have axis -1
+	struct Node {
+		Node(unsigned int leaf) : axis(-1), split(0), leaf(leaf) {
+			children[0] = children[1] = 0;
+		}
+		int axis;
+		double split;
+		unsigned int children[2];
+		unsigned int leaf;
+	};
+
+	// coordinates one dimension after another, coords[d * capacity + k]
+	struct Leaf {
+		Leaf(unsigned int dimension) : dimension(dimension), count(0), capacity(LeafSize),
+			coords(dimension * LeafSize), data(LeafSize) {}
+
+		void push(const double *q, Motion *motion) {
+			if(count == capacity) grow();
+			for(unsigned int d = 0; d < dimension; ++d) coords[d * capacity + count] = q[d];
+			data[count++] = motion;
+		}
+
+		void erase(unsigned int k) {
+			count--;
+			for(unsigned int d = 0; d < dimension; ++d) coords[d * capacity + k] = coords[d * capacity + count];
+			data[k] = data[count];
+		}
+
+		double get(unsigned int d, unsigned int k) const {
+			return coords[d * capacity + k];
+		}
+
+		// only when a full leaf can't be split, all its points sit on the same spot
+		void grow() {
+			std::vector<double> larger(dimension * capacity * 2);
+			for(unsigned int d = 0; d < dimension; ++d) {
+				std::copy(coords.begin() + d * capacity, coords.begin() + d * capacity + count, larger.begin() + d * capacity * 2);
+			}
+			coords.swap(larger);
+			capacity *= 2;
+			data.resize(capacity);
+		}
+
+		unsigned int dimension, count, capacity;
+		std::vector<double> coords;
+		std::vector<Motion *> data;
+	};
+
+	struct NearestCollector {
+		NearestCollector() : distance(std::numeric_limits<double>::infinity()), best(NULL) {}
+		double bound() const {
+			return distance;
+		}
+		void offer(double d, Motion *motion) {
+			if(d < distance) {
+				distance = d;
+				best = motion;
+			}
+		}
+		double distance;
+		Motion *best;
+	};
+
+	struct KCollector {
+		KCollector(std::size_t k) : k(k) {
+			heap.reserve(k);
+		}
+		double bound() const {
+			return heap.size() < k ? std::numeric_limits<double>::infinity() : heap.front().first;
+		}
+		void offer(double d, Motion *motion) {
+			if(heap.size() < k) {
+				heap.push_back(Neighbor(d, motion));
+				std::push_heap(heap.begin(), heap.end(), closer);
+			} else if(d < heap.front().first) {
+				std::pop_heap(heap.begin(), heap.end(), closer);
+				heap.back() = Neighbor(d, motion);
+				std::push_heap(heap.begin(), heap.end(), closer);
+			}
+		}
+		void sorted(std::vector<Motion *> &nbh) {
+			std::sort_heap(heap.begin(), heap.end(), closer);
+			for(const Neighbor &neighbor : heap) nbh.push_back(neighbor.second);
+		}
+		static bool closer(const Neighbor &a, const Neighbor &b) {
+			return a.first < b.first;
+		}
+		std::size_t k;
+		std::vector<Neighbor> heap;
+	};
+
+	struct RCollector {
+		RCollector(double radius) : radius(radius) {}
+		double bound() const {
+			return radius;
+		}
+		void offer(double d, Motion *motion) {
+			if(d <= radius) found.push_back(Neighbor(d, motion));
+		}
+		void sorted(std::vector<Motion *> &nbh) {
+			std::stable_sort(found.begin(), found.end(), KCollector::closer);
+			for(const Neighbor &neighbor : found) nbh.push_back(neighbor.second);
+		}
+		double radius;
+		std::vector<Neighbor> found;
+	};
+
+	// the search reaches out to radius, and past it only until the first accepted node is found
+	struct SelectCollector {
+		SelectCollector(double radius, const std::function<bool(Motion *)> &accept, const std::function<bool(Motion *, Motion *)> &better) :
+			radius(radius), bestDistance(0), closestDistance(std::numeric_limits<double>::infinity()), best(NULL), closest(NULL),
+			accept(accept), better(better) {}
+		double bound() const {
+			return std::max(radius, closestDistance);
+		}
+		void offer(double d, Motion *motion) {
+			if(!accept(motion)) return;
+			if(d <= radius && (best == NULL || better(motion, best) || (d < bestDistance && !better(best, motion)))) {
+				best = motion;
+				bestDistance = d;
+			}
+			if(d < closestDistance) {
+				closestDistance = d;
+				closest = motion;
+			}
+		}
+		double radius, bestDistance, closestDistance;
+		Motion *best, *closest;
+		const std::function<bool(Motion *)> &accept;
+		const std::function<bool(Motion *, Motion *)> &better;
+	};
+
+	void pack(Motion *motion, double *q) const {
+		const ompl::base::State *state = motion->*StateMember;
+		for(unsigned int d = 0; d < dimension; ++d) {
+			q[d] = *space->getValueAddressAtIndex(state, d);
+		}
+	}
+
+	unsigned int descend(const double *q) const {
+		unsigned int node = 0;
+		while(nodes[node].axis >= 0) {
+			node = nodes[node].children[q[nodes[node].axis] < nodes[node].split ? 0 : 1];
+		}
+		return node;
+	}
+
+	// distances from q to leaf points [first, first + n), n <= LeafSize
+	void leafDistances(const Leaf &leaf, unsigned int first, unsigned int n, const double *q, double *out) const {
+		Rigid::distances(leaf.coords.data() + first, leaf.capacity, n, q, translationWeight, rotationWeight, out);
+		for(unsigned int k = 0; k < n; ++k) out[k] *= rigidScale;
+
+		for(const Group &group : groups) {
+			double squared[LeafSize] = {};
+			for(unsigned int d = group.offset; d < group.offset + group.size; ++d) {
+				const double *values = leaf.coords.data() + d * leaf.capacity + first;
+				for(unsigned int k = 0; k < n; ++k) {
+					double diff = values[k] - q[d];
+					squared[k] += diff * diff;
+				}
+			}
+			for(unsigned int k = 0; k < n; ++k) out[k] += group.weight * std::sqrt(squared[k]);
+		}
+	}
+
+	template <class Collector>
+	void search(unsigned int index, const double *q, Collector &collector) const {
+		const Node &node = nodes[index];
+		if(node.axis < 0) {
+			const Leaf &leaf = *leaves[node.leaf];
+			double distances[LeafSize];
+			for(unsigned int first = 0; first < leaf.count; first += LeafSize) {
+				unsigned int n = leaf.count - first < LeafSize ? leaf.count - first : LeafSize;
+				leafDistances(leaf, first, n, q, distances);
+				for(unsigned int k = 0; k < n; ++k) collector.offer(distances[k], leaf.data[first + k]);
+			}
+			return;
+		}
+
+		double delta = q[node.axis] - node.split;
+		unsigned int near = delta < 0 ? 0 : 1;
+		search(node.children[near], q, collector);
+		if(axisWeight[node.axis] * std::fabs(delta) <= collector.bound()) {
+			search(node.children[1 - near], q, collector);
+		}
+	}
+
+	// turn a full leaf into two, false if all its points agree on every axis we split on
+	bool split(unsigned int index) {
+		Leaf &leaf = *leaves[nodes[index].leaf];
+		int axis = -1;
+		double widest = 0, low = 0, high = 0;
+		for(unsigned int d = 0; d < dimension; ++d) {
+			if(axisWeight[d] <= 0) continue;
+			double lo = leaf.get(d, 0), hi = lo;
+			for(unsigned int k = 1; k < leaf.count; ++k) {
+				lo = std::min(lo, leaf.get(d, k));
+				hi = std::max(hi, leaf.get(d, k));
+			}
+			if(axisWeight[d] * (hi - lo) > widest) {
+				widest = axisWeight[d] * (hi - lo);
+				axis = d;
+				low = lo;
+				high = hi;
+			}
+		}
+		if(axis < 0) return false;
+
+		std::vector<double> values(leaf.count);
+		for(unsigned int k = 0; k < leaf.count; ++k) values[k] = leaf.get(axis, k);
+		std::nth_element(values.begin(), values.begin() + leaf.count / 2, values.end());
+		double splitValue = values[leaf.count / 2];
+		if(splitValue <= low) splitValue = (low + high) / 2; //median on the minimum would leave the left side empty
+
+		std::unique_ptr<Leaf> left(new Leaf(dimension)), right(new Leaf(dimension));
+		double q[MaxDimension];
+		for(unsigned int k = 0; k < leaf.count; ++k) {
+			for(unsigned int d = 0; d < dimension; ++d) q[d] = leaf.get(d, k);
+			(q[axis] < splitValue ? left : right)->push(q, leaf.data[k]);
+		}
+
+		unsigned int leftLeaf = nodes[index].leaf, rightLeaf = leaves.size();
+		leaves[leftLeaf] = std::move(left);
+		leaves.push_back(std::move(right));
+
+		unsigned int leftNode = nodes.size();
+		nodes.push_back(Node(leftLeaf));
+		nodes.push_back(Node(rightLeaf));
+		nodes[index].axis = axis;
+		nodes[index].split = splitValue;
+		nodes[index].children[0] = leftNode;
+		nodes[index].children[1] = leftNode + 1;
+		return true;
+	}
+
+	const ompl::base::StateSpace *space;
+	unsigned int dimension;
+	std::vector<Group> groups;
+	double rigidScale, translationWeight, rotationWeight;
+	double axisWeight[MaxDimension];
+
+	std::vector<Node> nodes;
+	std::vector<std::unique_ptr<Leaf>> leaves;
+	std::size_t count;
+};
+
+/* nearest neighbors choice for the tree planners, set from the instance's NearestNeighbors */
+
+std::string nearestNeighborsType = "Default";
+
+template <class Motion, class Owner, ompl::base::State *Owner::*StateMember>
+ompl::NearestNeighbors<Motion *> *allocNearestNeighbors(const ompl::base::Planner *planner) {
+	const ompl::base::StateSpacePtr &space = planner->getSpaceInformation()->getStateSpace();
+	if(nearestNeighborsType.compare("KDTreeSE2") == 0) {
+		return new KDTreeNearestNeighbors<Motion, Owner, StateMember, SE2Rigid>(space);
+	} else if(nearestNeighborsType.compare("KDTreeSE3") == 0) {
+		return new KDTreeNearestNeighbors<Motion, Owner, StateMember, SE3Rigid>(space);
+	} else if(nearestNeighborsType.compare("Default") != 0) {
+		throw ompl::Exception("unrecognized NearestNeighbors " + nearestNeighborsType);
+	}
+	return ompl::tools::SelfConfig::getDefaultNearestNeighbors<Motion *>(planner);
+}
+
+/* SST's lookups on any index, in one traversal when it is an SSTNearestNeighbors */
+
+template <class Motion>
+Motion *nearestWithDistance(const ompl::NearestNeighbors<Motion *> &nn, Motion *data, double &distance) {
+	const SSTNearestNeighbors<Motion> *fused = dynamic_cast<const SSTNearestNeighbors<Motion> *>(&nn);
+	if(fused != NULL) {
+		return fused->nearest(data, distance);
+	}
+	Motion *closest = nn.nearest(data);
+	distance = nn.getDistanceFunction()(closest, data);
+	return closest;
+}
+
+template <class Motion>
+Motion *selectWithin(const ompl::NearestNeighbors<Motion *> &nn, Motion *data, double radius, const std::function<bool(Motion *)> &accept,
+                     const std::function<bool(Motion *, Motion *)> &better) {
+	const SSTNearestNeighbors<Motion> *fused = dynamic_cast<const SSTNearestNeighbors<Motion> *>(&nn);
+	if(fused != NULL) {
+		return fused->selectWithin(data, radius, accept, better);
+	}
+
+	std::vector<Motion *> ret;
+	Motion *selected = NULL;
+	nn.nearestR(data, radius, ret);
+	for(unsigned int i = 0; i < ret.size(); i++) {
+		if(accept(ret[i]) && (selected == NULL || better(ret[i], selected))) {
+			selected = ret[i];
+		}
+	}
+	for(std::size_t k = 1; selected == NULL && k < nn.size() + 5; k += 5) {
+		nn.nearestK(data, k, ret);
+		for(unsigned int i = 0; i < ret.size() && selected == NULL; i++) {
+			if(accept(ret[i])) selected = ret[i];
+		}
+	}
+	return selected;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+/* A set of T pointers that hands out the one selected the fewest (or the most) times, in O(1).
+
+Items are bucketed by their selection count. The non empty buckets form a list sorted by count, so the
+least selected items are always the first bucket, the most selected the last, and selecting one moves it
+to the next bucket (made if there isn't one for count + 1). Every item has a handle (its slot in the entry slab) for O(1)
+removal, removal by pointer goes through a hash map to the handle. Buckets keep their members in a
+vector, so scanning the least selected ones (for a tie break) walks contiguous memory. Slots of
+removed items and emptied buckets are reused.
+
+Items within a bucket come out in no particular order.
+*/
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+template <class T>
+class LeastSelectedSet {
+public:
+	typedef unsigned int Handle;
+	static const unsigned int None = std::numeric_limits<unsigned int>::max();
+
+	Handle add(T *item, unsigned int selected = 0) {
+		assert(handles.find(item) == handles.end());
+		Handle handle = allocEntry();
+		Entry &entry = entries[handle];
+		entry.item = item;
+		entry.selected = selected;
+		handles[item] = handle;
+
+		// new items (0) find their bucket in front right away, others are looked for from the most
+		// selected end, so items re added in ascending count order (BeastSamplerBase's remap) don't walk
+		unsigned int before = tail;
+		if(head != None && buckets[head].selected >= selected) {
+			before = buckets[head].selected == selected ? head : None;
+		}
+		while(before != None && buckets[before].selected > selected) {
+			before = buckets[before].prev;
+		}
+		if(before == None || buckets[before].selected != selected) {
+			before = insertBucket(before, selected);
+		}
+		join(handle, before);
+		return handle;
+	}
+
+	void remove(Handle handle) {
+		Entry &entry = entries[handle];
+		handles.erase(entry.item);
+		leave(handle);
+		entry.item = NULL;
+		freeEntries.push_back(handle);
+		count--;
+	}
+
+	// false if the item isn't in the set
+	bool remove(const T *item) {
+		auto found = handles.find(const_cast<T *>(item));
+		if(found == handles.end()) return false;
+		remove(found->second);
+		return true;
+	}
+
+	void clear() {
+		entries.clear();
+		freeEntries.clear();
+		buckets.clear();
+		freeBuckets.clear();
+		handles.clear();
+		head = tail = None;
+		count = 0;
+	}
+
+	// the least selected items, valid until the set changes
+	const std::vector<Handle> &leastSelected() const {
+		assert(head != None);
+		return buckets[head].members;
+	}
+
+	// the most selected items, valid until the set changes
+	const std::vector<Handle> &mostSelected() const {
+		assert(tail != None);
+		return buckets[tail].members;
+	}
+
+	// counts a selection of handle and returns its item
+	T *select(Handle handle) {
+		Entry &entry = entries[handle];
+		unsigned int from = entry.bucket;
+		unsigned int to = buckets[from].next;
+		if(to == None || buckets[to].selected != entry.selected + 1) {
+			to = insertBucket(from, entry.selected + 1);
+		}
+		entry.selected++;
+		leave(handle);
+		join(handle, to);
+		return entry.item;
+	}
+
+	// counts a selection of one of the least selected items and returns it
+	T *selectLeast() {
+		return select(leastSelected().back());
+	}
+
+	// counts a selection of one of the most selected items and returns it
+	T *selectMost() {
+		return select(mostSelected().back());
+	}
+
+	// None if the item isn't in the set
+	Handle getHandle(const T *item) const {
+		auto found = handles.find(const_cast<T *>(item));
+		return found == handles.end() ? None : found->second;
+	}
+
+	T *get(Handle handle) const {
+		return entries[handle].item;
+	}
+
+	unsigned int getSelected(Handle handle) const {
+		return entries[handle].selected;
+	}
+
+	template <class F>
+	void forEach(F f) const {
+		for(unsigned int b = head; b != None; b = buckets[b].next) {
+			for(Handle handle : buckets[b].members) {
+				f(entries[handle].item, entries[handle].selected);
+			}
+		}
+	}
+
+	unsigned int size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+private:
+	struct Entry {
+		T *item = NULL;
+		unsigned int selected = 0;
+		unsigned int bucket = None;
+		unsigned int position = 0; //in its bucket's members
+	};
+
+	struct Bucket {
+		unsigned int selected = 0;
+		unsigned int prev = None, next = None;
+		std::vector<Handle> members;
+	};
+
+	Handle allocEntry() {
+		count++;
+		if(!freeEntries.empty()) {
+			Handle handle = freeEntries.back();
+			freeEntries.pop_back();
+			return handle;
+		}
+		entries.emplace_back();
+		return entries.size() - 1;
+	}
+
+	unsigned int insertBucket(unsigned int before, unsigned int selected) {
+		unsigned int index;
+		if(!freeBuckets.empty()) {
+			index = freeBuckets.back();
+			freeBuckets.pop_back();
+		} else {
+			buckets.emplace_back();
+			index = buckets.size() - 1;
+		}
+
+		Bucket &bucket = buckets[index];
+		bucket.selected = selected;
+		bucket.prev = before;
+		bucket.next = before == None ? head : buckets[before].next;
+		if(bucket.next != None) buckets[bucket.next].prev = index;
+		else tail = index;
+		if(before == None) head = index;
+		else buckets[before].next = index;
+		return index;
+	}
+
+	void join(Handle handle, unsigned int bucket) {
+		Entry &entry = entries[handle];
+		entry.bucket = bucket;
+		entry.position = buckets[bucket].members.size();
+		buckets[bucket].members.push_back(handle);
+	}
+
+	// takes handle out of its bucket and drops the bucket if that empties it
+	void leave(Handle handle) {
+		Entry &entry = entries[handle];
+		Bucket &bucket = buckets[entry.bucket];
+		Handle last = bucket.members.back();
+		bucket.members[entry.position] = last;
+		entries[last].position = entry.position;
+		bucket.members.pop_back();
+
+		if(bucket.members.empty()) {
+			if(bucket.prev != None) buckets[bucket.prev].next = bucket.next;
+			else head = bucket.next;
+			if(bucket.next != None) buckets[bucket.next].prev = bucket.prev;
+			else tail = bucket.prev;
+			freeBuckets.push_back(entry.bucket);
+		}
+		entry.bucket = None;
+	}
+
+	std::vector<Entry> entries;
+	std::vector<Handle> freeEntries;
+	std::vector<Bucket> buckets;
+	std::vector<unsigned int> freeBuckets;
+	std::unordered_map<T *, Handle> handles;
+	unsigned int head = None, tail = None;
+	unsigned int count = 0;
+};
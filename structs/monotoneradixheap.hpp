@@ -0,0 +1,178 @@
+#pragma once
+
+/* Radix heap for Dijkstra style searches, with the interface of InPlaceBinaryHeap. Keys are non negative
+doubles and never smaller than the last popped key (the search is monotone), class Ops defines:
+
+unsigned int getHeapIndex(const T*)
+void setHeapIndex(T*, unsigned int i)
+double getHeapKey(const T*)
+
+A non negative double's bits order the same way as the double, so keys are kept as 64 bit integers and
+item i sits in the bucket of the highest bit where it differs from the last popped key. Popping empties
+the lowest non empty bucket into the ones below it around its minimum, every item moves down at most 64
+times in its life, so pushes and decreases are O(1) and pops O(1) amortized plus the redistribution.
+Equal keys come out in no particular order.
+
+The heap index handed to Ops is the item's slot here, inHeap also checks that the slot holds the item,
+so items don't need their heap index initialized before their first push.
+*/
+
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+template <class T, class Ops>
+class MonotoneRadixHeap {
+public:
+	MonotoneRadixHeap(int size=100) {
+		slots.reserve(size);
+	}
+
+	void createFromVector(const std::vector<T *> &vec) {
+		clear();
+		for(T *item : vec) {
+			push(item);
+		}
+	}
+
+	void clear() {
+		for(auto &bucket : buckets) {
+			bucket.clear();
+		}
+		slots.clear();
+		freeSlots.clear();
+		last = 0;
+		fill = 0;
+	}
+
+	void push(T *data) {
+		unsigned int index;
+		if(!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		} else {
+			slots.emplace_back();
+			index = slots.size() - 1;
+		}
+		slots[index].item = data;
+		Ops::setHeapIndex(data, index);
+		place(index, toBits(Ops::getHeapKey(data)));
+		fill++;
+	}
+
+	T *peek() {
+		assert(fill > 0);
+		settle();
+		return slots[buckets[0].back()].item;
+	}
+
+	T *pop() {
+		assert(fill > 0);
+		settle();
+		unsigned int index = buckets[0].back();
+		T *ret_T = slots[index].item;
+		release(index);
+		return ret_T;
+	}
+
+	bool isEmpty() const {
+		return fill == 0;
+	}
+
+	int getFill() const {
+		return fill;
+	}
+
+	bool inHeap(const T *data) const {
+		unsigned int index = Ops::getHeapIndex(data);
+		return index < slots.size() && slots[index].item == data;
+	}
+
+	// the item's key changed (but is still no less than the last popped one)
+	void siftFromItem(const T *data) {
+		if(!inHeap(data)) return;
+		unsigned int index = Ops::getHeapIndex(data);
+		unplace(index);
+		place(index, toBits(Ops::getHeapKey(data)));
+	}
+
+	void remove(const T *data) {
+		release(Ops::getHeapIndex(data));
+	}
+
+private:
+	static const unsigned int BucketCount = 65;
+
+	struct Slot {
+		T *item = NULL;
+		uint64_t key = 0;
+		unsigned int bucket = 0, position = 0;
+	};
+
+	static uint64_t toBits(double key) {
+		assert(key >= 0);
+		uint64_t bits;
+		memcpy(&bits, &key, sizeof(bits));
+		return bits;
+	}
+
+	unsigned int bucketOf(uint64_t key) const {
+		assert(key >= last);
+		return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+	}
+
+	void place(unsigned int index, uint64_t key) {
+		Slot &slot = slots[index];
+		slot.key = key;
+		slot.bucket = bucketOf(key);
+		slot.position = buckets[slot.bucket].size();
+		buckets[slot.bucket].push_back(index);
+	}
+
+	void unplace(unsigned int index) {
+		Slot &slot = slots[index];
+		std::vector<unsigned int> &bucket = buckets[slot.bucket];
+		unsigned int moved = bucket.back();
+		bucket[slot.position] = moved;
+		slots[moved].position = slot.position;
+		bucket.pop_back();
+	}
+
+	void release(unsigned int index) {
+		unplace(index);
+		Ops::setHeapIndex(slots[index].item, std::numeric_limits<unsigned int>::max());
+		slots[index].item = NULL;
+		freeSlots.push_back(index);
+		fill--;
+	}
+
+	// makes bucket 0 non empty: the lowest non empty bucket's minimum becomes last and its items move down
+	void settle() {
+		if(!buckets[0].empty()) return;
+
+		unsigned int b = 1;
+		while(buckets[b].empty()) b++;
+
+		std::vector<unsigned int> &from = buckets[b];
+		uint64_t minimum = std::numeric_limits<uint64_t>::max();
+		for(unsigned int index : from) {
+			if(slots[index].key < minimum) minimum = slots[index].key;
+		}
+		last = minimum;
+
+		redistribute.swap(from);
+		for(unsigned int index : redistribute) {
+			place(index, slots[index].key);
+		}
+		redistribute.clear();
+	}
+
+	std::vector<unsigned int> buckets[BucketCount];
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> redistribute;
+	uint64_t last = 0;
+	unsigned int fill = 0;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+/* Slab allocator for planner tree nodes.
+
+Motions are constructed in place in fixed size slabs. Every slot keeps the state and control it was given
+the first time it was handed out, so a recycled motion comes back with its storage already attached and
+the state space allocator is only hit while the arena is still growing. free() and alloc() of a recycled
+slot are O(1) pushes and pops on a free list and reset() hands every slot back at once for clear().
+
+OMPL states are laid out by their state space so they can't be carved out of the slab itself; the slab
+length is picked from the state space's serialization length instead, so one slab of motions plus the
+states hanging off it stays around SlabBytes.
+
+The motion type only needs a default constructor. The state and control members are passed in as pointers
+to members of Node, the class that declares them, since the planners don't agree on their names.
+*/
+
+template <class Motion, class Node, ompl::base::State *Node::*StateMember, ompl::control::Control *Node::*ControlMember>
+class MotionArena {
+	struct Slot {
+		typename std::aligned_storage<sizeof(Motion), alignof(Motion)>::type storage;
+		ompl::base::State *state;
+		ompl::control::Control *control;
+		bool live;
+	};
+
+public:
+	static const unsigned int SlabBytes = 1 << 16;
+
+	MotionArena(const ompl::control::SpaceInformation *si) : si(si), used(0) {
+		unsigned int nodeBytes = sizeof(Slot) + si->getStateSpace()->getSerializationLength() +
+		                         si->getControlSpace()->getDimension() * sizeof(double);
+		slabSize = std::max(SlabBytes / nodeBytes, 16u);
+	}
+
+	~MotionArena() {
+		forEachSlot([this](Slot &slot) {
+			if(slot.live) {
+				reinterpret_cast<Motion *>(&slot.storage)->~Motion();
+			}
+			si->freeState(slot.state);
+			si->freeControl(slot.control);
+		});
+	}
+
+	// a default constructed motion with a state and control attached, their contents are whatever was left in them
+	Motion *alloc() {
+		Slot *slot;
+		if(freeSlots.empty()) {
+			if(slabs.empty() || used == slabSize) {
+				slabs.emplace_back(new Slot[slabSize]);
+				used = 0;
+			}
+			slot = &slabs.back()[used++];
+			slot->state = si->allocState();
+			slot->control = si->allocControl();
+		} else {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+
+		Motion *motion = new(&slot->storage) Motion();
+		motion->*StateMember = slot->state;
+		motion->*ControlMember = slot->control;
+		slot->live = true;
+		return motion;
+	}
+
+	// the motion's state and control go back with it, don't free them separately
+	void free(Motion *motion) {
+		Slot *slot = reinterpret_cast<Slot *>(motion);
+		motion->~Motion();
+		slot->live = false;
+		freeSlots.push_back(slot);
+	}
+
+	// every motion handed out so far is dead after this
+	void reset() {
+		freeSlots.clear();
+		forEachSlot([this](Slot &slot) {
+			if(slot.live) {
+				reinterpret_cast<Motion *>(&slot.storage)->~Motion();
+				slot.live = false;
+			}
+			freeSlots.push_back(&slot);
+		});
+	}
+
+	unsigned int getLiveCount() const {
+		return getCapacity() - freeSlots.size();
+	}
+
+	unsigned int getCapacity() const {
+		return slabs.empty() ? 0 : (slabs.size() - 1) * slabSize + used;
+	}
+
+private:
+	template <class F>
+	void forEachSlot(const F &f) {
+		for(unsigned int s = 0; s < slabs.size(); ++s) {
+			unsigned int count = s + 1 == slabs.size() ? used : slabSize;
+			for(unsigned int i = 0; i < count; ++i) {
+				f(slabs[s][i]);
+			}
+		}
+	}
+
+	const ompl::control::SpaceInformation *si;
+	std::vector<std::unique_ptr<Slot[]>> slabs;
+	std::vector<Slot *> freeSlots;
+	unsigned int slabSize, used;
+};
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+/* Samples Data in proportion to their weights, as an implicit binary tree over flat arrays: element i has
+its children at 2i and 2i + 1 (1 based) and subtree[i] is the weight of its whole subtree, so a sample
+is one descent from the root reading the two arrays and nothing else, and an update one walk up to the
+root.
+
+Removing an element moves the last one into its place (and so changes the last one's id). The Element
+pointers handed out only live until the next add or remove.
+*/
 template<class Data>
 class ProbabilityDensityFunction {
 public:
 	struct Element {
-		Element(Data *data, double weight, unsigned int index) : data(data),  weight(weight), index(index), leftSubtreeWeight(0), rightSubtreeWeight(0) {}
+		Element(Data *data, unsigned int index) : data(data), index(index) {}
 
 		Data *getData() const {
 			return data;
@@ -14,178 +26,103 @@ public:
 			return index;
 		}
 
-	protected:
-		unsigned int leftChild() const {
-			return index * 2;
-		}
-
-		unsigned int rightChild() const {
-			return index * 2 + 1;
-		}
-
-		unsigned int parent() const {
-			return index / 2;
-		}
-
-		bool isRoot() const {
-			return index == 1;
-		}
-
-		bool isLeftChild() const {
-			return index % 2 == 0;
-		}
-
-		void addToLeftSubtreeWeight(double w) {
-			leftSubtreeWeight += w;
-		}
-
-		void addToRightSubtreeWeight(double w) {
-			rightSubtreeWeight += w;
-		}
-
-		double getWeight() const {
-			return weight;
-		}
-
-		double getLeftSubtreeWeight() const {
-			return leftSubtreeWeight;
-		}
-
-		double getRightSubTreeWeight() const {
-			return rightSubtreeWeight;
-		}
-
-		double getSubtreeWeight() const {
-			return leftSubtreeWeight + weight + rightSubtreeWeight;
-		}
-
-
 	private:
 		friend ProbabilityDensityFunction;
 		Data *data;
-		double weight, leftSubtreeWeight, rightSubtreeWeight;
 		unsigned int index;
 	};
 
-	ProbabilityDensityFunction() : elements(1) {}
-
-	~ProbabilityDensityFunction() {
-		for(auto el : elements) {
-			delete el;
-		}
-	}
+	ProbabilityDensityFunction() : elements(1, Element(NULL, 0)), weights(1, 0), subtree(1, 0) {}
 
 	bool isEmpty() const {
 		return elements.size() <= 1;
 	}
 
-	Element *add(Data *data, double weight) {
-		elements.push_back(new Element(data, weight, elements.size()));
+	unsigned int size() const {
+		return elements.size() - 1;
+	}
 
-		updateTree(elements.back(), weight);
-		return elements.back();
+	void reserve(unsigned int count) {
+		elements.reserve(count + 1);
+		weights.reserve(count + 1);
+		subtree.reserve(count + 1);
+	}
+
+	Element *add(Data *data, double weight) {
+		unsigned int index = elements.size();
+		elements.emplace_back(data, index);
+		weights.push_back(weight);
+		subtree.push_back(0);
+		propagate(index, weight);
+		return &elements.back();
 	}
 
 	Element *update(unsigned int index, double weight) {
-		Element *element = elements[index];
-		updateTree(element, weight - element->weight);
-		element->weight = weight;
-		return element;
+		propagate(index, weight - weights[index]);
+		weights[index] = weight;
+		return &elements[index];
 	}
 
 	Element *remove(unsigned int index) {
-		Element *element = elements[index];
-
-		if(index != elements.size()-1) {
-			Element *replaceWith = elements.back();
-			updateTree(replaceWith, -replaceWith->weight);
-
-			updateTree(element, replaceWith->weight - element->weight);
-
-			elements[index] = replaceWith;
-			elements[index]->index = index;
-			elements[index]->leftSubtreeWeight = element->leftSubtreeWeight;
-			elements[index]->rightSubtreeWeight = element->rightSubtreeWeight;
+		unsigned int last = elements.size() - 1;
+		if(index != last) {
+			double moved = weights[last];
+			propagate(last, -moved);
+			propagate(index, moved - weights[index]);
+			weights[index] = moved;
+			elements[index] = elements[last];
+			elements[index].index = index;
 		} else {
-			updateTree(element, -element->weight);
+			propagate(index, -weights[index]);
 		}
 
-		elements.resize(elements.size() - 1);
-
-		delete element;
+		elements.pop_back();
+		weights.pop_back();
+		subtree.pop_back();
 
-		return index >= elements.size() ? NULL : elements[index];
+		return index >= elements.size() ? NULL : &elements[index];
 	}
 
 	Data *sample() const {
-		double total = elements[1]->getSubtreeWeight();
-		double value = zeroToOne.uniform01() * total;
-
-		Element *cur = elements[1];
-		double left, weight, offset = 0;
-		unsigned int kid;
-		while(true) {
-
-			weight = cur->getWeight();
-			left = offset + cur->getLeftSubtreeWeight();
-
-			if(value < left) {
-				kid = cur->leftChild();
-				if(kid >= elements.size()) return cur->data;
-				cur = elements[kid];
-			} else if(value < (left + weight)) {
-				return cur->data;
-			} else {
-				kid = cur->rightChild();
-				if(kid >= elements.size()) return cur->data;
-				offset = left + weight;
-				cur = elements[kid];
-			}
-		}
+		return elements[find(zeroToOne.uniform01() * subtree[1])].data;
 	}
 
 	void checkInvariant() const {
-		checkInvariant(elements[1]);
+		for(unsigned int i = elements.size() - 1; i >= 1; --i) {
+			unsigned int left = 2 * i, right = left + 1;
+			double sum = weights[i] + (left < elements.size() ? subtree[left] : 0) + (right < elements.size() ? subtree[right] : 0);
+			assert(fabs(subtree[i] - sum) < 0.000001);
+		}
 	}
 
 private:
-
-	void checkInvariant(Element *el) const {
-		double leftSubtreeWeight = el->getLeftSubtreeWeight();
-		double rightSubtreeWeight = el->getRightSubTreeWeight();
-
-		double leftSubtreeWeight2 = el->leftChild() < elements.size() ? subtreeWeightSum(elements[el->leftChild()]) : 0;
-		double rightSubtreeWeight2 = el->rightChild() < elements.size() ? subtreeWeightSum(elements[el->rightChild()]) : 0;
-
-		assert(fabs(leftSubtreeWeight - leftSubtreeWeight2) < 0.000001);
-		assert(fabs(rightSubtreeWeight - rightSubtreeWeight2) < 0.000001);
-
-		if(el->leftChild() < elements.size()) checkInvariant(elements[el->leftChild()]);
-		if(el->rightChild() < elements.size()) checkInvariant(elements[el->rightChild()]);
-	}
-
-	double subtreeWeightSum(Element *el) const {
-		double left = el->leftChild() < elements.size() ? subtreeWeightSum(elements[el->leftChild()]) : 0;
-		double right = el->rightChild() < elements.size() ? subtreeWeightSum(elements[el->rightChild()]) : 0;
-
-		return left + el->weight + right;
+	// adds weight to the subtree sums of index and all of its ancestors
+	void propagate(unsigned int index, double weight) {
+		for(unsigned int i = index; i >= 1; i /= 2) {
+			subtree[i] += weight;
+		}
 	}
 
-	void updateTree(Element *el, double weight) {
-		Element *cur = el;
-		Element *parent;
-
-		while(!cur->isRoot()) {
-			parent = elements[cur->parent()];
-			if(cur->isLeftChild()) {
-				parent->addToLeftSubtreeWeight(weight);
-			} else {
-				parent->addToRightSubtreeWeight(weight);
+	// the element value falls on, values past the end (rounding) land on the last element of the descent
+	unsigned int find(double value) const {
+		const unsigned int count = elements.size();
+		unsigned int i = 1;
+		while(true) {
+			unsigned int left = 2 * i;
+			double leftWeight = left < count ? subtree[left] : 0;
+			if(value < leftWeight) {
+				i = left;
+				continue;
+			}
+			value -= leftWeight + weights[i];
+			if(value < 0 || left + 1 >= count) {
+				return i;
 			}
-			cur = parent;
+			i = left + 1;
 		}
 	}
 
-	std::vector<Element *> elements;
+	std::vector<Element> elements;
+	std::vector<double> weights, subtree;
 	mutable ompl::RNG zeroToOne;
-};
\ No newline at end of file
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* Counters kept per thread and summed when read.
+
+Counts is a plain struct of counters with a += that adds another one in. Every thread gets its own copy the
+first time it calls local(), so the hot path is a thread_local lookup and no atomics; get() and reset()
+take the lock and walk every thread's copy, so only call them while no planning threads are running.
+When a thread exits its counts are added to a retired total and its copy goes to the next new thread, so
+thread pools made per run don't grow the list. The thread's copy is found through a thread_local in
+local(), so have one instance per Counts type. */
+
+template <class Counts>
+class ThreadCounters {
+public:
+	Counts &local() {
+		thread_local Counts *counts = NULL;
+		if(counts == NULL) counts = acquire();
+		return *counts;
+	}
+
+	Counts get() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		Counts total = retired;
+		for(const auto &counts : threads) total += *counts;
+		return total;
+	}
+
+	void reset() {
+		std::lock_guard<std::mutex> lock(mutex);
+		retired = Counts();
+		for(auto &counts : threads) *counts = Counts();
+	}
+
+	// the copies made so far, at most the number of threads that were counting at the same time
+	unsigned int size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return threads.size();
+	}
+
+private:
+	// gives the thread's copy back when the thread exits
+	struct Release {
+		ThreadCounters *owner;
+		Counts *counts;
+
+		~Release() {
+			owner->release(counts);
+		}
+	};
+
+	Counts *acquire() {
+		Counts *counts;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(unused.empty()) {
+				threads.emplace_back(new Counts());
+				counts = threads.back().get();
+			} else {
+				counts = unused.back();
+				unused.pop_back();
+			}
+		}
+		thread_local Release release = {this, counts};
+		return counts;
+	}
+
+	void release(Counts *counts) {
+		std::lock_guard<std::mutex> lock(mutex);
+		retired += *counts;
+		*counts = Counts();
+		unused.push_back(counts);
+	}
+
+	// owned here rather than by the thread so pool threads can come and go between runs
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<Counts>> threads;
+	std::vector<Counts *> unused;
+	Counts retired;
+};
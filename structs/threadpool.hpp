@@ -0,0 +1,121 @@
+#pragma once
+
+/* A small fixed size pool of worker threads for data parallel loops.
+
+parallelFor hands out item indices from a shared counter, so callers should write their results into
+a slot per item and merge them afterwards if they care about a deterministic order. The calling thread
+takes part in the work as thread 0, so a pool of size 1 runs everything inline without any threads.
+*/
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class ThreadPool {
+public:
+	typedef std::function<void(unsigned int item, unsigned int thread)> Work;
+	typedef std::function<void(unsigned int chunk, unsigned int first, unsigned int last, unsigned int thread)> ChunkWork;
+
+	ThreadPool(unsigned int threadCount = 1) : job(NULL), jobCount(0), next(0), generation(0), busy(0), stopping(false) {
+		if(threadCount == 0) threadCount = 1;
+		for(unsigned int i = 1; i < threadCount; ++i) {
+			workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	unsigned int getThreadCount() const {
+		return workers.size() + 1;
+	}
+
+	// run work(i, thread) for every i in [0, count) and block until all of them are finished
+	void parallelFor(unsigned int count, const Work &work) {
+		if(workers.empty() || count <= 1) {
+			for(unsigned int i = 0; i < count; ++i) {
+				work(i, 0);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &work;
+			jobCount = count;
+			next = 0;
+			busy = workers.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		run(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		job = NULL;
+	}
+
+	/* cut [from, to) into one fixed range per thread and run work(chunk, first, last, thread) on each. Which thread
+	   gets which chunk varies from call to call, the ranges don't, so per chunk state (a seeded sampler) gives the
+	   same results however the threads are scheduled */
+	void parallelForChunks(unsigned int from, unsigned int to, const ChunkWork &work) {
+		unsigned int chunks = getThreadCount();
+		unsigned int chunkSize = to > from ? (to - from + chunks - 1) / chunks : 0;
+		parallelFor(chunks, [&](unsigned int chunk, unsigned int thread) {
+			unsigned int first = std::min(to, from + chunk * chunkSize);
+			unsigned int last = std::min(to, first + chunkSize);
+			work(chunk, first, last, thread);
+		});
+	}
+
+private:
+	void run(unsigned int thread) {
+		for(unsigned int i = next++; i < jobCount; i = next++) {
+			(*job)(i, thread);
+		}
+	}
+
+	void workerLoop(unsigned int thread) {
+		unsigned int seenGeneration = 0;
+		while(true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+				if(stopping) return;
+				seenGeneration = generation;
+			}
+
+			run(thread);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if(--busy == 0) {
+					done.notify_one();
+				}
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+
+	const Work *job;
+	unsigned int jobCount;
+	std::atomic<unsigned int> next;
+	unsigned int generation, busy;
+	bool stopping;
+};
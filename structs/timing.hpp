@@ -0,0 +1,108 @@
+#pragma once
+
+/* Timing helpers.
+
+Everything is measured on the monotonic wall clock; clock() is process CPU time, which counts every
+thread and can't tell the phases of a solve apart. threadCPUSeconds is there for the places that really
+want the calling thread's CPU time.
+
+PHASE_SCOPE(Phase) adds the wall time of the enclosing scope to one of the named phase counters. The
+counters are a ThreadCounters (structs/threadcounters.hpp), so they should only be read or reset while no
+planning threads are running. Phases nest and are inclusive, e.g. collision checks show up both under
+CollisionCheck and under the Propagate or Steer they happened in. Without PHASE_TIMING defined PHASE_SCOPE
+compiles to nothing.
+*/
+
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <string>
+#include "threadcounters.hpp"
+
+typedef std::chrono::steady_clock WallClock;
+typedef WallClock::time_point WallTime;
+
+inline WallTime wallNow() {
+	return WallClock::now();
+}
+
+inline double secondsSince(const WallTime &start) {
+	return std::chrono::duration<double>(WallClock::now() - start).count();
+}
+
+inline double threadCPUSeconds() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class PhaseCounters {
+public:
+	enum Phase { Sample, NearestNeighbor, Steer, Propagate, CollisionCheck, AbstractionUpdate, SearchRepair, PhaseCount };
+
+	static const char *getName(unsigned int phase) {
+		static const char *names[PhaseCount] = { "sample", "nearest neighbor", "steer", "propagate", "collision check",
+		                                         "abstraction update", "search repair" };
+		return names[phase];
+	}
+
+	void add(Phase phase, uint64_t nanoseconds) {
+		Counts &counts = counters.local();
+		counts.nanoseconds[phase] += nanoseconds;
+		counts.calls[phase]++;
+	}
+
+	double getSeconds(unsigned int phase) const {
+		return counters.get().nanoseconds[phase] * 1e-9;
+	}
+
+	uint64_t getCalls(unsigned int phase) const {
+		return counters.get().calls[phase];
+	}
+
+	void reset() {
+		counters.reset();
+	}
+
+private:
+	struct Counts {
+		uint64_t nanoseconds[PhaseCount] = {};
+		uint64_t calls[PhaseCount] = {};
+
+		Counts &operator+=(const Counts &other) {
+			for(unsigned int i = 0; i < PhaseCount; ++i) {
+				nanoseconds[i] += other.nanoseconds[i];
+				calls[i] += other.calls[i];
+			}
+			return *this;
+		}
+	};
+
+	ThreadCounters<Counts> counters;
+};
+
+PhaseCounters phaseCounters;
+
+#ifdef PHASE_TIMING
+
+class PhaseScope {
+public:
+	PhaseScope(PhaseCounters::Phase phase) : phase(phase), start(WallClock::now()) {}
+	~PhaseScope() {
+		phaseCounters.add(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(WallClock::now() - start).count());
+	}
+
+private:
+	PhaseCounters::Phase phase;
+	WallTime start;
+};
+
+#define PHASE_SCOPE_NAME(line) phaseScope##line
+#define PHASE_SCOPE_AT(phase, line) PhaseScope PHASE_SCOPE_NAME(line)(PhaseCounters::phase)
+#define PHASE_SCOPE(phase) PHASE_SCOPE_AT(phase, __LINE__)
+
+#else
+
+#define PHASE_SCOPE(phase)
+
+#endif
@@ -2,9 +2,11 @@
 #include <fstream>
 
 #include <ompl/tools/benchmark/Benchmark.h>
-#include <ompl/control/SimpleDirectedControlSampler.h>
 #include <ompl/control/DirectedControlSampler.h>
 #include "../domains/AppBase.hpp"
+#include "timing.hpp"
+#include "batchdirectedcontrolsampler.hpp"
+#include "kdtreenearestneighbors.hpp"
 
 struct BenchmarkData {
   ompl::tools::Benchmark *benchmark;
@@ -14,8 +16,8 @@ struct BenchmarkData {
 };
 
 struct SolutionStream {
-	void addSolution(ompl::base::Cost c, clock_t start) {
-		solutions.emplace_back(c, (double)(clock()-start) / CLOCKS_PER_SEC);
+	void addSolution(ompl::base::Cost c, const WallTime &start) {
+		solutions.emplace_back(c, secondsSince(start));
 	}
 	std::vector<std::pair<ompl::base::Cost, double>> solutions;
 };
@@ -23,12 +25,14 @@ struct SolutionStream {
 struct Timer {
 	Timer(const std::string &print) : print(print) {
 		OMPL_INFORM("starting : %s", print.c_str());
-		start = clock();
+		start = wallNow();
+		cpuStart = threadCPUSeconds();
 	}
 	~Timer() {
-		OMPL_INFORM("ending : %s : \t%g", print.c_str(), (double)(clock()-start) / CLOCKS_PER_SEC);
+		OMPL_INFORM("ending : %s : \t%g (cpu %g)", print.c_str(), secondsSince(start), threadCPUSeconds() - cpuStart);
 	}
-	clock_t start;
+	WallTime start;
+	double cpuStart;
 	std::string print;
 };
 
@@ -36,6 +40,8 @@ struct GlobalParameters {
 	ompl::app::AppBase<ompl::app::CONTROL> *globalAppBaseControl = NULL;
   ompl::app::AppBase<ompl::app::GEOMETRIC> *globalAppBaseGeometric = NULL;
 	ompl::app::AppBase<ompl::app::GEOMETRIC> *globalAbstractAppBaseGeometric = NULL;
+	//what the domain installed on the abstract space information, which has no getter for it
+	ompl::base::ValidStateSamplerAllocator abstractValidStateSamplerAllocator;
 	ompl::base::RealVectorBounds abstractBounds = ompl::base::RealVectorBounds(0);
 	std::function<void(ompl::base::State*, const std::vector<double>&)> copyVectorToAbstractState;
 	std::function<void(std::vector<double>&, const ompl::base::State*)> copyAbstractStateToVector;
@@ -43,11 +49,11 @@ struct GlobalParameters {
 	SolutionStream solutionStream;
 };
 
-/* simple directed controller */
+/* directed controller, best of howManyControls candidates propagated together */
 
 unsigned int howManyControls = 1;
 ompl::control::DirectedControlSamplerPtr directedControlSamplerAllocator(const ompl::control::SpaceInformation *si) {
-	return ompl::control::DirectedControlSamplerPtr(new ompl::control::SimpleDirectedControlSampler(si, howManyControls));
+	return ompl::control::DirectedControlSamplerPtr(new BatchDirectedControlSampler(si, howManyControls));
 }
 
 
@@ -0,0 +1,188 @@
+#pragma once
+
+/* Cache of collision check results keyed by quantized robot pose.
+
+By default only exact poses are reused (their coordinates hashed bit for bit), so a hit always gives what
+the check would have. Two lossy modes quantize the pose (translation, then yaw or the quaternion) to cells
+of ValidityCacheResolution in translation and ValidityCacheRotationResolution in rotation, both off unless
+asked for:
+	- ValidityCacheInvalidCells ? true: an invalid pose marks its whole cell invalid, any pose in it is
+	  rejected from then on. Never accepts a colliding pose, but can reject free ones next to obstacles.
+	- ValidityCacheConservative ? false: a valid pose marks its whole cell valid, which is only safe when
+	  the cell is small next to the clearance the planner cares about (e.g. a point robot on a fine grid).
+
+The table is open addressed with a short linear probe and no locks: every slot is one 64 bit word holding
+the key hash and the kind of entry, written with a compare and swap into an empty slot (or over the first
+slot of a full probe), so checkers on different threads can share one cache. A word identifies its key by
+a 62 bit hash, a wrong hit needs two different keys to agree on all of it.
+
+Only single robot checks without self collision are cached, the key is the first robot's pose.
+
+Every key is salted with validityCacheGeneration, bumping it (clearValidityCaches, between benchmark runs)
+makes all the existing entries unreachable without touching the tables, so a run doesn't reuse the
+previous run's checks. Only bump it while no planning threads are running.
+*/
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include "threadcounters.hpp"
+
+struct ValidityCacheSettings {
+	double resolution = 0; //0 turns the cache off
+	double rotationResolution = 0.01;
+	unsigned int log2Size = 20;
+	bool conservative = true; //false reuses valid results for the whole cell
+	bool invalidCells = false; //true reuses invalid results for the whole cell
+};
+
+ValidityCacheSettings validityCacheSettings;
+
+struct ValidityCacheCounts {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+
+	ValidityCacheCounts &operator+=(const ValidityCacheCounts &other) {
+		hits += other.hits;
+		misses += other.misses;
+		return *this;
+	}
+};
+
+ThreadCounters<ValidityCacheCounts> validityCacheCounters;
+
+uint64_t validityCacheGeneration = 0;
+
+void clearValidityCaches() {
+	validityCacheGeneration++;
+}
+
+class ValidityCache {
+public:
+	enum Result { Unknown, Valid, Invalid };
+
+	struct Pose {
+		Pose(double x, double y, double yaw) : size(3), translation(2) {
+			values[0] = x;
+			values[1] = y;
+			values[2] = yaw;
+		}
+
+		// q and -q are the same rotation, keep w >= 0 so they share cells
+		Pose(double x, double y, double z, double qx, double qy, double qz, double qw) : size(7), translation(3) {
+			double sign = qw < 0 ? -1 : 1;
+			values[0] = x;
+			values[1] = y;
+			values[2] = z;
+			values[3] = sign * qx;
+			values[4] = sign * qy;
+			values[5] = sign * qz;
+			values[6] = sign * qw;
+		}
+
+		double values[7];
+		unsigned int size, translation;
+	};
+
+	ValidityCache(const ValidityCacheSettings &settings) : settings(settings), mask((uint64_t(1) << settings.log2Size) - 1),
+		slots(new std::atomic<uint64_t>[mask + 1]) {
+		for(uint64_t i = 0; i <= mask; ++i) slots[i].store(0, std::memory_order_relaxed);
+	}
+
+	Result lookup(const Pose &pose) const {
+		uint64_t exact = exactHash(pose);
+		Result result = Unknown;
+		if(contains(entry(exact, ValidEntry))) {
+			result = Valid;
+		} else if(contains(entry(exact, InvalidEntry))) {
+			result = Invalid;
+		} else if(settings.invalidCells || !settings.conservative) {
+			uint64_t cell = cellHash(pose);
+			if(settings.invalidCells && contains(entry(cell, InvalidEntry))) {
+				result = Invalid;
+			} else if(!settings.conservative && contains(entry(cell, ValidEntry))) {
+				result = Valid;
+			}
+		}
+
+		ValidityCacheCounts &counts = validityCacheCounters.local();
+		if(result == Unknown) counts.misses++;
+		else counts.hits++;
+		return result;
+	}
+
+	void store(const Pose &pose, bool valid) {
+		Kind kind = valid ? ValidEntry : InvalidEntry;
+		insert(entry(exactHash(pose), kind));
+		if(valid ? !settings.conservative : settings.invalidCells) insert(entry(cellHash(pose), kind));
+	}
+
+	static std::shared_ptr<ValidityCache> allocFromSettings() {
+		if(validityCacheSettings.resolution <= 0) return std::shared_ptr<ValidityCache>();
+		return std::make_shared<ValidityCache>(validityCacheSettings);
+	}
+
+private:
+	// the low two bits of a slot say what it holds, an empty slot is 0. Exact and cell keys are hashed apart
+	enum Kind { ValidEntry = 1, InvalidEntry = 2 };
+	static const unsigned int Probe = 8;
+
+	static uint64_t mix(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	static uint64_t entry(uint64_t hash, Kind kind) {
+		return (hash << 2) | kind;
+	}
+
+	uint64_t cellHash(const Pose &pose) const {
+		uint64_t h = mix(validityCacheGeneration) ^ pose.size;
+		for(unsigned int i = 0; i < pose.size; ++i) {
+			double resolution = i < pose.translation ? settings.resolution : settings.rotationResolution;
+			h = mix(h ^ uint64_t(int64_t(std::floor(pose.values[i] / resolution))));
+		}
+		return h;
+	}
+
+	static uint64_t exactHash(const Pose &pose) {
+		uint64_t h = mix(validityCacheGeneration) ^ ~uint64_t(pose.size);
+		for(unsigned int i = 0; i < pose.size; ++i) {
+			uint64_t bits;
+			std::memcpy(&bits, &pose.values[i], sizeof(bits));
+			h = mix(h ^ bits);
+		}
+		return h;
+	}
+
+	bool contains(uint64_t word) const {
+		uint64_t index = word >> 2;
+		for(unsigned int i = 0; i < Probe; ++i) {
+			uint64_t found = slots[(index + i) & mask].load(std::memory_order_relaxed);
+			if(found == word) return true;
+			if(found == 0) return false;
+		}
+		return false;
+	}
+
+	void insert(uint64_t word) {
+		uint64_t index = word >> 2;
+		for(unsigned int i = 0; i < Probe; ++i) {
+			std::atomic<uint64_t> &slot = slots[(index + i) & mask];
+			uint64_t found = slot.load(std::memory_order_relaxed);
+			if(found == word) return;
+			if(found == 0 && (slot.compare_exchange_strong(found, word, std::memory_order_relaxed) || found == word)) return;
+		}
+		slots[index & mask].store(word, std::memory_order_relaxed);
+	}
+
+	ValidityCacheSettings settings;
+	uint64_t mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> slots;
+};